@@ -12,22 +12,24 @@
 
 #include "message.h"
 #include "networking.h"
+#include "mixnet/connection.h"
 #include "mixnet/node.h"
 
 #include <arpa/inet.h>
 #include <assert.h>
-#include <errno.h>
-#include <netinet/sctp.h>
 #include <stdint.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <unistd.h>
 
 // Constant parameters
 static const int FRAGMENT_MQ_PCAP_DEPTH = 128;
 static const int FRAGMENT_MQ_APP_PACKETS_DEPTH = 128;
+static const int FRAGMENT_MQ_RX_PACKETS_DEPTH = 1024;
 static const uint32_t DEFAULT_FRAGMENT_TIMEOUT_MS = 2000;
 
 uint16_t fragment_next_port_idx(
@@ -36,6 +38,26 @@ uint16_t fragment_next_port_idx(
     return (idx == max_port_id) ? 0 : idx + 1;
 }
 
+void fragment_notify_node(struct fragment_context *ctx) {
+    const int fd = ctx->mixnet_ctx.notify_fd;
+    if (fd != -1) { eventfd_write(fd, 1); }
+}
+
+int fragment_rx_epoll_fd(struct mixnet_context *subctx, const uint16_t nid) {
+    const uint16_t num_workers = subctx->config.num_rx_workers;
+    if (num_workers == 0) { return subctx->epoll_fd; }
+    return subctx->rx_workers[nid % num_workers].epoll_fd;
+}
+
+// Frees packets the RX workers queued, but the node never consumed
+static void fragment_rx_drain(struct fragment_context *ctx) {
+    struct fragment_rx_message *message = NULL;
+    while ((message = message_queue_tryread(&(ctx->mq_rx_packets))) != NULL) {
+        mixnet_packet_free(ctx, message->packet);
+        message_queue_message_free(&(ctx->mq_rx_packets), message);
+    }
+}
+
 void initialize_fragment_thread_state(
     struct fragment_thread_state *state) {
     state->tid = 0;
@@ -66,13 +88,17 @@ struct fragment_context
     config->neighbor_addrs = NULL;
 
     // Mixnet subcontext
+    subctx->transport = NULL;
+    subctx->epoll_fd = -1;
+    subctx->notify_fd = -1;
     subctx->tx_listen_fd = -1;
     subctx->link_states = NULL;
     subctx->port_mutexes = NULL;
     subctx->rx_socket_fds = NULL;
     subctx->tx_socket_fds = NULL;
-    subctx->packet_buffer = NULL;
     subctx->neighbor_netaddrs = NULL;
+    subctx->rx_workers = NULL;
+    subctx->rx_stop_fd = -1;
     memset(&(subctx->tx_server_netaddr), 0,
            sizeof(subctx->tx_server_netaddr));
 
@@ -104,8 +130,7 @@ struct fragment_context
         free(ctx->ctrl_message_buffer);
         free(ctx); return NULL;
     }
-    if (message_queue_init(&(ctx->mq_app_packets),
-                           MAX_MIXNET_PACKET_SIZE,
+    if (message_queue_init(&(ctx->mq_app_packets), sizeof(void*),
                            FRAGMENT_MQ_APP_PACKETS_DEPTH) != 0) {
         message_queue_destroy(&(ctx->mq_pcap));
         free(ctx->pcap_message_buffer);
@@ -119,6 +144,94 @@ struct fragment_context
     return ctx;
 }
 
+/**
+ * Sets up the RX workers (but doesn't start them): the MQ they feed,
+ * and each one's epoll instance, which also watches the shared stop
+ * eventfd (identified by the user port's ID).
+ */
+static bool fragment_rx_workers_init(struct fragment_context *ctx) {
+    struct mixnet_context *subctx = &(ctx->mixnet_ctx);
+    const uint16_t num_workers = subctx->config.num_rx_workers;
+
+    if (message_queue_init(&(ctx->mq_rx_packets),
+                           sizeof(struct fragment_rx_message),
+                           FRAGMENT_MQ_RX_PACKETS_DEPTH) != 0) {
+        return false;
+    }
+    if ((subctx->rx_workers = malloc(sizeof(struct fragment_rx_worker) *
+                                     num_workers)) == NULL) {
+        message_queue_destroy(&(ctx->mq_rx_packets));
+        return false;
+    }
+    for (uint16_t w = 0; w < num_workers; w++) {
+        struct fragment_rx_worker *worker = &(subctx->rx_workers[w]);
+        worker->ctx = ctx;
+        worker->epoll_fd = -1;
+        initialize_fragment_thread_state(&(worker->ts));
+    }
+    bool success = ((subctx->rx_stop_fd = eventfd(
+        0, EFD_NONBLOCK | EFD_CLOEXEC)) != -1);
+
+    for (uint16_t w = 0; success && (w < num_workers); w++) {
+        struct fragment_rx_worker *worker = &(subctx->rx_workers[w]);
+        struct epoll_event event = {
+            .events = EPOLLIN, .data.u32 = subctx->config.num_neighbors};
+
+        success &= ((worker->epoll_fd = epoll_create1(EPOLL_CLOEXEC)) != -1);
+        success &= (success && (epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD,
+                                          subctx->rx_stop_fd, &event) == 0));
+    }
+    return success;
+}
+
+// Starts the RX workers (if any)
+static bool fragment_rx_workers_start(struct fragment_context *ctx) {
+    struct mixnet_context *subctx = &(ctx->mixnet_ctx);
+    for (uint16_t w = 0; w < subctx->config.num_rx_workers; w++) {
+        struct fragment_rx_worker *worker = &(subctx->rx_workers[w]);
+        if (pthread_create(&(worker->ts.tid), NULL,
+                           &fragment_rx_worker, worker) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Stops the RX workers (if any), once the node thread is gone. A worker
+ * may be blocked waiting for room in the MQ, so keep draining it until
+ * every worker is out.
+ */
+static void fragment_rx_workers_stop(struct fragment_context *ctx) {
+    struct mixnet_context *subctx = &(ctx->mixnet_ctx);
+    const uint16_t num_workers = subctx->config.num_rx_workers;
+    if (num_workers == 0) { return; }
+
+    for (uint16_t w = 0; w < num_workers; w++) {
+        subctx->rx_workers[w].ts.keep_running = false;
+    }
+    eventfd_write(subctx->rx_stop_fd, 1);
+
+    for (uint16_t w = 0; w < num_workers; w++) {
+        struct fragment_rx_worker *worker = &(subctx->rx_workers[w]);
+        while (!worker->ts.exited) {
+            fragment_rx_drain(ctx);
+            usleep(1000);
+        }
+        pthread_join(worker->ts.tid, NULL);
+    }
+    fragment_rx_drain(ctx);
+}
+
+// Returns whether any RX worker has exited
+static bool fragment_rx_workers_exited(const struct fragment_context *ctx) {
+    const struct mixnet_context *subctx = &(ctx->mixnet_ctx);
+    for (uint16_t w = 0; w < subctx->config.num_rx_workers; w++) {
+        if (subctx->rx_workers[w].ts.exited) { return true; }
+    }
+    return false;
+}
+
 bool fragment_mixnet_init(struct fragment_context *ctx,
                           const struct mixnet_node_config c) {
     if (ctx == NULL) { return false; }
@@ -126,13 +239,35 @@ bool fragment_mixnet_init(struct fragment_context *ctx,
     struct mixnet_context *subctx = &(ctx->mixnet_ctx);
     struct mixnet_node_config *config = &(subctx->config);
 
-    success &= ((subctx->packet_buffer =
-        malloc(MAX_MIXNET_PACKET_SIZE)) != NULL);
-
     *config = c;
     subctx->next_port_idx = 0;
     subctx->is_pcap_subscribed = false;
+    memset(&(subctx->stats), 0, sizeof(subctx->stats));
+    subctx->tx_watched_ports = 0;
+    subctx->rx_ready_ports = 0;
     config->neighbor_addrs = NULL; // Stale pointer
+    success &= ((subctx->transport = harness_transport_get(
+        (enum harness_transport_enum) c.transport)) != NULL);
+
+    // No more RX workers than ports to share among them
+    if (config->num_rx_workers > config->num_neighbors) {
+        config->num_rx_workers = config->num_neighbors;
+    }
+
+    // Readiness: RX sockets are registered once they are connected
+    // (identified by NID, with their RX worker if there are any), the
+    // eventfd by the user port's ID. TX ones are only registered while
+    // watched (see mixnet_watch_writable).
+    success &= ((subctx->epoll_fd = epoll_create1(EPOLL_CLOEXEC)) != -1);
+    success &= ((subctx->notify_fd = eventfd(
+        0, EFD_NONBLOCK | EFD_CLOEXEC)) != -1);
+    if (success) {
+        struct epoll_event event = {
+            .events = EPOLLIN, .data.u32 = c.num_neighbors};
+
+        success &= (epoll_ctl(subctx->epoll_fd, EPOLL_CTL_ADD,
+                              subctx->notify_fd, &event) == 0);
+    }
     if (config->num_neighbors == 0) { return success; }
 
     if (success &= ((config->neighbor_addrs =
@@ -169,6 +304,9 @@ bool fragment_mixnet_init(struct fragment_context *ctx,
             subctx->link_states[nid] = true;
         }
     }
+    if (success && (config->num_rx_workers > 0)) {
+        success &= fragment_rx_workers_init(ctx);
+    }
     return success;
 }
 
@@ -179,6 +317,13 @@ void fragment_context_destroy(
     free(ctx->ctrl_message_buffer);
     free(ctx->pcap_message_buffer);
     message_queue_destroy(&(ctx->mq_pcap));
+
+    // Free injected packets the node never consumed
+    void **app_packet = NULL;
+    while ((app_packet = message_queue_tryread(&(ctx->mq_app_packets))) != NULL) {
+        mixnet_packet_free(ctx, *app_packet);
+        message_queue_message_free(&(ctx->mq_app_packets), app_packet);
+    }
     message_queue_destroy(&(ctx->mq_app_packets));
     struct mixnet_context *subctx = &(ctx->mixnet_ctx);
     struct mixnet_node_config *config = &(subctx->config);
@@ -217,9 +362,30 @@ void fragment_context_destroy(
         free(subctx->port_mutexes);
     }
     free(subctx->neighbor_netaddrs);
-    free(subctx->packet_buffer);
     free(subctx->link_states);
 
+    // Tear down the RX workers
+    if (subctx->rx_workers != NULL) {
+        for (uint16_t w = 0; w < config->num_rx_workers; w++) {
+            struct fragment_rx_worker *worker = &(subctx->rx_workers[w]);
+            if (worker->epoll_fd != -1) { close(worker->epoll_fd); }
+        }
+        fragment_rx_drain(ctx);
+        message_queue_destroy(&(ctx->mq_rx_packets));
+        free(subctx->rx_workers);
+    }
+    if (subctx->rx_stop_fd != -1) {
+        close(subctx->rx_stop_fd);
+    }
+
+    // Close readiness FDs
+    if (subctx->epoll_fd != -1) {
+        close(subctx->epoll_fd);
+    }
+    if (subctx->notify_fd != -1) {
+        close(subctx->notify_fd);
+    }
+
     // Close local pcap, ctrl sockets
     if (ctx->local_fd_pcap != -1) {
         close(ctx->local_fd_pcap);
@@ -440,6 +606,10 @@ fragment_run_state_create_topology(struct fragment_context *ctx) {
         .use_random_routing = payload->use_random_routing,
         .root_hello_interval_ms = payload->root_hello_interval_ms,
         .reelection_interval_ms = payload->reelection_interval_ms,
+        .use_rapid_stp = payload->use_rapid_stp,
+        .use_ecmp = payload->use_ecmp,
+        .num_rx_workers = payload->num_rx_workers,
+        .transport = payload->transport,
     };
     if (!fragment_mixnet_init(ctx, c)) {
         return TEST_ERROR_FRAGMENT_EXCEPTION;
@@ -493,12 +663,16 @@ fragment_run_state_start_mixnet(struct fragment_context *ctx) {
     subctx->tx_server_netaddr.sin_addr.s_addr = htonl(INADDR_ANY);
 
     struct mixnet_node_config *config = &(subctx->config);
-    error_code = harness_server_setup(&(subctx->tx_listen_fd),
-                                      &(subctx->tx_server_netaddr),
-                                      config->num_neighbors, false);
-    if (error_code != TEST_ERROR_NONE) { return error_code; }
-
-    // Next, launch a helper thread to accept new connections
+    const struct harness_transport *transport = subctx->transport;
+    if ((config->num_neighbors != 0) &&
+        ((subctx->tx_listen_fd = transport->listen(
+            &(subctx->tx_server_netaddr), config->num_neighbors)) < 0)) {
+        return TEST_ERROR_SOCKET_LISTEN_FAILED;
+    }
+    // Next, launch a helper thread to accept new connections (for
+    // connectionless transports, there are none to wait for)
+    const uint16_t num_clients = (transport->is_connection_oriented ?
+                                  config->num_neighbors : 0);
     struct harness_accepted_state *states = malloc(
         sizeof(struct harness_accepted_state) * config->num_neighbors);
 
@@ -514,7 +688,7 @@ fragment_run_state_start_mixnet(struct fragment_context *ctx) {
         .keep_running = true,
         .num_accepted = &num_accepted,
         .listen_fd = subctx->tx_listen_fd,
-        .max_clients = config->num_neighbors,
+        .max_clients = num_clients,
     };
     pthread_t accept_thread;
     if (pthread_create(&accept_thread, NULL, &harness_accept, &args) != 0) {
@@ -575,14 +749,17 @@ fragment_run_state_start_mixnet(struct fragment_context *ctx) {
     }
     // Next, attempt to connect to each neighbor
     for (uint16_t nid = 0; nid < config->num_neighbors; nid++) {
-        if ((subctx->rx_socket_fds[nid] = harness_socket(false)) < 0) {
-            DIE_DURING_ACCEPT(TEST_ERROR_SOCKET_CREATE_FAILED)
-        }
         // Attempt to connect to the neighbor's Mixnet server
         struct sockaddr_in netaddr = subctx->neighbor_netaddrs[nid];
-        if (harness_connect_with_timeout(subctx->rx_socket_fds[nid],
-            &(netaddr), sizeof(netaddr), ctx->communication_timeout) < 0)
+        if ((subctx->rx_socket_fds[nid] = transport->connect(
+            &(netaddr), ctx->communication_timeout)) < 0)
             { DIE_DURING_ACCEPT(TEST_ERROR_SOCKET_CONNECT_FAILED) }
+
+        // Links start out enabled, so watch for incoming packets
+        struct epoll_event event = {.events = EPOLLIN, .data.u32 = nid};
+        if (epoll_ctl(fragment_rx_epoll_fd(subctx, nid), EPOLL_CTL_ADD,
+                      subctx->rx_socket_fds[nid], &event) < 0)
+            { DIE_DURING_ACCEPT(TEST_ERROR_FRAGMENT_EXCEPTION) }
     }
     struct timespec now;
     if (clock_gettime(CLOCK_MONOTONIC, &now) < 0) {
@@ -609,9 +786,16 @@ fragment_run_state_start_mixnet(struct fragment_context *ctx) {
     pthread_join(accept_thread, NULL);
 
     // Ensure that neighbors connected successfully
-    if (*(args.num_accepted) != config->num_neighbors) {
+    if (*(args.num_accepted) != num_clients) {
         free(states); return TEST_ERROR_SOCKET_ACCEPT_TIMEOUT;
     }
+    // Identify the clients in terms the orchestrator understands
+    for (uint16_t i = 0; i < num_clients; i++) {
+        if (!transport->peer_addr(states[i].connection_fd,
+                                  &(states[i].address))) {
+            free(states); return TEST_ERROR_FRAGMENT_EXCEPTION;
+        }
+    }
     // Acknowledge Mixnet client startup
     memset(ctx->ctrl_message_buffer, 0, MAX_TEST_MESSAGE_SIZE);
     fragment_prepare_message_header(ctx, ctx->ctrl_message_buffer,
@@ -626,10 +810,8 @@ fragment_run_state_start_mixnet(struct fragment_context *ctx) {
         );
         payload->num_neighbors = config->num_neighbors;
         for (uint16_t nid = 0; nid < config->num_neighbors; nid++) {
-            socklen_t addrlen = sizeof(struct sockaddr);
-            if (getsockname(subctx->rx_socket_fds[nid],
-                            (struct sockaddr *) &(payload->
-                                client_netaddrs[nid]), &addrlen) < 0) {
+            if (!transport->local_addr(subctx->rx_socket_fds[nid],
+                                       &(payload->client_netaddrs[nid]))) {
                 free(states);
                 return TEST_ERROR_FRAGMENT_EXCEPTION;
             }
@@ -667,10 +849,19 @@ fragment_run_state_start_mixnet(struct fragment_context *ctx) {
         if (payload->num_neighbors != config->num_neighbors) {
             free(states); return TEST_ERROR_FRAGMENT_BAD_NEIGHBOR_COUNT;
         }
-        // Map NIDs to the appropriate local server FDs
+        // Map NIDs to the appropriate local server FDs (or, for
+        // connectionless transports, open them now)
         for (uint16_t nid = 0; nid < payload->num_neighbors; nid++) {
+            if (!transport->is_connection_oriented) {
+                if ((subctx->tx_socket_fds[nid] = transport->open_tx(
+                        &(subctx->tx_server_netaddr),
+                        &(payload->neighbor_client_netaddrs[nid]))) < 0) {
+                    free(states); return TEST_ERROR_SOCKET_CONNECT_FAILED;
+                }
+                continue;
+            }
             bool success = false;
-            for (uint16_t i = 0; i < config->num_neighbors; i++) {
+            for (uint16_t i = 0; i < num_clients; i++) {
                 if (harness_equal_netaddrs(states[i].address,
                         payload->neighbor_client_netaddrs[nid])) {
                     subctx->tx_socket_fds[nid] = states[i].connection_fd;
@@ -740,6 +931,9 @@ fragment_run_state_run_testcase(struct fragment_context *ctx) {
                        &fragment_pcap, ctx) != 0) {
         return TEST_ERROR_FRAGMENT_EXCEPTION;
     }
+    if (!fragment_rx_workers_start(ctx)) {
+        return TEST_ERROR_FRAGMENT_EXCEPTION;
+    }
 
     while ((error_code == TEST_ERROR_NONE) && !end_testcase) {
         bool send_response = false;
@@ -803,6 +997,11 @@ fragment_run_state_run_testcase(struct fragment_context *ctx) {
                 send_response = true;
             } break;
 
+            // Report protocol counters (filled in with the response)
+            case TEST_MESSAGE_STATS: {
+                send_response = true;
+            } break;
+
             // End this testcase
             case TEST_MESSAGE_END_TESTCASE: {
                 end_testcase = true;
@@ -828,6 +1027,12 @@ fragment_run_state_run_testcase(struct fragment_context *ctx) {
                 fragment_prepare_message_header(
                     ctx, ctx->ctrl_message_buffer, error_code, type);
 
+                if (type == TEST_MESSAGE_STATS) {
+                    fragment_testcase_read_stats(ctx,
+                        (struct test_response_stats*) (
+                            ctx->ctrl_message_buffer +
+                            sizeof(struct test_message_header)));
+                }
                 error_code = harness_send_with_timeout(
                     ctx->local_fd_ctrl, ctx->communication_timeout,
                     ctx->ctrl_message_buffer, MAX_TEST_MESSAGE_SIZE);
@@ -842,7 +1047,8 @@ fragment_run_state_run_testcase(struct fragment_context *ctx) {
 
         // Check on the helper threads. If either of them exited prematurely,
         // log the relevant error, then wait for the orchestrator to timeout.
-        if (!end_testcase && (ctx->ts_node.exited || ctx->ts_pcap.exited)) {
+        if (!end_testcase && (ctx->ts_node.exited || ctx->ts_pcap.exited ||
+                              fragment_rx_workers_exited(ctx))) {
             if (ctx->ts_node.error_code != TEST_ERROR_NONE) {
                 printf("[Node %d] node thread exited with error %d\n",
                        ctx->fragment_id, ctx->ts_node.error_code);
@@ -851,6 +1057,15 @@ fragment_run_state_run_testcase(struct fragment_context *ctx) {
                 printf("[Node %d] pcap thread exited with error %d\n",
                        ctx->fragment_id, ctx->ts_pcap.error_code);
             }
+            for (uint16_t w = 0; w < ctx->mixnet_ctx.config.num_rx_workers; w++) {
+                const struct fragment_thread_state *ts = (
+                    &(ctx->mixnet_ctx.rx_workers[w].ts));
+
+                if (ts->error_code != TEST_ERROR_NONE) {
+                    printf("[Node %d] RX worker %d exited with error %d\n",
+                           ctx->fragment_id, w, ts->error_code);
+                }
+            }
             error_code = TEST_ERROR_FRAGMENT_EXCEPTION;
         }
     }
@@ -879,6 +1094,7 @@ test_error_code_t
 fragment_run_state_end_testcase(struct fragment_context *ctx) {
     ctx->ts_node.keep_running = false;
     ctx->ts_pcap.keep_running = false;
+    fragment_notify_node(ctx); // Wake the node if it's blocked
 
     void **ptr = (void **) message_queue_message_alloc(&(ctx->mq_pcap));
     if (ptr == NULL) { return TEST_ERROR_FRAGMENT_EXCEPTION; }
@@ -894,6 +1110,7 @@ fragment_run_state_end_testcase(struct fragment_context *ctx) {
     }
     pthread_join(ctx->ts_node.tid, NULL);
     pthread_join(ctx->ts_pcap.tid, NULL);
+    fragment_rx_workers_stop(ctx);
     return TEST_ERROR_NONE;
 }
 
@@ -973,7 +1190,7 @@ void *fragment_pcap(void *args) {
 
         // Populate the PCAP message
         memcpy(payload, packet, total_size);
-        free(packet); // Don't need the packet anymore
+        mixnet_packet_free(ctx, packet); // Don't need the packet anymore
 
         // Attempt to send the message
         error_code = harness_send_with_timeout(
@@ -1084,29 +1301,40 @@ test_error_code_t fragment_testcase_task_update_link_state(
     // update link state. If the link is being disabled,
     // we also need to drain the socket receive queue.
     pthread_mutex_lock(mutex);
+    const bool was_enabled = ctx->mixnet_ctx.link_states[nid];
     ctx->mixnet_ctx.link_states[nid] = link_state;
 
+    // Only watch the RX sockets of enabled links (packets on
+    // disabled links are not received, and would otherwise
+    // keep waking the node thread up).
+    if (was_enabled != link_state) {
+        struct epoll_event event = {.events = EPOLLIN, .data.u32 = nid};
+        if (epoll_ctl(fragment_rx_epoll_fd(subctx, nid),
+                      (link_state ? EPOLL_CTL_ADD : EPOLL_CTL_DEL),
+                      subctx->rx_socket_fds[nid], &event) < 0) {
+            pthread_mutex_unlock(mutex);
+            return TEST_ERROR_FRAGMENT_EXCEPTION;
+        }
+    }
+
     if (!link_state) {
+        void *buffer = ctx->ctrl_message_buffer;
+        size_t length = 0;
         int rc = 0;
-        int flags = 0;
         do {
             // Drain the receive queue
-            rc = sctp_recvmsg(subctx->rx_socket_fds[nid],
-                              ctx->ctrl_message_buffer,
-                              MAX_MIXNET_PACKET_SIZE,
-                              NULL, 0, NULL, &flags);
-
-            if (rc == 0) {
-                pthread_mutex_unlock(mutex);
-                return TEST_ERROR_MIXNET_CONNECTION_BROKEN;
-            }
-            if ((rc < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+            test_error_code_t error = TEST_ERROR_NONE;
+            rc = subctx->transport->recv(subctx->rx_socket_fds[nid],
+                                         &buffer, MAX_MIXNET_PACKET_SIZE,
+                                         &length, 1, &error);
+            if (rc < 0) {
                 pthread_mutex_unlock(mutex);
-                return TEST_ERROR_MIXNET_CONNECTION_BROKEN;
+                return error;
             }
         } while (rc > 0);
     }
     pthread_mutex_unlock(mutex);
+    fragment_notify_node(ctx); // Let the node see the new link state
     return TEST_ERROR_NONE;
 }
 
@@ -1119,10 +1347,18 @@ test_error_code_t fragment_testcase_update_pcap_subscription(
 test_error_code_t fragment_testcase_send_packet(
     struct fragment_context *ctx,
     struct test_request_send_packet *metadata) {
-    mixnet_packet *packet = ((mixnet_packet *)
+    void **ptr = ((void **)
         message_queue_message_alloc(&(ctx->mq_app_packets)));
     // If full, the node isn't consuming packets fast enough
-    if (packet == NULL) { return TEST_ERROR_FRAGMENT_EXCEPTION; }
+    if (ptr == NULL) { return TEST_ERROR_FRAGMENT_EXCEPTION; }
+
+    // The node takes the packet as-is (see mixnet_recv), and
+    // may route it in place, so it is always maximum-sized
+    mixnet_packet *packet = mixnet_packet_alloc(ctx, MAX_MIXNET_PACKET_SIZE);
+    if (packet == NULL) {
+        message_queue_message_free(&(ctx->mq_app_packets), ptr);
+        return TEST_ERROR_FRAGMENT_EXCEPTION;
+    }
 
     // Update the header fields
     packet->type = metadata->type;
@@ -1141,17 +1377,34 @@ test_error_code_t fragment_testcase_send_packet(
             memcpy(header->route, metadata->data, metadata->data_size);
         }
     }
-    packet->payload_size =
-        (packet->type == PACKET_TYPE_DATA) ?
-        (MAX_MIXNET_PACKET_SIZE - sizeof(mixnet_packet)) : 0;
+    // DATA packets carry the user data size (see mixnet_recv)
+    if (packet->type != PACKET_TYPE_DATA) { packet->payload_size = 0; }
 
-    message_queue_write(&(ctx->mq_app_packets), (void*) packet);
+    *ptr = packet; // Enqueue the packet
+    message_queue_write(&(ctx->mq_app_packets), ptr);
+    fragment_notify_node(ctx);
     return TEST_ERROR_NONE;
 }
 
+void fragment_testcase_read_stats(
+    struct fragment_context *ctx,
+    struct test_response_stats *response) {
+    // The node keeps running (and counting) while we read
+    mixnet_stats_snapshot(&(response->stats), &(ctx->mixnet_ctx.stats));
+}
+
+/**
+ * Runs the ctrl FSM for one hosted fragment.
+ */
+static void *fragment_host(void *args) {
+    fragment_ctrl((struct fragment_context*) args);
+    return NULL;
+}
+
 int main(int argc, char **argv) {
     if (argc < 5) {
-        printf("[Node] Usage: ./node server_ip server_port node_id nonce\n");
+        printf("[Node] Usage: ./node server_ip server_port node_id nonce "
+               "[-a] [-n num_nodes]\n");
         return 1;
     }
     // Server address
@@ -1171,16 +1424,22 @@ int main(int argc, char **argv) {
 
     // Configuration
     int autotest_mode = 0;
+    uint16_t num_fragments = 1;
     uint32_t connect_timeout = DEFAULT_FRAGMENT_TIMEOUT_MS;
     uint32_t communication_timeout = DEFAULT_FRAGMENT_TIMEOUT_MS;
 
     int c; optind = 4; // Parse command-line args
-    while ((c = getopt(argc, argv, "a")) != -1) {
+    while ((c = getopt(argc, argv, "an:")) != -1) {
         switch (c) {
         case 'a': { autotest_mode = 1; } break;
+        case 'n': { num_fragments = (uint16_t) strtoul(optarg, NULL, 10); } break;
         default: break;
         }
     }
+    if (num_fragments == 0) {
+        printf("[Node] Invalid number of nodes\n");
+        return 1;
+    }
     if (!autotest_mode) {
         // Use large timeouts in manual mode
         communication_timeout = 5000; // 5 seconds
@@ -1188,11 +1447,35 @@ int main(int argc, char **argv) {
         printf("[Node %d] Started Mixnet node with nonce %d\n",
                fragment_id, nonce);
     }
-
-    struct fragment_context *ctx = fragment_context_create(
-        nonce, autotest_mode, fragment_id, connect_timeout,
-        communication_timeout, orc_netaddr);
-
-    fragment_ctrl(ctx);
-    return 0;
+    // Host fragments [fragment_id, fragment_id + num_fragments) in
+    // this process, each running its own ctrl, node and pcap threads.
+    pthread_t *ctrl_threads = malloc(sizeof(pthread_t) * num_fragments);
+    if (ctrl_threads == NULL) {
+        printf("[Node %d] Failed to allocate ctrl threads\n", fragment_id);
+        return 1;
+    }
+    uint16_t num_started = 0;
+    for (; num_started < num_fragments; num_started++) {
+        struct fragment_context *ctx = fragment_context_create(
+            nonce, autotest_mode, (fragment_id + num_started),
+            connect_timeout, communication_timeout, orc_netaddr);
+
+        if (ctx == NULL) {
+            printf("[Node %d] Failed to create fragment context\n",
+                   (fragment_id + num_started));
+            break;
+        }
+        if (pthread_create(&(ctrl_threads[num_started]), NULL,
+                           &fragment_host, ctx) != 0) {
+            printf("[Node %d] Failed to start ctrl thread\n",
+                   (fragment_id + num_started));
+            fragment_context_destroy(ctx);
+            break;
+        }
+    }
+    for (uint16_t idx = 0; idx < num_started; idx++) {
+        pthread_join(ctrl_threads[idx], NULL);
+    }
+    free(ctrl_threads);
+    return (num_started == num_fragments) ? 0 : 1;
 }
@@ -13,8 +13,10 @@
 
 #include "error.h"
 #include "message.h"
+#include "transport.h"
 #include "mixnet/address.h"
 #include "mixnet/config.h"
+#include "mixnet/stats.h"
 #include "external/itc/message_queue.h"
 
 #include <netinet/in.h>
@@ -25,12 +27,15 @@
 extern "C" {
 #endif
 
+struct fragment_rx_worker;
+
 /**
  * Represents each fragment's Mixnet subcontext.
  */
 struct mixnet_context {
     // Mixnet node configuration
     struct mixnet_node_config config;       // This node's configuration
+    const struct harness_transport *transport; // Neighbor link transport
     // TX
     int tx_listen_fd;                       // Listen FD (this node as server)
     int *tx_socket_fds;                     // Socket FDs (this node as server)
@@ -42,8 +47,17 @@ struct mixnet_context {
     volatile bool is_pcap_subscribed;       // Orchestrator subscribed for pcap?
     pthread_mutex_t *port_mutexes;          // Mutexes guarding per-port state
     uint16_t next_port_idx;                 // Next port to serve (RR index)
-    char *packet_buffer;                    // Scratch packet buffer (recv)
     bool *link_states;                      // NID -> Link state (up: true)
+    // Readiness
+    int epoll_fd;                           // Epoll over enabled RX sockets
+    int notify_fd;                          // Eventfd to wake the node thread
+    uint64_t tx_watched_ports;              // TX sockets watched for EPOLLOUT
+    uint64_t rx_ready_ports;                // RX sockets reported readable
+    // RX workers (only if config.num_rx_workers > 0)
+    struct fragment_rx_worker *rx_workers;  // Worker ID -> Worker
+    int rx_stop_fd;                         // Eventfd to stop the workers
+    // Counters
+    struct mixnet_stats stats;              // Written by the node thread
 };
 
 /**
@@ -59,6 +73,27 @@ struct fragment_thread_state {
 void initialize_fragment_thread_state(
     struct fragment_thread_state *state);
 
+/**
+ * Represents an RX worker. Worker W owns the RX sockets of the ports
+ * whose NID is W modulo the number of workers: it waits on them using
+ * its own epoll instance, and hands what it receives over to the node
+ * thread (via mq_rx_packets), so that the syscalls (and copies) for a
+ * node with many busy neighbors are spread across cores.
+ */
+struct fragment_rx_worker {
+    struct fragment_context *ctx;           // Parent context
+    int epoll_fd;                           // Epoll over its enabled RX sockets
+    struct fragment_thread_state ts;        // Worker thread's state
+};
+
+/**
+ * A packet received by an RX worker, pending on the node thread.
+ */
+struct fragment_rx_message {
+    mixnet_packet *packet;                  // Heap-allocated, exact size
+    uint16_t port;                          // Port it was received on
+};
+
 /**
  * Represents the overall fragment context.
  */
@@ -80,7 +115,8 @@ struct fragment_context {
 
     // Housekeeping
     struct message_queue mq_pcap;           // MQ for pcap data
-    struct message_queue mq_app_packets;    // MQ for injected packets
+    struct message_queue mq_app_packets;    // MQ for injected packets (pointers)
+    struct message_queue mq_rx_packets;     // MQ for packets from RX workers
     struct fragment_thread_state ts_node;   // Thread managing the Mixnet node
     struct fragment_thread_state ts_pcap;   // Thread handling the pcap stream
 };
@@ -145,6 +181,7 @@ void fragment_context_destroy(struct fragment_context *ctx);
  */
 void *fragment_node(void *args);
 void *fragment_pcap(void *args);
+void *fragment_rx_worker(void *args); // See connection.c
 void  fragment_ctrl(struct fragment_context *ctx);
 
 /**
@@ -166,6 +203,19 @@ test_error_code_t fragment_check_message_header(
 uint16_t fragment_next_port_idx(
     const uint16_t idx, const uint16_t max_num_ports);
 
+/**
+ * Returns the epoll FD watching the given port's RX socket (that of
+ * the port's RX worker, if any, else the node thread's).
+ */
+int fragment_rx_epoll_fd(struct mixnet_context *subctx, const uint16_t nid);
+
+/**
+ * Wakes the node thread if it is blocked in mixnet_recv_timeout. Used
+ * when a user packet is enqueued, a link changes state, or the node
+ * is asked to stop.
+ */
+void fragment_notify_node(struct fragment_context *ctx);
+
 /**
  * Fragment FSM functionality.
  */
@@ -199,6 +249,10 @@ test_error_code_t fragment_testcase_send_packet(
     struct fragment_context *ctx,
     struct test_request_send_packet *metadata);
 
+void fragment_testcase_read_stats(
+    struct fragment_context *ctx,
+    struct test_response_stats *response);
+
 #ifdef __cplusplus
 }
 #endif
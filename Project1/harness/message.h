@@ -13,6 +13,7 @@
 
 #include "mixnet/address.h"
 #include "mixnet/packet.h"
+#include "mixnet/stats.h"
 
 #include <assert.h>
 #include <netinet/in.h>
@@ -52,6 +53,7 @@ enum test_message_type_enum {
     TEST_MESSAGE_PCAP_DATA,             // Fragment-captured pcap data
     TEST_MESSAGE_PCAP_SUBSCRIPTION,     // Change subscription to pcaps
     TEST_MESSAGE_SEND_PACKET,           // Send a packet on the network
+    TEST_MESSAGE_STATS,                 // Collect protocol counters
     TEST_MESSAGE_START_TESTCASE,        // Indicate testcase commencing
     TEST_MESSAGE_END_TESTCASE,          // Indicate testcase completion
     TEST_MESSAGE_SHUTDOWN,              // Teardown fragment process
@@ -110,6 +112,10 @@ struct test_request_topology {
     uint16_t mixing_factor; // Mixing factor to use during routing
     uint32_t root_hello_interval_ms; // Time between 'hello' messages
     uint32_t reelection_interval_ms; // Time before starting reelection
+    bool use_rapid_stp; // Run rapid STP?
+    bool use_ecmp; // Perform equal-cost multipath routing?
+    uint16_t num_rx_workers; // Number of RX worker threads (0: none)
+    uint8_t transport; // Neighbor link transport (harness_transport_enum)
 };
 CHECK_ALIGNMENT_AND_SIZE(struct test_request_topology);
 
@@ -177,6 +183,12 @@ struct test_response_start_mixnet_clients {
 };
 CHECK_ALIGNMENT_AND_SIZE(struct test_response_start_mixnet_clients);
 
+// Protocol counters
+struct test_response_stats {
+    struct mixnet_stats stats; // Snapshot of the node's counters
+};
+CHECK_ALIGNMENT_AND_SIZE(struct test_response_stats);
+
 // Cleanup
 #undef CHECK_ALIGNMENT_AND_SIZE
 
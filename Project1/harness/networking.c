@@ -15,7 +15,9 @@
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
+#ifdef HARNESS_HAVE_SCTP
 #include <netinet/sctp.h>
+#endif
 #include <poll.h>
 #include <stdio.h>
 #include <sys/socket.h>
@@ -23,10 +25,17 @@
 #include <time.h>
 #include <unistd.h>
 
+// Constant parameters
+static const char UNIX_NAME_FORMAT[] = "mixnet-link-%u"; // Abstract namespace
+
 /**
- * Initializes a non-blocking SCTP socket.
+ * Initializes a non-blocking SCTP (or Unix seqpacket) socket.
  */
 int harness_socket(const bool reuse_addr) {
+#ifndef HARNESS_HAVE_SCTP
+    (void) reuse_addr; // Abstract names go away with their sockets
+    return socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+#else
     int socket_fd = socket(AF_INET, SOCK_STREAM, IPPROTO_SCTP);
     if (socket_fd == -1) { return -1; }
     bool success = true;
@@ -62,6 +71,7 @@ int harness_socket(const bool reuse_addr) {
     // TODO(natre): Enable UDP encapsulation
     if (!success) { close(socket_fd); }
     return success ? socket_fd : -1;
+#endif
 }
 
 /**
@@ -79,6 +89,13 @@ test_error_code_t harness_server_setup(int *socket_fd,
     success &= (*socket_fd = harness_socket(reuse_addr)) > 0;
     if (!success) { return TEST_ERROR_SOCKET_CREATE_FAILED; }
 
+#ifndef HARNESS_HAVE_SCTP
+    // Bind to the port's name (or an arbitrary one, updating addr)
+    uint16_t port = ntohs(addr->sin_port);
+    success &= harness_unix_bind(*socket_fd, &port);
+    if (!success) { return TEST_ERROR_SOCKET_BIND_FAILED; }
+    addr->sin_port = htons(port);
+#else
     // Bind to port
     success &= (bind(*socket_fd, (struct sockaddr *)
                 addr, sizeof(struct sockaddr)) != -1);
@@ -90,6 +107,7 @@ test_error_code_t harness_server_setup(int *socket_fd,
         success &= (getsockname(*socket_fd,
                     (struct sockaddr *) addr, &addrlen) != -1);
     }
+#endif
     // Prepare to listen for connection attempts
     success &= (listen(*socket_fd, listen_queue) != -1);
     if (!success) { return TEST_ERROR_SOCKET_LISTEN_FAILED; }
@@ -200,6 +218,11 @@ void harness_accept_with_timeout(
 int harness_connect_with_timeout(
     const int socket_fd, const struct sockaddr_in *address,
     const socklen_t addrlen, const unsigned int timeout_ms) {
+#ifndef HARNESS_HAVE_SCTP
+    (void) addrlen; // Only the port matters
+    return harness_unix_connect(socket_fd, ntohs(address->sin_port),
+                                timeout_ms);
+#else
     int rc = -1; // Return value
     do {
         if ((rc = connect(socket_fd, (struct sockaddr *)
@@ -254,10 +277,38 @@ int harness_connect_with_timeout(
         }
     } while (0);
     return (rc > 0) ? 0 : -1;
+#endif
+}
+
+/**
+ * Sends one message on an overlay socket (see send(2)).
+ */
+int harness_sendmsg(const int socket_fd, const void *buffer,
+                    const size_t buffer_length) {
+#ifdef HARNESS_HAVE_SCTP
+    return sctp_sendmsg(socket_fd, buffer, buffer_length,
+                        NULL, 0, 0, 0, 0, 0, 0);
+#else
+    return send(socket_fd, buffer, buffer_length, MSG_NOSIGNAL);
+#endif
+}
+
+/**
+ * Receives one message on an overlay socket (see recv(2)).
+ */
+int harness_recvmsg(const int socket_fd, void *recv_buffer,
+                    const size_t buffer_length) {
+#ifdef HARNESS_HAVE_SCTP
+    int flags = 0;
+    return sctp_recvmsg(socket_fd, recv_buffer, buffer_length,
+                        NULL, 0, NULL, &flags);
+#else
+    return recv(socket_fd, recv_buffer, buffer_length, 0);
+#endif
 }
 
 /**
- * Send an SCTP message with the given timeout.
+ * Send an overlay message with the given timeout.
  */
 test_error_code_t harness_send_with_timeout(
     const int socket_fd, const uint32_t timeout_ms,
@@ -274,9 +325,7 @@ test_error_code_t harness_send_with_timeout(
     };
     do {
         // Attempt to send the message
-        int rc = sctp_sendmsg(socket_fd,
-                              buffer, buffer_length,
-                              NULL, 0, 0, 0, 0, 0, 0);
+        int rc = harness_sendmsg(socket_fd, buffer, buffer_length);
         if (rc < 0) {
             if ((errno != EAGAIN) && (errno != ENOBUFS)) {
                 return TEST_ERROR_CTRL_CONNECTION_BROKEN;
@@ -302,7 +351,7 @@ test_error_code_t harness_send_with_timeout(
 }
 
 /**
- * Receive an SCTP message with the given timeout.
+ * Receive an overlay message with the given timeout.
  */
 test_error_code_t harness_recv_with_timeout(
     const int socket_fd, const uint32_t timeout_ms,
@@ -322,10 +371,7 @@ test_error_code_t harness_recv_with_timeout(
     };
     do {
         // Attempt to receive the message
-        int flags = 0;
-        int rc = sctp_recvmsg(socket_fd, recv_buffer,
-                              buffer_length, NULL, 0,
-                              NULL, &flags);
+        int rc = harness_recvmsg(socket_fd, recv_buffer, buffer_length);
         if (rc < 0) {
             if ((errno != EAGAIN) && (errno != ENOBUFS)) {
                 return TEST_ERROR_CTRL_CONNECTION_BROKEN;
@@ -365,3 +411,93 @@ bool harness_equal_netaddrs(const struct sockaddr_in addr_a,
             (addr_a.sin_family == addr_b.sin_family) &&
             (addr_a.sin_addr.s_addr == addr_b.sin_addr.s_addr));
 }
+
+/**
+ * Returns the abstract name for a port (and its length).
+ */
+socklen_t harness_unix_name(const uint16_t port, struct sockaddr_un *addr) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+
+    // Abstract names start with a NUL byte, and are not NUL-terminated
+    const int length = snprintf(&(addr->sun_path[1]),
+                                sizeof(addr->sun_path) - 1,
+                                UNIX_NAME_FORMAT, port);
+    return (socklen_t) (offsetof(struct sockaddr_un, sun_path) + 1 + length);
+}
+
+/**
+ * Parses an abstract name back into a (loopback) network address.
+ */
+bool harness_unix_parse_name(const struct sockaddr_un *name,
+                             const socklen_t namelen,
+                             struct sockaddr_in *addr) {
+    const socklen_t prefix = offsetof(struct sockaddr_un, sun_path) + 1;
+    char path[sizeof(name->sun_path)];
+    unsigned int port = 0;
+
+    if ((name->sun_family != AF_UNIX) || (namelen <= prefix) ||
+        (name->sun_path[0] != '\0')) { return false; }
+
+    memcpy(path, &(name->sun_path[1]), namelen - prefix);
+    path[namelen - prefix] = '\0';
+    if ((sscanf(path, UNIX_NAME_FORMAT, &port) != 1) ||
+        (port == 0) || (port > UINT16_MAX)) { return false; }
+
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr->sin_port = htons((uint16_t) port);
+    return true;
+}
+
+/**
+ * Binds to the given port's name, or (if zero) to a free one.
+ */
+bool harness_unix_bind(const int socket_fd, uint16_t *port) {
+    static uint32_t next_candidate = 0;
+    struct sockaddr_un addr;
+
+    if (*port != 0) {
+        return (bind(socket_fd, (struct sockaddr *) &addr,
+                     harness_unix_name(*port, &addr)) == 0);
+    }
+    // Spread processes apart, so they rarely probe the same names
+    const uint32_t base = (((uint32_t) getpid()) * 2654435761u) +
+        __atomic_fetch_add(&next_candidate, 1, __ATOMIC_RELAXED);
+
+    for (uint32_t i = 0; i < UINT16_MAX; i++) {
+        const uint16_t candidate = (uint16_t) (1 + ((base + i) % UINT16_MAX));
+        if (bind(socket_fd, (struct sockaddr *) &addr,
+                 harness_unix_name(candidate, &addr)) == 0) {
+            *port = candidate;
+            return true;
+        }
+        if (errno != EADDRINUSE) { return false; }
+    }
+    return false;
+}
+
+/**
+ * Connects to the given port's name. Connecting never blocks; it fails
+ * with EAGAIN if the server's backlog is full, so retry until the
+ * deadline. Return 0 on success, -1 for errors.
+ */
+int harness_unix_connect(const int socket_fd, const uint16_t port,
+                         const unsigned int timeout_ms) {
+    struct sockaddr_un addr;
+    const socklen_t addrlen = harness_unix_name(port, &addr);
+
+    struct timespec start, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (connect(socket_fd, (struct sockaddr *) &addr, addrlen) == -1) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        const long elapsed_ms = ((now.tv_sec - start.tv_sec) * 1000l +
+                                 (now.tv_nsec - start.tv_nsec) / 1000000l);
+        if ((errno != EAGAIN) || (elapsed_ms > (long) timeout_ms)) {
+            return -1;
+        }
+        usleep(1000);
+    }
+    return 0;
+}
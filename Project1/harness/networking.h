@@ -15,7 +15,10 @@
 
 #include <netinet/in.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -44,7 +47,9 @@ struct harness_accept_args {
 };
 
 /**
- * Collection of networking-related helper functions.
+ * Collection of networking-related helper functions. The ctrl and pcap
+ * overlays use one-to-one SCTP sockets or, if the harness is built
+ * without SCTP, Unix seqpacket ones (which only work on a single host).
  */
 int harness_socket(const bool reuse_addr);
 
@@ -71,9 +76,31 @@ test_error_code_t harness_recv_with_timeout(
     void *recv_buffer, const size_t buffer_length,
     const uint16_t session_nonce);
 
+int harness_sendmsg(const int socket_fd, const void *buffer,
+                    const size_t buffer_length);
+
+int harness_recvmsg(const int socket_fd, void *recv_buffer,
+                    const size_t buffer_length);
+
 bool harness_equal_netaddrs(const struct sockaddr_in addr_a,
                             const struct sockaddr_in addr_b);
 
+/**
+ * Unix seqpacket sockets are bound to abstract names that embed a port
+ * number, which stands in for the IPv4 port (the address is always the
+ * loopback one).
+ */
+socklen_t harness_unix_name(const uint16_t port, struct sockaddr_un *addr);
+
+bool harness_unix_parse_name(const struct sockaddr_un *name,
+                             const socklen_t namelen,
+                             struct sockaddr_in *addr);
+
+bool harness_unix_bind(const int socket_fd, uint16_t *port);
+
+int harness_unix_connect(const int socket_fd, const uint16_t port,
+                         const unsigned int timeout_ms);
+
 #ifdef __cplusplus
 }
 #endif
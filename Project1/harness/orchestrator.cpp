@@ -12,6 +12,7 @@
 
 #include "networking.h"
 
+#include <algorithm>
 #include <assert.h>
 #include <chrono>
 #include <fcntl.h>
@@ -20,7 +21,6 @@
 #include <iostream>
 #include <limits.h>
 #include <netinet/in.h>
-#include <netinet/sctp.h>
 #include <random>
 #include <signal.h>
 #include <string.h>
@@ -166,10 +166,9 @@ orchestrator::foreach_fragment_send_generic(
 
             lambda(idx, payload); // Populate the payload
             header->fragment_id = idx; // Update fragment ID
-            int rc = sctp_sendmsg(fragment_fds[idx],
-                                  ctrl_message_buffer_,
-                                  MAX_TEST_MESSAGE_SIZE,
-                                  NULL, 0, 0, 0, 0, 0, 0);
+            int rc = harness_sendmsg(fragment_fds[idx],
+                                     ctrl_message_buffer_,
+                                     MAX_TEST_MESSAGE_SIZE);
             if (rc < 0) {
                 if ((errno != EAGAIN) && (errno != ENOBUFS)) {
                     // Connection to fragment is broken, record error
@@ -236,11 +235,9 @@ orchestrator::foreach_fragment_recv_generic(
             auto current_ec = TEST_ERROR_NONE;
             if (!pending[idx]) { continue; }
 
-            int flags = 0;
-            int rc = sctp_recvmsg(fragment_fds[idx],
-                                  ctrl_message_buffer_,
-                                  MAX_TEST_MESSAGE_SIZE,
-                                  NULL, 0, NULL, &flags);
+            int rc = harness_recvmsg(fragment_fds[idx],
+                                     ctrl_message_buffer_,
+                                     MAX_TEST_MESSAGE_SIZE);
             if (rc < 0) {
                 if ((errno != EAGAIN) && (errno != ENOBUFS)) {
                     // Connection to fragment is broken, record error
@@ -333,8 +330,14 @@ orchestrator::run_state_setup_ctrl() {
                               &num_accepted, states, &rc);
     bool success = true;
     if (autotest_mode_ == 1) {
-        // If we're in autotest mode, fork and exec the fragment processes
-        for (size_t idx = 0; (idx < topology_.size()) && success; idx++) {
+        // If we're in autotest mode, fork and exec the fragment processes.
+        // Each process hosts a contiguous range of fragment IDs, starting
+        // at idx, with one set of threads per fragment.
+        for (size_t idx = 0; (idx < topology_.size()) && success;
+             idx += fragments_per_process_) {
+            const size_t num_hosted = std::min<size_t>(
+                fragments_per_process_, (topology_.size() - idx));
+
             pid_t pid = fork(); // Clone the current process
             if (pid < 0) {
                 success = false;
@@ -345,6 +348,7 @@ orchestrator::run_state_setup_ctrl() {
                 auto session_nonce = std::to_string(session_nonce_);
                 auto node_path = fragment_dir_ + "/node";
                 auto fragment_id = std::to_string(idx);
+                auto num_nodes = std::to_string(num_hosted);
                 char *const argv_list[] = {
                     const_cast<char*>(node_path.c_str()), // 0: Executable path
                     const_cast<char*>("127.0.0.1"), // 1: Server IP (Loopback)
@@ -352,6 +356,8 @@ orchestrator::run_state_setup_ctrl() {
                     const_cast<char*>(fragment_id.c_str()), // 3: Fragment ID
                     const_cast<char*>(session_nonce.c_str()), // 4: Nonce
                     const_cast<char*>("-a"), // 5: Use autotest mode
+                    const_cast<char*>("-n"), // 6-7: Fragments hosted
+                    const_cast<char*>(num_nodes.c_str()),
                     NULL
                 };
 
@@ -359,9 +365,11 @@ orchestrator::run_state_setup_ctrl() {
                 exit(EXIT_FAILURE);
             }
             else {
-                // Parent process
-                fragments_.push_back(fragment_metadata());
-                fragments_[idx].pid = pid;
+                // Parent process (shared by all the hosted fragments)
+                for (size_t offset = 0; offset < num_hosted; offset++) {
+                    fragments_.push_back(fragment_metadata());
+                    fragments_[idx + offset].pid = pid;
+                }
             }
         }
     }
@@ -544,6 +552,10 @@ orchestrator::run_state_create_topology() {
         payload->use_random_routing = use_random_routing_[idx];
         payload->reelection_interval_ms = reelection_interval_ms_;
         payload->root_hello_interval_ms = root_hello_interval_ms_;
+        payload->use_rapid_stp = use_rapid_stp_;
+        payload->use_ecmp = use_ecmp_;
+        payload->num_rx_workers = num_rx_workers_;
+        payload->transport = transport_;
     };
     // Send the message to every fragment
     error_code = foreach_fragment_send_ctrl(TEST_MESSAGE_TOPOLOGY, lambda);
@@ -970,9 +982,20 @@ void orchestrator::configure(int argc, char **argv) {
     connect_timeout_ms_ = DEFAULT_WAIT_TIME_MS;
 
     int c; autotest_mode_ = 0; // Parse command-line args
-    while ((c = getopt(argc, argv, "a")) != -1) {
+    while ((c = getopt(argc, argv, "an:t:")) != -1) {
         switch (c) {
         case 'a': { autotest_mode_ = 1; } break;
+        case 'n': {
+            auto value = strtoul(optarg, nullptr, 10);
+            fragments_per_process_ = (value > 0) ? value : 1;
+        } break;
+        case 't': {
+            if (!harness_transport_from_name(optarg, &transport_)) {
+                std::cout << "[Orchestrator] Unknown transport '" << optarg
+                          << "', using " << harness_transport_get(
+                              transport_)->name << std::endl;
+            }
+        } break;
         default: break;
         }
     }
@@ -1025,6 +1048,21 @@ void orchestrator::set_reelection_interval_ms(
     const uint32_t reelection_interval_ms) {
     reelection_interval_ms_ = reelection_interval_ms;
 }
+void orchestrator::set_use_rapid_stp(const bool value) {
+    use_rapid_stp_ = value;
+}
+void orchestrator::set_use_ecmp(const bool value) {
+    use_ecmp_ = value;
+}
+void orchestrator::set_num_rx_workers(const uint16_t value) {
+    num_rx_workers_ = value;
+}
+void orchestrator::set_transport(const enum harness_transport_enum value) {
+    transport_ = value;
+}
+void orchestrator::set_fragments_per_process(const uint16_t value) {
+    fragments_per_process_ = (value > 0) ? value : 1;
+}
 
 test_error_code_t orchestrator::pcap_change_subscription(
     const uint16_t idx, const bool subscribe) {
@@ -1132,6 +1170,27 @@ orchestrator::send_packet(const uint16_t src_idx,
         src_idx, lambda, TEST_MESSAGE_SEND_PACKET);
 }
 
+test_error_code_t
+orchestrator::collect_stats(std::vector<struct mixnet_stats>& stats) {
+    assert(state_ == state_t::STATE_RUN_TESTCASE);
+    stats.resize(fragments_.size());
+
+    // Query every fragment, then gather the responses in one sweep
+    auto error_code = foreach_fragment_send_ctrl(TEST_MESSAGE_STATS,
+                                                 [this] (size_t, void*) {});
+    if (error_code == TEST_ERROR_NONE) {
+        auto lambda = [&stats] (size_t idx, void *p) {
+            auto payload = reinterpret_cast<struct
+                test_response_stats*>(p);
+
+            stats[idx] = payload->stats;
+            return TEST_ERROR_NONE;
+        };
+        error_code = foreach_fragment_recv_ctrl(TEST_MESSAGE_STATS, lambda);
+    }
+    return error_code;
+}
+
 /**
  * Constructor/Destructor.
  */
@@ -13,6 +13,7 @@
 
 #include "error.h"
 #include "message.h"
+#include "transport.h"
 #include "mixnet/address.h"
 
 #include <functional>
@@ -82,6 +83,11 @@ private:
     // Mixnet node configurations
     uint32_t root_hello_interval_ms_ = 2000;        // Default: 2s
     uint32_t reelection_interval_ms_ = 20000;       // Default: 20s
+    bool use_rapid_stp_ = false;                    // Default: Legacy STP
+    bool use_ecmp_ = false;                         // Default: Single path
+    uint16_t num_rx_workers_ = 0;                   // Default: Node thread
+    enum harness_transport_enum transport_ = (
+        HARNESS_TRANSPORT_DEFAULT);                 // Default: SCTP links
     std::vector<uint16_t> mixing_factors_;          // Default: All 1
     std::vector<bool> use_random_routing_;          // Default: All false
 
@@ -96,6 +102,7 @@ private:
     // Configuration
     int autotest_mode_ = 0;                         // Use autotester mode
     std::string fragment_dir_;                      // Fragment executable path
+    uint16_t fragments_per_process_ = 1;            // Nodes hosted per process
     uint32_t connect_timeout_ms_ = 0;               // Setup connection timeout
     uint32_t communication_timeout_ms_ = 0;         // Regular send/recv timeout
 
@@ -198,6 +205,11 @@ public:
     void set_use_random_routing(const uint16_t idx, const bool value);
     void set_root_hello_interval_ms(const uint32_t root_hello_interval_ms);
     void set_reelection_interval_ms(const uint32_t reelection_interval_ms);
+    void set_use_rapid_stp(const bool value);
+    void set_use_ecmp(const bool value);
+    void set_num_rx_workers(const uint16_t value);
+    void set_transport(const enum harness_transport_enum value);
+    void set_fragments_per_process(const uint16_t value);
 
     // Main orchestrator method. Once the virtual topology is set up and all
     // the nodes are running, passes control to the callback registered with
@@ -231,6 +243,12 @@ public:
                                   const uint16_t dst_idx,
                                   const mixnet_packet_type_t type,
                                   const std::string data_string="");
+
+    // Collect every node's protocol counters (see mixnet/stats.h), indexed
+    // by fragment ID. Nodes keep running while their counters are read,
+    // so each snapshot reflects the node's traffic at some point during
+    // the call.
+    test_error_code_t collect_stats(std::vector<struct mixnet_stats>& stats);
 };
 
 #endif // HARNESS_ORCHESTRATOR_H
@@ -0,0 +1,362 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the Mixnet course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the Mixnet project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#define _GNU_SOURCE // sendmmsg, recvmmsg
+#include "transport.h"
+
+#include "networking.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#ifdef HARNESS_HAVE_SCTP
+#include <netinet/sctp.h>
+#endif
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Constant parameters
+static const int UDP_RCVBUF_SIZE = (1 << 20); // UDP has no flow control
+
+#ifdef HARNESS_HAVE_SCTP
+/**
+ * SCTP: the original transport. Each message is a separate syscall.
+ */
+static int sctp_listen(struct sockaddr_in *addr, const int backlog) {
+    int socket_fd = -1;
+    if (harness_server_setup(&socket_fd, addr, backlog,
+                             false) != TEST_ERROR_NONE) {
+        if (socket_fd > 0) { close(socket_fd); }
+        return -1;
+    }
+    return socket_fd;
+}
+
+static int sctp_connect(const struct sockaddr_in *server_addr,
+                        const unsigned int timeout_ms) {
+    int socket_fd = harness_socket(false);
+    if (socket_fd < 0) { return -1; }
+
+    if (harness_connect_with_timeout(socket_fd, server_addr,
+                                     sizeof(*server_addr), timeout_ms) < 0) {
+        close(socket_fd);
+        return -1;
+    }
+    return socket_fd;
+}
+#endif
+
+static bool inet_local_addr(const int fd, struct sockaddr_in *addr) {
+    socklen_t addrlen = sizeof(*addr);
+    return (getsockname(fd, (struct sockaddr *) addr, &addrlen) == 0);
+}
+
+static bool inet_peer_addr(const int fd, struct sockaddr_in *addr) {
+    socklen_t addrlen = sizeof(*addr);
+    return (getpeername(fd, (struct sockaddr *) addr, &addrlen) == 0);
+}
+
+#ifdef HARNESS_HAVE_SCTP
+static int sctp_send(const int fd, void *const *buffers,
+                     const size_t *lengths, const int num_messages,
+                     test_error_code_t *error) {
+    for (int i = 0; i < num_messages; i++) {
+        int rc = sctp_sendmsg(fd, buffers[i], lengths[i],
+                              NULL, 0, 0, 0, 0, 0, 0);
+        if (rc < 0) {
+            if ((errno == EAGAIN) || (errno == ENOBUFS)) { return i; }
+            *error = TEST_ERROR_MIXNET_CONNECTION_BROKEN;
+            return -1;
+        }
+        // SCTP transmission is non-atomic
+        else if (rc != (int) lengths[i]) {
+            *error = TEST_ERROR_SCTP_PARTIAL_DATA;
+            return -1;
+        }
+    }
+    return num_messages;
+}
+
+static int sctp_recv(const int fd, void *const *buffers,
+                     const size_t buffer_size, size_t *lengths,
+                     const int max_messages, test_error_code_t *error) {
+    for (int i = 0; i < max_messages; i++) {
+        int flags = 0;
+        int rc = sctp_recvmsg(fd, buffers[i], buffer_size,
+                              NULL, 0, NULL, &flags);
+        if (rc <= 0) {
+            if ((rc < 0) && ((errno == EAGAIN) || (errno == ENOBUFS))) {
+                return i;
+            }
+            *error = TEST_ERROR_MIXNET_CONNECTION_BROKEN;
+            return -1;
+        }
+        lengths[i] = rc;
+    }
+    return max_messages;
+}
+#endif
+
+/**
+ * Datagram transports (UDP and Unix seqpacket): a burst of messages
+ * takes a single sendmmsg (or recvmmsg) call. If lossy, a datagram the
+ * peer refused is dropped, rather than breaking the link.
+ */
+static int datagram_send_impl(const int fd, void *const *buffers,
+                              const size_t *lengths, const int num_messages,
+                              const bool is_lossy, test_error_code_t *error) {
+    struct mmsghdr msgs[HARNESS_TRANSPORT_MAX_BURST];
+    struct iovec iovs[HARNESS_TRANSPORT_MAX_BURST];
+    const int count = (num_messages < HARNESS_TRANSPORT_MAX_BURST) ?
+                      num_messages : HARNESS_TRANSPORT_MAX_BURST;
+
+    memset(msgs, 0, sizeof(struct mmsghdr) * count);
+    for (int i = 0; i < count; i++) {
+        iovs[i].iov_base = buffers[i];
+        iovs[i].iov_len = lengths[i];
+        msgs[i].msg_hdr.msg_iov = &(iovs[i]);
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    int rc = sendmmsg(fd, msgs, count, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (rc < 0) {
+        if ((errno == EAGAIN) || (errno == ENOBUFS)) { return 0; }
+        if (is_lossy && (errno == ECONNREFUSED)) { return 1; }
+        *error = TEST_ERROR_MIXNET_CONNECTION_BROKEN;
+        return -1;
+    }
+    return rc;
+}
+
+static int datagram_send(const int fd, void *const *buffers,
+                         const size_t *lengths, const int num_messages,
+                         test_error_code_t *error) {
+    return datagram_send_impl(fd, buffers, lengths,
+                              num_messages, false, error);
+}
+
+static int datagram_recv(const int fd, void *const *buffers,
+                         const size_t buffer_size, size_t *lengths,
+                         const int max_messages, test_error_code_t *error) {
+    struct mmsghdr msgs[HARNESS_TRANSPORT_MAX_BURST];
+    struct iovec iovs[HARNESS_TRANSPORT_MAX_BURST];
+    const int count = (max_messages < HARNESS_TRANSPORT_MAX_BURST) ?
+                      max_messages : HARNESS_TRANSPORT_MAX_BURST;
+
+    memset(msgs, 0, sizeof(struct mmsghdr) * count);
+    for (int i = 0; i < count; i++) {
+        iovs[i].iov_base = buffers[i];
+        iovs[i].iov_len = buffer_size;
+        msgs[i].msg_hdr.msg_iov = &(iovs[i]);
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    int rc = recvmmsg(fd, msgs, count, MSG_DONTWAIT, NULL);
+    if (rc < 0) {
+        if ((errno == EAGAIN) || (errno == ENOBUFS)) { return 0; }
+        *error = TEST_ERROR_MIXNET_CONNECTION_BROKEN;
+        return -1;
+    }
+    for (int i = 0; i < rc; i++) {
+        // No valid message is empty, so this is the peer hanging up
+        if (msgs[i].msg_len == 0) {
+            *error = TEST_ERROR_MIXNET_CONNECTION_BROKEN;
+            return -1;
+        }
+        lengths[i] = msgs[i].msg_len;
+    }
+    return rc;
+}
+
+/**
+ * UDP. Every TX socket is bound to the server's address (hence the
+ * SO_REUSEPORT), and connected to the neighbor's RX socket, which is
+ * itself connected to the server: so each RX socket only accepts its
+ * own neighbor's datagrams. Once that RX socket is closed (say, its
+ * node exited), the neighbor's host answers with ICMP port unreachable,
+ * which a later send reports as ECONNREFUSED: like any other loss on
+ * UDP, it is not an error.
+ */
+static int udp_socket(const bool reuse_port) {
+    int socket_fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK |
+                           SOCK_CLOEXEC, 0);
+    if (socket_fd == -1) { return -1; }
+
+    const int value = 1;
+    if (reuse_port && (setsockopt(socket_fd, SOL_SOCKET, SO_REUSEPORT,
+                                  &value, sizeof(value)) == -1)) {
+        close(socket_fd);
+        return -1;
+    }
+    return socket_fd;
+}
+
+static int udp_listen(struct sockaddr_in *addr, const int backlog) {
+    (void) backlog;
+    int socket_fd = udp_socket(true);
+    if (socket_fd < 0) { return -1; }
+
+    if ((bind(socket_fd, (struct sockaddr *) addr, sizeof(*addr)) == -1) ||
+        ((addr->sin_port == 0) && !inet_local_addr(socket_fd, addr))) {
+        close(socket_fd);
+        return -1;
+    }
+    return socket_fd;
+}
+
+static int udp_connect(const struct sockaddr_in *server_addr,
+                       const unsigned int timeout_ms) {
+    (void) timeout_ms;
+    int socket_fd = udp_socket(false);
+    if (socket_fd < 0) { return -1; }
+
+    // Best effort: a larger buffer absorbs longer bursts
+    setsockopt(socket_fd, SOL_SOCKET, SO_RCVBUF,
+               &UDP_RCVBUF_SIZE, sizeof(UDP_RCVBUF_SIZE));
+
+    if (connect(socket_fd, (const struct sockaddr *) server_addr,
+                sizeof(*server_addr)) == -1) {
+        close(socket_fd);
+        return -1;
+    }
+    return socket_fd;
+}
+
+static int udp_send(const int fd, void *const *buffers,
+                    const size_t *lengths, const int num_messages,
+                    test_error_code_t *error) {
+    return datagram_send_impl(fd, buffers, lengths,
+                              num_messages, true, error);
+}
+
+static int udp_open_tx(const struct sockaddr_in *server_addr,
+                       const struct sockaddr_in *client_addr) {
+    int socket_fd = udp_socket(true);
+    if (socket_fd < 0) { return -1; }
+
+    if ((bind(socket_fd, (const struct sockaddr *) server_addr,
+              sizeof(*server_addr)) == -1) ||
+        (connect(socket_fd, (const struct sockaddr *) client_addr,
+                 sizeof(*client_addr)) == -1)) {
+        close(socket_fd);
+        return -1;
+    }
+    return socket_fd;
+}
+
+/**
+ * Unix seqpacket. Sockets are bound to abstract names that embed a port
+ * number (see harness_unix_name); this only works between nodes on the
+ * same host.
+ */
+static int unix_socket(void) {
+    return socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+}
+
+static int unix_listen(struct sockaddr_in *addr, const int backlog) {
+    int socket_fd = unix_socket();
+    if (socket_fd < 0) { return -1; }
+
+    uint16_t port = ntohs(addr->sin_port);
+    if (!harness_unix_bind(socket_fd, &port) ||
+        (listen(socket_fd, backlog) == -1)) {
+        close(socket_fd);
+        return -1;
+    }
+    addr->sin_port = htons(port);
+    return socket_fd;
+}
+
+static int unix_connect(const struct sockaddr_in *server_addr,
+                        const unsigned int timeout_ms) {
+    int socket_fd = unix_socket();
+    if (socket_fd < 0) { return -1; }
+
+    // Bind first, so the server can tell its clients apart
+    uint16_t port = 0;
+    if (!harness_unix_bind(socket_fd, &port) ||
+        (harness_unix_connect(socket_fd, ntohs(server_addr->sin_port),
+                              timeout_ms) < 0)) {
+        close(socket_fd);
+        return -1;
+    }
+    return socket_fd;
+}
+
+static bool unix_local_addr(const int fd, struct sockaddr_in *addr) {
+    struct sockaddr_un name;
+    socklen_t namelen = sizeof(name);
+    return ((getsockname(fd, (struct sockaddr *) &name, &namelen) == 0) &&
+            harness_unix_parse_name(&name, namelen, addr));
+}
+
+static bool unix_peer_addr(const int fd, struct sockaddr_in *addr) {
+    struct sockaddr_un name;
+    socklen_t namelen = sizeof(name);
+    return ((getpeername(fd, (struct sockaddr *) &name, &namelen) == 0) &&
+            harness_unix_parse_name(&name, namelen, addr));
+}
+
+// Transports that weren't built are left zeroed (with no name)
+static const struct harness_transport transports[HARNESS_TRANSPORT_COUNT] = {
+#ifdef HARNESS_HAVE_SCTP
+    [HARNESS_TRANSPORT_SCTP] = {
+        .name = "sctp",
+        .is_connection_oriented = true,
+        .listen = &sctp_listen,
+        .connect = &sctp_connect,
+        .local_addr = &inet_local_addr,
+        .peer_addr = &inet_peer_addr,
+        .open_tx = NULL,
+        .send = &sctp_send,
+        .recv = &sctp_recv,
+    },
+#endif
+    [HARNESS_TRANSPORT_UDP] = {
+        .name = "udp",
+        .is_connection_oriented = false,
+        .listen = &udp_listen,
+        .connect = &udp_connect,
+        .local_addr = &inet_local_addr,
+        .peer_addr = &inet_peer_addr,
+        .open_tx = &udp_open_tx,
+        .send = &udp_send,
+        .recv = &datagram_recv,
+    },
+    [HARNESS_TRANSPORT_UNIX] = {
+        .name = "unix",
+        .is_connection_oriented = true,
+        .listen = &unix_listen,
+        .connect = &unix_connect,
+        .local_addr = &unix_local_addr,
+        .peer_addr = &unix_peer_addr,
+        .open_tx = NULL,
+        .send = &datagram_send,
+        .recv = &datagram_recv,
+    },
+};
+
+const struct harness_transport *
+harness_transport_get(const enum harness_transport_enum type) {
+    if (((unsigned int) type >= HARNESS_TRANSPORT_COUNT) ||
+        (transports[type].name == NULL)) { return NULL; }
+    return &(transports[type]);
+}
+
+bool harness_transport_from_name(const char *name,
+                                 enum harness_transport_enum *type) {
+    for (int t = 0; t < HARNESS_TRANSPORT_COUNT; t++) {
+        if ((transports[t].name != NULL) &&
+            (strcmp(name, transports[t].name) == 0)) {
+            *type = (enum harness_transport_enum) t;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,137 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the Mixnet course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the Mixnet project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#ifndef HARNESS_TRANSPORT_H
+#define HARNESS_TRANSPORT_H
+
+#include "error.h"
+
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Most messages moved by a single send or recv call
+#define HARNESS_TRANSPORT_MAX_BURST 64
+
+/**
+ * Transports for the links between neighboring Mixnet nodes (the ctrl
+ * and pcap overlays use SCTP, or Unix seqpacket sockets if the harness
+ * is built without SCTP; see harness_socket).
+ */
+enum harness_transport_enum {
+    HARNESS_TRANSPORT_SCTP = 0,     // One-to-one SCTP (if built)
+    HARNESS_TRANSPORT_UDP,          // UDP, batched with sendmmsg/recvmmsg
+    HARNESS_TRANSPORT_UNIX,         // AF_UNIX SOCK_SEQPACKET (same host only)
+    HARNESS_TRANSPORT_COUNT,
+};
+
+// Links use SCTP by default, where it is available
+#ifdef HARNESS_HAVE_SCTP
+#define HARNESS_TRANSPORT_DEFAULT HARNESS_TRANSPORT_SCTP
+#else
+#define HARNESS_TRANSPORT_DEFAULT HARNESS_TRANSPORT_UNIX
+#endif
+
+/**
+ * Transport operations. Every link is a pair of non-blocking sockets:
+ * an RX one, which this node connects to the neighbor's server, and a
+ * TX one on this node's server, which the neighbor's RX socket talks
+ * to. Endpoints are always named by IPv4 addresses, so the orchestrator
+ * can match them up the same way for every transport.
+ */
+struct harness_transport {
+    const char *name;
+
+    // Whether TX sockets are accepted from the server socket. If not,
+    // they are opened (see open_tx) once the neighbors' client
+    // addresses are resolved.
+    bool is_connection_oriented;
+
+    /**
+     * Server side: opens a socket for up to backlog neighbors, bound
+     * to addr (an ephemeral port, if zero; written back).
+     *
+     * @return Socket FD, or -1 on error
+     */
+    int (*listen)(struct sockaddr_in *addr, const int backlog);
+
+    /**
+     * Client side: opens an RX socket connected to a neighbor's server.
+     *
+     * @return Socket FD, or -1 on error (or timeout)
+     */
+    int (*connect)(const struct sockaddr_in *server_addr,
+                   const unsigned int timeout_ms);
+
+    /**
+     * Returns the address by which the neighbor knows a client (the
+     * local end of an RX socket), or that of an accepted connection's
+     * client (its remote end).
+     *
+     * @return True on success, else false
+     */
+    bool (*local_addr)(const int fd, struct sockaddr_in *addr);
+    bool (*peer_addr)(const int fd, struct sockaddr_in *addr);
+
+    /**
+     * Connectionless transports: opens a TX socket from this node's
+     * server address to a neighbor's client address.
+     *
+     * @return Socket FD, or -1 on error
+     */
+    int (*open_tx)(const struct sockaddr_in *server_addr,
+                   const struct sockaddr_in *client_addr);
+
+    /**
+     * Sends up to num_messages messages (in order), each atomically.
+     *
+     * @return Number of messages sent (0 if the socket buffer is full),
+     *         or -1 if the link is broken (error is set)
+     */
+    int (*send)(const int fd, void *const *buffers, const size_t *lengths,
+                const int num_messages, test_error_code_t *error);
+
+    /**
+     * Receives up to max_messages messages (in order), each into its
+     * own buffer of buffer_size bytes. Their lengths are written out.
+     *
+     * @return Number of messages received (0 if none are waiting), or
+     *         -1 if the link is broken (error is set)
+     */
+    int (*recv)(const int fd, void *const *buffers, const size_t buffer_size,
+                size_t *lengths, const int max_messages,
+                test_error_code_t *error);
+};
+
+/**
+ * Returns the operations for a transport (or NULL, if unknown or not
+ * built).
+ */
+const struct harness_transport *
+harness_transport_get(const enum harness_transport_enum type);
+
+/**
+ * Parses a transport's name ("sctp", "udp", or "unix").
+ *
+ * @return True on success, else false
+ */
+bool harness_transport_from_name(const char *name,
+                                 enum harness_transport_enum *type);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HARNESS_TRANSPORT_H
@@ -33,10 +33,16 @@ struct mixnet_node_config {
     // STP parameters
     uint32_t root_hello_interval_ms; // Time (in ms) between 'hello' messages
     uint32_t reelection_interval_ms; // Time (in ms) before starting reelection
+    bool use_rapid_stp; // Whether to run rapid STP (proposal/agreement)
 
     // Routing parameters
     bool use_random_routing; // Whether this node should perform random routing
+    bool use_ecmp; // Whether to spread flows across equal-cost paths
     uint16_t mixing_factor; // The exact number of (non-control) packets to mix
+
+    // Data plane parameters
+    uint16_t num_rx_workers; // Threads receiving on the ports (0: the node's)
+    uint8_t transport; // Neighbor link transport (see harness/transport.h)
 };
 
 #ifdef __cplusplus
@@ -13,155 +13,435 @@
 #include "config.h"
 #include "harness/fragment.h"
 #include "packet.h"
+#include "packet_pool.h"
 
-#include <errno.h>
 #include <netinet/in.h>
-#include <netinet/sctp.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+// Constant parameters
+static const int RX_WORKER_BURST_SIZE = 16; // Packets read per ready port
+// Consumes up to max_packets packets injected on the user port (the
+// ctrl thread allocates them, so they are handed over without a copy)
+static int recv_user_packets(struct fragment_context *ctx,
+                             mixnet_packet **packets,
+                             const int max_packets) {
+    int num_recvd = 0;
+    while (num_recvd < max_packets) {
+        void **ptr = ((void **)
+            message_queue_tryread(&(ctx->mq_app_packets)));
 
-int mixnet_recv(void *handle, uint8_t *port, mixnet_packet **packet) {
-    // Fetch the fragment context
-    struct fragment_context *ctx = (
-        (struct fragment_context*) handle);
+        if (ptr == NULL) { break; }
+        packets[num_recvd++] = (mixnet_packet *) *ptr;
+        message_queue_message_free(&(ctx->mq_app_packets), ptr);
+    }
+    return num_recvd;
+}
 
-    struct mixnet_context *subctx = &(ctx->mixnet_ctx);
-    struct mixnet_node_config *config = &(subctx->config);
+/**
+ * Counts packet buffers handed out. Any of the node's threads may
+ * allocate (or free) its packets, hence the atomic updates.
+ */
+static void count_packet_allocs(struct mixnet_stats *stats,
+                                const uint64_t num_packets) {
+    const uint64_t allocs = __atomic_add_fetch(
+        &(stats->pkt_allocs), num_packets, __ATOMIC_RELAXED);
+    const uint64_t live = (allocs - __atomic_load_n(
+        &(stats->pkt_frees), __ATOMIC_RELAXED));
+
+    uint64_t peak = __atomic_load_n(&(stats->pkt_peak_live),
+                                    __ATOMIC_RELAXED);
+    while ((live > peak) &&
+           !__atomic_compare_exchange_n(&(stats->pkt_peak_live), &peak, live,
+                                        true, __ATOMIC_RELAXED,
+                                        __ATOMIC_RELAXED)) {}
+}
 
-    // Attempt to receive on the input ports in a round-robin fashion
-    const uint16_t max_port_id = config->num_neighbors;
-    const uint16_t stop_idx = subctx->next_port_idx;
+/**
+ * Receives up to max_packets packets waiting on a regular port (if its
+ * link is up), straight into full-sized pool buffers, in bursts of as
+ * many as the link's transport takes per call. The port's mutex is
+ * only taken once for the whole batch. Called by the node thread, or
+ * by the port's RX worker.
+ *
+ * @return Number of packets received (handed over as-is), or -1 if the
+ *         connection is unusable (error is set, and packets received
+ *         during this call are returned to the pool)
+ */
+static int recv_on_port(struct fragment_context *ctx, const uint16_t port,
+                        mixnet_packet **packets, const int max_packets,
+                        test_error_code_t *error) {
+    struct mixnet_context *subctx = &(ctx->mixnet_ctx);
+    pthread_mutex_t *mutex = &(subctx->port_mutexes[port]);
+    *error = TEST_ERROR_NONE;
     int num_recvd = 0;
-    do {
-        // This is the application-level data port
-        if (subctx->next_port_idx == max_port_id) {
-            // Consume a packet from the MQ
-            mixnet_packet *mq_packet = ((mixnet_packet *)
-                message_queue_tryread(&(ctx->mq_app_packets)));
-
-            // Valid packet
-            if (mq_packet != NULL) {
-                num_recvd++;
-                *port = subctx->next_port_idx;
-                *packet = malloc(MAX_MIXNET_PACKET_SIZE);
-                memcpy(*packet, mq_packet, MAX_MIXNET_PACKET_SIZE);
-
-                message_queue_message_free(&(ctx->mq_app_packets),
-                                           (void*) mq_packet);
+
+    // The link state (and draining the socket when the link goes
+    // down) is guarded by the port's mutex.
+    pthread_mutex_lock(mutex); // Acquire mutex
+    if (!subctx->link_states[port]) {
+        pthread_mutex_unlock(mutex);
+        return 0;
+    }
+    while ((num_recvd < max_packets) && (*error == TEST_ERROR_NONE)) {
+        mixnet_packet **buffers = &(packets[num_recvd]);
+        size_t lengths[HARNESS_TRANSPORT_MAX_BURST];
+        int num_buffers = 0;
+
+        const int burst = ((max_packets - num_recvd) <
+                           HARNESS_TRANSPORT_MAX_BURST) ?
+                          (max_packets - num_recvd) :
+                          HARNESS_TRANSPORT_MAX_BURST;
+        for (; num_buffers < burst; num_buffers++) {
+            buffers[num_buffers] = packet_pool_alloc(
+                MAX_MIXNET_PACKET_SIZE, &(subctx->stats.pkt_reserved_bytes));
+            if (buffers[num_buffers] == NULL) { break; }
+        }
+        if (num_buffers == 0) { break; }
+
+        int rc = subctx->transport->recv(subctx->rx_socket_fds[port],
+                                         (void *const *) buffers,
+                                         MAX_MIXNET_PACKET_SIZE, lengths,
+                                         num_buffers, error);
+        for (int i = 0; i < rc; i++) {
+            // Validate the packet header
+            const size_t total_size = (sizeof(mixnet_packet) +
+                                       buffers[i]->payload_size);
+
+            // We discard packets with size larger than MTU
+            // on the TX side, so this case shouldn't arise
+            // unless something went seriously wrong.
+            if (total_size > MAX_MIXNET_PACKET_SIZE) {
+                *error = TEST_ERROR_MIXNET_INVALID_PACKET_SIZE;
             }
+            // The message was truncated (SCTP transmission
+            // is non-atomic)
+            else if (lengths[i] != total_size) {
+                *error = TEST_ERROR_SCTP_PARTIAL_DATA;
+            }
+        }
+        // Return the buffers that were not filled
+        const int num_filled = (rc > 0) ? rc : 0;
+        for (int i = num_filled; i < num_buffers; i++) {
+            packet_pool_free(buffers[i]);
         }
-        // This is a regular port
-        else {
-            pthread_mutex_t *mutex = &(subctx->
-                port_mutexes[subctx->next_port_idx]);
-
-            // SCTP socket operations are supposed to be thread-safe,
-            // so guarding the recv call with a mutex isn't strictly
-            // necessary. But leaving this here in case we switch to
-            // standard UNIX sockets, etc.
-            pthread_mutex_lock(mutex); // Acquire mutex
-            bool is_link_enabled = subctx->link_states[
-                subctx->next_port_idx];
-
-            if (is_link_enabled) {
-                int rc = 0;
-                int flags = 0;
-                rc = sctp_recvmsg(
-                    subctx->rx_socket_fds[subctx->next_port_idx],
-                    subctx->packet_buffer, MAX_MIXNET_PACKET_SIZE,
-                    NULL, 0, NULL, &flags);
-
-                // Release mutex
-                pthread_mutex_unlock(mutex);
+        num_recvd += num_filled;
+        if (num_filled < num_buffers) { break; } // Drained
+    }
+    // Release mutex
+    pthread_mutex_unlock(mutex);
 
-                if (rc < 0) {
-                    if ((errno != EAGAIN) && (errno != ENOBUFS)) {
-                        ctx->ts_node.error_code = (
-                            TEST_ERROR_MIXNET_CONNECTION_BROKEN);
+    if (*error != TEST_ERROR_NONE) {
+        for (int i = 0; i < num_recvd; i++) {
+            packet_pool_free(packets[i]);
+        }
+        return -1;
+    }
+    count_packet_allocs(&(subctx->stats), num_recvd);
+    return num_recvd;
+}
 
-                        ctx->ts_node.exited = true;
-                        pthread_exit(NULL);
-                    }
-                }
-                else if (rc == 0) {
-                    ctx->ts_node.error_code = (
-                        TEST_ERROR_MIXNET_CONNECTION_BROKEN);
+/**
+ * Waits (up to timeout_ms) for readiness on the node thread's epoll
+ * instance, and records which RX sockets are readable. The eventfd is
+ * consumed here; the user port's MQ is always checked anyway, since
+ * that costs no syscall.
+ *
+ * @return Number of events (0 on timeout, or -1 on EINTR)
+ */
+static int poll_readiness(struct mixnet_context *subctx,
+                          const int timeout_ms) {
+    const uint16_t user_port = subctx->config.num_neighbors;
+    struct epoll_event events[MAX_NUM_NEIGHBORS + 2];
+    int num_events = epoll_wait(subctx->epoll_fd, events,
+                                sizeof(events) / sizeof(events[0]),
+                                timeout_ms);
+
+    for (int i = 0; i < num_events; i++) {
+        const uint32_t id = events[i].data.u32;
+        if (id < user_port) {
+            subctx->rx_ready_ports |= (UINT64_C(1) << id);
+        }
+        else if (id == user_port) {
+            eventfd_t value;
+            eventfd_read(subctx->notify_fd, &value);
+        }
+        // Else, a watched TX socket is writable (the caller retries)
+    }
+    return num_events;
+}
+
+/**
+ * Receives on the node's own ports (user port included), sweeping them
+ * round-robin from next_port_idx. Regular ports are only read if the
+ * last poll reported them readable (and until they run dry), so idle
+ * ports cost no syscalls. Each sweep takes at most an equal share of
+ * the batch from any one port, and the next sweep (or call) resumes
+ * after the last port served, which keeps the ports fair. A port is
+ * only swept again if it filled its share last time.
+ */
+static int recv_batch_on_ports(struct fragment_context *ctx, uint8_t *ports,
+                               mixnet_packet **packets,
+                               const int max_packets) {
+    struct mixnet_context *subctx = &(ctx->mixnet_ctx);
+    const uint16_t max_port_id = subctx->config.num_neighbors;
+    const int num_ports = (max_port_id + 1);
+    const int share = ((max_packets > num_ports) ?
+                       (max_packets / num_ports) : 1);
 
+    int num_recvd = 0;
+    bool is_more = true; // Might a port have more waiting?
+    while ((num_recvd < max_packets) && is_more) {
+        const uint16_t stop_idx = subctx->next_port_idx;
+        is_more = false;
+        do {
+            const uint16_t idx = subctx->next_port_idx;
+            const int limit = ((max_packets - num_recvd) < share) ?
+                              (max_packets - num_recvd) : share;
+            int rc = 0;
+
+            // This is the application-level data port
+            if (idx == max_port_id) {
+                rc = recv_user_packets(ctx, &(packets[num_recvd]), limit);
+            }
+            // This is a regular port with packets waiting
+            else if ((subctx->rx_ready_ports >> idx) & 1) {
+                test_error_code_t error = TEST_ERROR_NONE;
+                rc = recv_on_port(ctx, idx, &(packets[num_recvd]),
+                                  limit, &error);
+                if (rc < 0) {
+                    ctx->ts_node.error_code = error;
                     ctx->ts_node.exited = true;
                     pthread_exit(NULL);
                 }
-                else {
-                    // Validate the packet header
-                    mixnet_packet *header = (
-                        (mixnet_packet *) subctx->packet_buffer);
-
-                    const size_t total_size = (sizeof(mixnet_packet) +
-                                               header->payload_size);
-
-                    // We discard packets with size larger than MTU
-                    // on the TX side, so this case shouldn't arise
-                    // unless something went seriously wrong.
-                    if (total_size > MAX_MIXNET_PACKET_SIZE) {
-                        ctx->ts_node.error_code = (
-                            TEST_ERROR_MIXNET_INVALID_PACKET_SIZE);
-
-                        ctx->ts_node.exited = true;
-                        pthread_exit(NULL);
-                    }
-                    // SCTP transmission is non-atomic
-                    else if (rc != (int) total_size) {
-                        ctx->ts_node.error_code = TEST_ERROR_SCTP_PARTIAL_DATA;
-                        ctx->ts_node.exited = true;
-                        pthread_exit(NULL);
-                    }
-                    else {
-                        // Valid packet
-                        num_recvd++;
-                        *packet = malloc(total_size);
-                        *port = subctx->next_port_idx;
-                        memcpy(*packet, subctx->packet_buffer, total_size);
-                    }
+                // Drained (or the link is down)
+                if (rc < limit) {
+                    subctx->rx_ready_ports &= ~(UINT64_C(1) << idx);
                 }
             }
-            // Release mutex
-            else { pthread_mutex_unlock(mutex); }
+            for (int i = num_recvd; i < (num_recvd + rc); i++) {
+                ports[i] = idx;
+                mixnet_stats_count_packet(&(subctx->stats), false, idx,
+                    packets[i]->type, (sizeof(mixnet_packet) +
+                                       packets[i]->payload_size));
+            }
+            num_recvd += rc;
+            is_more |= (rc == limit);
+            subctx->next_port_idx = fragment_next_port_idx(
+                idx, max_port_id);
+
+        } while ((num_recvd < max_packets) &&
+                 (subctx->next_port_idx != stop_idx));
+    }
+    return num_recvd;
+}
+
+/**
+ * Consumes up to max_packets packets queued by the RX workers, along
+ * with their ports. Packets that arrived before their link went down
+ * are dropped (in single-threaded mode, those are never received).
+ * Like mixnet_link_is_up, this reads link states without the port
+ * mutex: a packet racing with the link going down may get through,
+ * as it could have a moment earlier.
+ */
+static int recv_worker_packets(struct fragment_context *ctx,
+                               uint8_t *ports, mixnet_packet **packets,
+                               const int max_packets) {
+    const volatile bool *link_states = ctx->mixnet_ctx.link_states;
+    int num_recvd = 0;
+    while (num_recvd < max_packets) {
+        struct fragment_rx_message *message = (
+            message_queue_tryread(&(ctx->mq_rx_packets)));
+
+        if (message == NULL) { break; }
+        const uint16_t nid = message->port;
+        mixnet_packet *packet = message->packet;
+        message_queue_message_free(&(ctx->mq_rx_packets), message);
+
+        if (!link_states[nid]) { mixnet_packet_free(ctx, packet); continue; }
+        ports[num_recvd] = nid;
+        packets[num_recvd++] = packet;
+    }
+    return num_recvd;
+}
+
+/**
+ * RX worker mode: the workers own the regular ports, so the node
+ * thread alternates between the user port and the packets they
+ * queued, draining up to half the batch from either in turn (and
+ * counting them here, so the stats keep a single writer).
+ */
+static int recv_from_workers(struct fragment_context *ctx, uint8_t *ports,
+                             mixnet_packet **packets,
+                             const int max_packets) {
+    struct mixnet_context *subctx = &(ctx->mixnet_ctx);
+    const uint16_t user_port = subctx->config.num_neighbors;
+    const int share = ((max_packets > 1) ? (max_packets / 2) : 1);
+
+    int num_recvd = 0;
+    bool is_more = true; // Might either source have more waiting?
+    while ((num_recvd < max_packets) && is_more) {
+        is_more = false;
+        for (int turn = 0; (turn < 2) && (num_recvd < max_packets); turn++) {
+            const bool is_user_port = (subctx->next_port_idx == user_port);
+            subctx->next_port_idx = (is_user_port ? 0 : user_port);
+            const int limit = ((max_packets - num_recvd) < share) ?
+                              (max_packets - num_recvd) : share;
+            int rc = 0;
+
+            if (is_user_port) {
+                rc = recv_user_packets(ctx, &(packets[num_recvd]), limit);
+                for (int i = num_recvd; i < (num_recvd + rc); i++) {
+                    ports[i] = user_port;
+                }
+            }
+            else {
+                rc = recv_worker_packets(ctx, &(ports[num_recvd]),
+                                         &(packets[num_recvd]), limit);
+            }
+            for (int i = num_recvd; i < (num_recvd + rc); i++) {
+                mixnet_stats_count_packet(&(subctx->stats), false, ports[i],
+                    packets[i]->type, (sizeof(mixnet_packet) +
+                                       packets[i]->payload_size));
+            }
+            num_recvd += rc;
+            is_more |= (rc == limit);
         }
-        subctx->next_port_idx = fragment_next_port_idx(
-            subctx->next_port_idx, config->num_neighbors);
+    }
+    return num_recvd;
+}
 
-    } while ((num_recvd == 0) &&
-             (subctx->next_port_idx != stop_idx));
+// Receives whatever is known to be ready (without polling)
+static int recv_batch(struct fragment_context *ctx, uint8_t *ports,
+                      mixnet_packet **packets, const int max_packets) {
+    struct mixnet_context *subctx = &(ctx->mixnet_ctx);
+    const int num_recvd = ((subctx->config.num_rx_workers == 0) ?
+        recv_batch_on_ports(ctx, ports, packets, max_packets) :
+        recv_from_workers(ctx, ports, packets, max_packets));
 
+    if (num_recvd > 0) { mixnet_stats_add(&(subctx->stats.rx_batches), 1); }
     return num_recvd;
 }
 
-int mixnet_send(void *handle, const uint8_t port, mixnet_packet *packet) {
+int mixnet_recv_batch(void *handle, uint8_t *ports,
+                      mixnet_packet **packets, const int max_packets) {
     // Fetch the fragment context
     struct fragment_context *ctx = (
         (struct fragment_context*) handle);
 
-    struct mixnet_context *subctx = &(ctx->mixnet_ctx);
-    struct mixnet_node_config *config = &(subctx->config);
+    if (max_packets <= 0) { return 0; }
 
-    const uint16_t max_port_id = config->num_neighbors;
-    if (port > max_port_id) { return -1; } // Invalid port ID
+    // Refresh readiness first (a single syscall, however many ports).
+    // RX workers poll their own ports, so there is nothing to refresh.
+    if (ctx->mixnet_ctx.config.num_rx_workers == 0) {
+        poll_readiness(&(ctx->mixnet_ctx), 0);
+    }
+    return recv_batch(ctx, ports, packets, max_packets);
+}
+
+int mixnet_recv_batch_timeout(void *handle, uint8_t *ports,
+                              mixnet_packet **packets,
+                              const int max_packets, const int timeout_ms) {
+    int num_recvd = mixnet_recv_batch(handle, ports, packets, max_packets);
+    if ((num_recvd != 0) || (timeout_ms == 0)) { return num_recvd; }
+
+    // Fetch the fragment context
+    struct fragment_context *ctx = (
+        (struct fragment_context*) handle);
+
+    // Nothing ready, wait for readiness. The eventfd is signalled
+    // *after* user packets (or those from RX workers) are enqueued,
+    // so consuming the signal before polling again cannot lose a
+    // wakeup.
+    if (poll_readiness(&(ctx->mixnet_ctx), timeout_ms) <= 0) {
+        return 0; // Timeout (or EINTR)
+    }
+    return recv_batch(ctx, ports, packets, max_packets);
+}
+
+int mixnet_recv(void *handle, uint8_t *port, mixnet_packet **packet) {
+    return mixnet_recv_batch(handle, port, packet, 1);
+}
+
+int mixnet_recv_timeout(void *handle, uint8_t *port,
+                        mixnet_packet **packet, const int timeout_ms) {
+    return mixnet_recv_batch_timeout(handle, port, packet, 1, timeout_ms);
+}
+
+void *fragment_rx_worker(void *args) {
+    struct fragment_rx_worker *worker = (struct fragment_rx_worker*) args;
+    struct fragment_context *ctx = worker->ctx;
+    struct mixnet_context *subctx = &(ctx->mixnet_ctx);
+    const uint16_t stop_id = subctx->config.num_neighbors;
+    mixnet_packet *packets[RX_WORKER_BURST_SIZE];
+    worker->ts.started = true;
+
+    while (worker->ts.keep_running) {
+        struct epoll_event events[16];
+        int num_events = epoll_wait(worker->epoll_fd, events,
+                                    sizeof(events) / sizeof(events[0]), -1);
+        int num_queued = 0;
+
+        for (int i = 0; i < num_events; i++) {
+            const uint16_t nid = events[i].data.u32;
+            if (nid == stop_id) { continue; }
+
+            // Bound the burst, so one busy port can't starve the others
+            test_error_code_t error = TEST_ERROR_NONE;
+            int num_recvd = recv_on_port(ctx, nid, packets,
+                                         RX_WORKER_BURST_SIZE, &error);
+            if (num_recvd < 0) {
+                worker->ts.error_code = error;
+                worker->ts.exited = true;
+                return NULL;
+            }
+            for (int j = 0; j < num_recvd; j++) {
+                // If the MQ is full, wake the node thread up (it may not
+                // know about the packets queued so far) before waiting
+                struct fragment_rx_message *message = (
+                    message_queue_message_alloc(&(ctx->mq_rx_packets)));
+                if (message == NULL) {
+                    fragment_notify_node(ctx);
+                    message = message_queue_message_alloc_blocking(
+                        &(ctx->mq_rx_packets));
+                }
+                message->packet = packets[j];
+                message->port = nid;
+                message_queue_write(&(ctx->mq_rx_packets), message);
+            }
+            num_queued += num_recvd;
+        }
+        if (num_queued > 0) { fragment_notify_node(ctx); }
+    }
+    worker->ts.exited = true;
+    return NULL;
+}
 
-    mixnet_packet *header = (mixnet_packet *) packet;
-    const size_t total_size = sizeof(*header) + header->payload_size;
+/**
+ * Checks a packet against its type's specification.
+ */
+static bool is_valid_packet(const mixnet_packet *packet) {
+    const size_t total_size = sizeof(*packet) + packet->payload_size;
 
     // Incorrect packet size
-    if (total_size > MAX_MIXNET_PACKET_SIZE) { return -1; }
+    if (total_size > MAX_MIXNET_PACKET_SIZE) { return false; }
 
     // Check type specifications
     switch (packet->type) {
     case PACKET_TYPE_STP: {
-        // Incorrect payload size
-        if (packet->payload_size != 6) { return -1; }
+        // Incorrect payload size (rapid STP appends the port flags)
+        if ((packet->payload_size != 6) &&
+            (packet->payload_size != 8)) { return false; }
     } break;
 
     case PACKET_TYPE_FLOOD: {
-        // Incorrect payload size
-        if (packet->payload_size != 0) { return -1; }
+        // Incorrect payload size (untagged, or tagged between nodes)
+        if ((packet->payload_size != 0) &&
+            (packet->payload_size != sizeof(mixnet_packet_flood))) {
+            return false;
+        }
     } break;
 
     case PACKET_TYPE_LSA: {
@@ -169,8 +449,8 @@ int mixnet_send(void *handle, const uint8_t port, mixnet_packet *packet) {
         mixnet_packet_lsa *header = (
             (mixnet_packet_lsa *) packet->payload);
 
-        if ((4 + (2 * header->neighbor_count)) !=
-            packet->payload_size) { return -1; }
+        if ((sizeof(mixnet_packet_lsa) + (2 * header->neighbor_count)) !=
+            packet->payload_size) { return false; }
     } break;
 
     case PACKET_TYPE_DATA: break;
@@ -181,20 +461,78 @@ int mixnet_send(void *handle, const uint8_t port, mixnet_packet *packet) {
             (mixnet_packet_routing_header *) packet->payload);
 
         if (((4 + (2 * header->route_length)) + 10) !=
-            packet->payload_size) { return -1; }
+            packet->payload_size) { return false; }
     } break;
 
     // Unknown packet type
-    default: { return -1; } break;
+    default: { return false; } break;
+    }
+    return true;
+}
+
+/**
+ * Sends (valid) packets on a regular port, in order, in a single burst
+ * of at most HARNESS_TRANSPORT_MAX_BURST packets. Doesn't take ownership
+ * of them unless the connection breaks (in which case they are freed,
+ * and the node thread exits).
+ *
+ * @return Number of packets sent (0 if the socket buffer is full)
+ */
+static int send_on_port(struct fragment_context *ctx, const uint8_t port,
+                        mixnet_packet *const *packets,
+                        const int num_packets) {
+    struct mixnet_context *subctx = &(ctx->mixnet_ctx);
+    size_t lengths[HARNESS_TRANSPORT_MAX_BURST];
+    const int burst = (num_packets < HARNESS_TRANSPORT_MAX_BURST) ?
+                      num_packets : HARNESS_TRANSPORT_MAX_BURST;
+
+    for (int i = 0; i < burst; i++) {
+        lengths[i] = sizeof(mixnet_packet) + packets[i]->payload_size;
     }
+    // Attempt to send the messages
+    test_error_code_t error = TEST_ERROR_NONE;
+    int rc = subctx->transport->send(subctx->tx_socket_fds[port],
+                                     (void *const *) packets, lengths,
+                                     burst, &error);
+    if (rc < 0) {
+        ctx->ts_node.error_code = error;
+        ctx->ts_node.exited = true;
+        for (int i = 0; i < num_packets; i++) {
+            mixnet_packet_free(ctx, packets[i]);
+        }
+        pthread_exit(NULL);
+    }
+    // The socket buffer filled up
+    if (rc < burst) { mixnet_stats_add(&(subctx->stats.tx_eagain), 1); }
+
+    for (int i = 0; i < rc; i++) {
+        mixnet_stats_count_packet(&(subctx->stats), true, port,
+                                  packets[i]->type, lengths[i]);
+    }
+    return rc;
+}
+
+int mixnet_send(void *handle, const uint8_t port, mixnet_packet *packet) {
+    // Fetch the fragment context
+    struct fragment_context *ctx = (
+        (struct fragment_context*) handle);
+
+    struct mixnet_context *subctx = &(ctx->mixnet_ctx);
+    struct mixnet_node_config *config = &(subctx->config);
+
+    const uint16_t max_port_id = config->num_neighbors;
+    if (port > max_port_id) { return -1; } // Invalid port ID
+    if (!is_valid_packet(packet)) { return -1; }
 
     // This is the application-level data port
     if (port == max_port_id) {
-        if ((header->type != PACKET_TYPE_FLOOD) &&
-            (header->type != PACKET_TYPE_DATA) &&
-            (header->type != PACKET_TYPE_PING)) {
+        if ((packet->type != PACKET_TYPE_FLOOD) &&
+            (packet->type != PACKET_TYPE_DATA) &&
+            (packet->type != PACKET_TYPE_PING)) {
             return -1;
         }
+        mixnet_stats_count_packet(&(subctx->stats), true, port, packet->type,
+                                  (sizeof(*packet) + packet->payload_size));
         // If the orchestrator is subscribed to pcap updates
         // from this node, then mirror this packet to the MQ.
         if (subctx->is_pcap_subscribed) {
@@ -210,40 +548,153 @@ int mixnet_send(void *handle, const uint8_t port, mixnet_packet *packet) {
                     TEST_ERROR_FRAGMENT_PCAP_MQ_FULL);
 
                 ctx->ts_node.exited = true;
-                free(packet); pthread_exit(NULL);
+                mixnet_packet_free(ctx, packet); pthread_exit(NULL);
             }
             *ptr = packet; // Enque the packet
             message_queue_write(&(ctx->mq_pcap), ptr);
         }
         // Else, simply free the packet
-        else { free(packet); }
+        else { mixnet_packet_free(ctx, packet); }
         return 1;
     }
     // Regular port
-    else {
-        // Attempt to send the message
-        int rc = sctp_sendmsg(subctx->tx_socket_fds[port],
-                              packet, total_size,
-                              NULL, 0, 0, 0, 0, 0, 0);
-        if (rc < 0) {
-            if ((errno != EAGAIN) && (errno != ENOBUFS)) {
-                ctx->ts_node.error_code = TEST_ERROR_MIXNET_CONNECTION_BROKEN;
-                ctx->ts_node.exited = true;
-                free(packet);
+    else if (send_on_port(ctx, port, &packet, 1) == 1) {
+        mixnet_packet_free(ctx, packet);
+        return 1;
+    }
+    return 0;
+}
 
-                pthread_exit(NULL);
-            }
-        }
-        // SCTP transmission is non-atomic
-        else if (rc != (int) total_size) {
-            ctx->ts_node.error_code = TEST_ERROR_SCTP_PARTIAL_DATA;
-            ctx->ts_node.exited = true;
-            free(packet);
+int mixnet_send_batch(void *handle, const uint8_t port,
+                      mixnet_packet **packets, const int num_packets) {
+    // Fetch the fragment context
+    struct fragment_context *ctx = (
+        (struct fragment_context*) handle);
+
+    struct mixnet_context *subctx = &(ctx->mixnet_ctx);
+    const uint16_t max_port_id = subctx->config.num_neighbors;
+    if (port > max_port_id) { return -1; } // Invalid port ID
+    if (num_packets <= 0) { return 0; }
 
-            pthread_exit(NULL);
+    // This is the application-level data port (never full)
+    int num_sent = 0;
+    if (port == max_port_id) {
+        for (; num_sent < num_packets; num_sent++) {
+            const int rc = mixnet_send(handle, port, packets[num_sent]);
+            if (rc != 1) { return (num_sent == 0) ? rc : num_sent; }
         }
-        // Successful transmission
-        else { free(packet); return 1; }
+        return num_sent;
     }
-    return 0;
+    // Regular port: only the valid packets up front are sent
+    int num_valid = 0;
+    while ((num_valid < num_packets) &&
+           is_valid_packet(packets[num_valid])) { num_valid++; }
+    if (num_valid == 0) { return -1; }
+
+    while (num_sent < num_valid) {
+        const int rc = send_on_port(ctx, port, &(packets[num_sent]),
+                                    (num_valid - num_sent));
+        for (int i = num_sent; i < (num_sent + rc); i++) {
+            mixnet_packet_free(ctx, packets[i]);
+        }
+        num_sent += rc;
+        if (rc < HARNESS_TRANSPORT_MAX_BURST) { break; } // Full (or done)
+    }
+    return num_sent;
+}
+
+int mixnet_send_multi(void *handle, const uint64_t port_mask,
+                      mixnet_packet *packet, uint64_t *unsent_ports) {
+    // Fetch the fragment context
+    struct fragment_context *ctx = (
+        (struct fragment_context*) handle);
+
+    struct mixnet_context *subctx = &(ctx->mixnet_ctx);
+    const uint16_t num_neighbors = subctx->config.num_neighbors;
+
+    // Invalid port IDs (the mask only covers regular ports)
+    if ((num_neighbors < 64) &&
+        ((port_mask >> num_neighbors) != 0)) { return -1; }
+    if (!is_valid_packet(packet)) { return -1; }
+
+    // The same buffer backs every send, so it is freed exactly
+    // once, after the last port has been attempted.
+    int num_sent = 0;
+    uint64_t unsent = 0;
+    for (uint64_t mask = port_mask; mask != 0; mask &= (mask - 1)) {
+        const uint8_t port = (uint8_t) __builtin_ctzll(mask);
+        if (send_on_port(ctx, port, &packet, 1) == 1) { num_sent++; }
+        else { unsent |= (mask & -mask); }
+    }
+    if (unsent_ports != NULL) { *unsent_ports = unsent; }
+    else { mixnet_packet_free(ctx, packet); }
+    return num_sent;
+}
+
+void mixnet_watch_writable(void *handle, const uint64_t port_mask) {
+    // Fetch the fragment context
+    struct fragment_context *ctx = (
+        (struct fragment_context*) handle);
+
+    struct mixnet_context *subctx = &(ctx->mixnet_ctx);
+    const uint16_t num_neighbors = subctx->config.num_neighbors;
+
+    // Only (re-)register the ports whose state changes. TX sockets are
+    // tagged past the user port, so they are told apart from RX ones.
+    const uint64_t changed = (port_mask ^ subctx->tx_watched_ports);
+    for (uint64_t mask = changed; mask != 0; mask &= (mask - 1)) {
+        const uint8_t port = (uint8_t) __builtin_ctzll(mask);
+        if (port >= num_neighbors) { continue; }
+
+        const bool is_watched = ((port_mask >> port) & 1);
+        struct epoll_event event = {.events = EPOLLOUT,
+                                    .data.u32 = (num_neighbors + 1 + port)};
+        epoll_ctl(subctx->epoll_fd, (is_watched ? EPOLL_CTL_ADD :
+                                     EPOLL_CTL_DEL),
+                  subctx->tx_socket_fds[port], &event);
+    }
+    subctx->tx_watched_ports = port_mask;
+}
+
+bool mixnet_link_is_up(void *handle, const uint8_t port) {
+    // Fetch the fragment context
+    struct fragment_context *ctx = (
+        (struct fragment_context*) handle);
+
+    struct mixnet_context *subctx = &(ctx->mixnet_ctx);
+    if (port >= subctx->config.num_neighbors) { return false; }
+
+    // Plain read; the ctrl thread updates link states under the
+    // port mutex, but a stale value here is benign (re-polled).
+    return ((volatile bool *) subctx->link_states)[port];
+}
+
+struct mixnet_stats *mixnet_get_stats(void *handle) {
+    // Fetch the fragment context
+    struct fragment_context *ctx = (
+        (struct fragment_context*) handle);
+
+    return &(ctx->mixnet_ctx.stats);
+}
+
+mixnet_packet *mixnet_packet_alloc(void *handle, const size_t size) {
+    // Fetch the fragment context
+    struct fragment_context *ctx = (
+        (struct fragment_context*) handle);
+
+    mixnet_packet *packet = packet_pool_alloc(
+        size, &(ctx->mixnet_ctx.stats.pkt_reserved_bytes));
+    if (packet != NULL) { count_packet_allocs(&(ctx->mixnet_ctx.stats), 1); }
+    return packet;
+}
+
+void mixnet_packet_free(void *handle, mixnet_packet *packet) {
+    // Fetch the fragment context
+    struct fragment_context *ctx = (
+        (struct fragment_context*) handle);
+
+    if (packet == NULL) { return; }
+    __atomic_add_fetch(&(ctx->mixnet_ctx.stats.pkt_frees), 1,
+                       __ATOMIC_RELAXED);
+    packet_pool_free(packet);
 }
@@ -12,7 +12,10 @@
 #define MIXNET_CONNECTION_H
 
 #include "packet.h"
+#include "stats.h"
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 /**
@@ -44,22 +47,72 @@
  *                source route and know the hop count.
  *
  * @param packet Pointer to a packet that will be populated by the callee.
- *               Packet themselves are heap-allocated. You may modify the
- *               contents as you see fit, but packets must either be:
- *               (a) free'd once you are done processing them, OR
+ *               Packets themselves come from mixnet_packet_alloc(), and
+ *               are always maximum-sized buffers (so a received packet
+ *               may grow in place, up to MAX_MIXNET_PACKET_SIZE). You
+ *               may modify the contents as you see fit, but packets must
+ *               either be:
+ *               (a) released using mixnet_packet_free() once you are done
+ *                   processing them, OR
  *               (b) sent back over the network using mixnet_send()
  *
  * @return Number of packets received
  */
 int mixnet_recv(void *handle, uint8_t *port, mixnet_packet **packet);
 
+/**
+ * Same as mixnet_recv(), except that if no packet is ready, it blocks
+ * (without spinning) until one arrives, a link changes state, the node
+ * is asked to stop running, a watched port becomes writable (see
+ * mixnet_watch_writable), or the timeout elapses.
+ *
+ * @param handle Opaque handle. DO NOT TOUCH!
+ * @param port See mixnet_recv()
+ * @param packet See mixnet_recv()
+ * @param timeout_ms Maximum time to block (in ms), or -1 for no limit
+ *
+ * @return Number of packets received (0 on timeout or other wakeups)
+ */
+int mixnet_recv_timeout(void *handle, uint8_t *port,
+                        mixnet_packet **packet, const int timeout_ms);
+
+/**
+ * Same as mixnet_recv(), except that it receives as many packets as are
+ * ready (up to max_packets) in one call. Ports are served round-robin,
+ * with each one contributing at most an equal share of the batch before
+ * the others get another turn, so a busy port can't starve the rest.
+ * Packets from the same port are returned in the order they arrived.
+ *
+ * @param handle Opaque handle. DO NOT TOUCH!
+ * @param ports Callee-populated array (of at least max_packets entries):
+ *              the port each packet was received on (see mixnet_recv())
+ * @param packets Callee-populated array (of at least max_packets entries)
+ *                of packets, with the same ownership as in mixnet_recv()
+ * @param max_packets Maximum number of packets to receive
+ *
+ * @return Number of packets received
+ */
+int mixnet_recv_batch(void *handle, uint8_t *ports,
+                      mixnet_packet **packets, const int max_packets);
+
+/**
+ * Same as mixnet_recv_batch(), except that it blocks if no packet is
+ * ready (see mixnet_recv_timeout()).
+ *
+ * @return Number of packets received (0 on timeout or other wakeups)
+ */
+int mixnet_recv_batch_timeout(void *handle, uint8_t *ports,
+                              mixnet_packet **packets,
+                              const int max_packets, const int timeout_ms);
+
 /**
  * Send a packet over the Mixnet network.
  *
  * @param handle Opaque handle. DO NOT TOUCH!
  * @param port Port on which the packet should be sent
- * @param packets Pointer to a packet to send. Packets themselves must be heap-
- *                allocated, either by you or a previous call to mixnet_recv().
+ * @param packets Pointer to a packet to send. Packets themselves must come from
+ *                mixnet_packet_alloc(), either by you or a previous call to
+ *                mixnet_recv().
  *                After this point, sent packets are 'owned' by the callee, so
  *                you must not try to free them or modify their contents. Note:
  *                In the event that a packet is not successfully sent, you are
@@ -77,4 +130,104 @@ int mixnet_recv(void *handle, uint8_t *port, mixnet_packet **packet);
  */
 int mixnet_send(void *handle, const uint8_t port, mixnet_packet *packet);
 
+/**
+ * Send several packets on the same port, in order. Transports that
+ * support it (e.g., UDP) move the whole batch with one syscall. As with
+ * mixnet_send(), sent packets are 'owned' by the callee; the batch stops
+ * at the first packet that is invalid, or that doesn't fit in the socket
+ * buffer, and the rest remain yours (e.g., to retry later).
+ *
+ * @param handle Opaque handle. DO NOT TOUCH!
+ * @param port Port on which the packets should be sent
+ * @param packets Array of packets to send
+ * @param num_packets Number of packets in the array
+ *
+ * @return Number of packets sent (always the first ones), or -1 if the
+ *         first packet is invalid (or on bad arguments)
+ */
+int mixnet_send_batch(void *handle, const uint8_t port,
+                      mixnet_packet **packets, const int num_packets);
+
+/**
+ * Send the same packet on several (regular) ports, e.g., to broadcast
+ * it. This avoids cloning the packet per port: a single buffer backs
+ * every send, and is freed once after the last one.
+ *
+ * @param handle Opaque handle. DO NOT TOUCH!
+ * @param port_mask Bitmask of ports to send on (bit i is port i). Must
+ *                  not include the n'th (user) port.
+ * @param packet Pointer to an allocated packet. As with mixnet_send(),
+ *               it is 'owned' by the callee once this returns successfully
+ *               (even if it could not be sent on some ports, which are not
+ *               retried), unless unsent_ports is given.
+ * @param unsent_ports If non-NULL, set to the ports on which the send hit
+ *                     backpressure (the socket buffer was full). In this
+ *                     case, the caller always keeps the packet (e.g., to
+ *                     retry those ports later).
+ *
+ * @return Number of ports the packet was sent on, or -1 on error (bad
+ *         packet or arguments, in which case the caller keeps the packet)
+ */
+int mixnet_send_multi(void *handle, const uint64_t port_mask,
+                      mixnet_packet *packet, uint64_t *unsent_ports);
+
+/**
+ * Allocate a packet buffer of (at least) the given total size, i.e.,
+ * header and payload. Buffers come from size-classed slabs, with a
+ * cache per thread, so this rarely takes a lock (unlike malloc, when
+ * several threads free packets).
+ *
+ * @param handle Opaque handle. DO NOT TOUCH!
+ * @param size Total packet size (at most MAX_MIXNET_PACKET_SIZE)
+ *
+ * @return Pointer to the packet, or NULL (bad size, or out of memory)
+ */
+mixnet_packet *mixnet_packet_alloc(void *handle, const size_t size);
+
+/**
+ * Free a packet allocated by mixnet_packet_alloc() (or received by
+ * mixnet_recv()). Packets must never be passed to free(). Freeing NULL
+ * does nothing.
+ *
+ * @param handle Opaque handle. DO NOT TOUCH!
+ * @param packet Pointer to the packet to free
+ */
+void mixnet_packet_free(void *handle, mixnet_packet *packet);
+
+/**
+ * Set the (regular) ports whose sockets should wake mixnet_recv_timeout()
+ * once they become writable again, e.g., to retry sends that hit
+ * backpressure. Replaces the previously watched set.
+ *
+ * @param handle Opaque handle. DO NOT TOUCH!
+ * @param port_mask Bitmask of ports to watch (bit i is port i)
+ */
+void mixnet_watch_writable(void *handle, const uint64_t port_mask);
+
+/**
+ * Query the state of the link attached to a port (analogous to carrier
+ * detection on a physical interface). Packets are neither received nor
+ * delivered over a link that is down.
+ *
+ * @param handle Opaque handle. DO NOT TOUCH!
+ * @param port Port whose link state to query (must be a neighbor port)
+ *
+ * @return True if the link is up, false if it is down (or bad port)
+ */
+bool mixnet_link_is_up(void *handle, const uint8_t port);
+
+/**
+ * Get this node's protocol counters. Packets and bytes received and sent
+ * (per port and type), and sends that found the socket buffer full, are
+ * counted by mixnet_recv() and mixnet_send(), and packet buffers by
+ * mixnet_packet_alloc() and mixnet_packet_free(); the node itself records
+ * drops, FIB recomputes, and spanning tree convergence. The orchestrator
+ * may read the counters at any time (see TEST_MESSAGE_STATS).
+ *
+ * @param handle Opaque handle. DO NOT TOUCH!
+ *
+ * @return Pointer to the counter block (valid while the node runs)
+ */
+struct mixnet_stats *mixnet_get_stats(void *handle);
+
 #endif // MIXNET_CONNECTION_H
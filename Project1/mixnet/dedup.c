@@ -0,0 +1,107 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the Mixnet course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the Mixnet project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#include "dedup.h"
+
+#include <stdlib.h>
+
+// Constant parameters
+static const uint32_t DEDUP_INITIAL_CAPACITY = 64;
+
+static inline uint32_t dedup_slot(const struct dedup_table *table,
+                                  const mixnet_address origin) {
+    // Fibonacci hashing spreads nearby addresses across the table
+    const uint32_t hash = ((uint32_t) origin * UINT32_C(2654435769));
+    return (hash ^ (hash >> 16)) & (table->capacity - 1);
+}
+
+/**
+ * Returns the window for the given origin, or the (empty) slot that
+ * it should go into.
+ */
+static struct dedup_window *dedup_probe(struct dedup_table *table,
+                                        const mixnet_address origin) {
+    uint32_t slot = dedup_slot(table, origin);
+    while (table->windows[slot].is_used &&
+           (table->windows[slot].origin != origin)) {
+        slot = (slot + 1) & (table->capacity - 1);
+    }
+    return &(table->windows[slot]);
+}
+
+// Doubles the table's capacity, re-inserting every window
+static bool dedup_grow(struct dedup_table *table) {
+    struct dedup_window *old_windows = table->windows;
+    const uint32_t old_capacity = table->capacity;
+
+    struct dedup_window *windows = calloc(old_capacity * 2,
+                                          sizeof(struct dedup_window));
+    if (windows == NULL) { return false; }
+
+    table->windows = windows;
+    table->capacity = (old_capacity * 2);
+    for (uint32_t i = 0; i < old_capacity; i++) {
+        if (old_windows[i].is_used) {
+            *dedup_probe(table, old_windows[i].origin) = old_windows[i];
+        }
+    }
+    free(old_windows);
+    return true;
+}
+
+bool dedup_init(struct dedup_table *table) {
+    table->capacity = DEDUP_INITIAL_CAPACITY;
+    table->num_origins = 0;
+    table->windows = calloc(table->capacity, sizeof(struct dedup_window));
+    return (table->windows != NULL);
+}
+
+void dedup_destroy(struct dedup_table *table) {
+    free(table->windows);
+    table->windows = NULL;
+    table->capacity = table->num_origins = 0;
+}
+
+bool dedup_check_and_mark(struct dedup_table *table,
+                          const mixnet_address origin,
+                          const uint16_t sequence) {
+    struct dedup_window *window = dedup_probe(table, origin);
+
+    // First packet from this origin (keep the load factor under 1/2)
+    if (!window->is_used) {
+        if (((table->num_origins + 1) * 2) > table->capacity) {
+            if (!dedup_grow(table)) { return true; } // Fail open
+            window = dedup_probe(table, origin);
+        }
+        window->origin = origin;
+        window->highest = sequence;
+        window->bitmap = 1;
+        window->is_used = true;
+        table->num_origins++;
+        return true;
+    }
+    // Newer than anything seen, slide the window forward
+    if (dedup_seq_is_newer(sequence, window->highest)) {
+        const uint16_t shift = (uint16_t) (sequence - window->highest);
+        window->bitmap = (shift >= DEDUP_WINDOW_SIZE) ?
+                         0 : (window->bitmap << shift);
+        window->bitmap |= 1;
+        window->highest = sequence;
+        return true;
+    }
+    // Within the window, check (and set) its bit
+    const uint16_t offset = (uint16_t) (window->highest - sequence);
+    if (offset >= DEDUP_WINDOW_SIZE) { return false; }
+
+    const uint64_t bit = (UINT64_C(1) << offset);
+    if (window->bitmap & bit) { return false; }
+    window->bitmap |= bit;
+    return true;
+}
@@ -0,0 +1,79 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the Mixnet course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the Mixnet project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#ifndef MIXNET_DEDUP_H
+#define MIXNET_DEDUP_H
+
+#include "address.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Number of sequence numbers (at and below the highest one seen)
+// tracked per origin; anything older is treated as a duplicate.
+#define DEDUP_WINDOW_SIZE 64
+
+/**
+ * Returns whether sequence number a is newer than b. Sequence numbers
+ * are 16 bits and wrap around, so they are compared using serial
+ * number arithmetic (RFC 1982).
+ */
+static inline bool dedup_seq_is_newer(const uint16_t a, const uint16_t b) {
+    return (((int16_t) (uint16_t) (a - b)) > 0);
+}
+
+/**
+ * Per-origin sliding window. Bit i of the bitmap is set if sequence
+ * number (highest - i) has been seen.
+ */
+struct dedup_window {
+    mixnet_address origin;          // Origin's mixnet address
+    uint16_t highest;               // Highest sequence number seen
+    uint64_t bitmap;                // Seen bits, relative to highest
+    bool is_used;                   // Whether this slot holds an origin
+};
+
+/**
+ * Seen-set of (origin, sequence) tags for flooded packets: an open-
+ * addressing hash table (linear probing) of per-origin windows.
+ */
+struct dedup_table {
+    struct dedup_window *windows;   // Hash table slots
+    uint32_t capacity;              // Number of slots (a power of 2)
+    uint32_t num_origins;           // Number of occupied slots
+};
+
+/**
+ * Initializes (or tears down) an empty seen-set.
+ *
+ * @return True if initialization was successful, else false
+ */
+bool dedup_init(struct dedup_table *table);
+void dedup_destroy(struct dedup_table *table);
+
+/**
+ * Records the given tag as seen.
+ *
+ * @return True if the tag is new, or false if it is a duplicate (or
+ *         too old to tell, i.e., outside the origin's window)
+ */
+bool dedup_check_and_mark(struct dedup_table *table,
+                          const mixnet_address origin,
+                          const uint16_t sequence);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MIXNET_DEDUP_H
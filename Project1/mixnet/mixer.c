@@ -0,0 +1,49 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the Mixnet course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the Mixnet project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#include "mixer.h"
+
+#include "connection.h"
+#include "random.h"
+
+#include <stdlib.h>
+
+bool mixer_init(struct mixer *m, const uint16_t mixing_factor,
+                const uint64_t seed) {
+    m->mixing_factor = (mixing_factor > 0) ? mixing_factor : 1;
+    m->num_pending = 0;
+    m->rng_state = (seed != 0) ? seed : 1;
+
+    m->slots = malloc(sizeof(struct mixer_slot) * m->mixing_factor);
+    return (m->slots != NULL);
+}
+
+void mixer_destroy(void *handle, struct mixer *m) {
+    if (m->slots != NULL) {
+        for (uint16_t i = 0; i < m->num_pending; i++) {
+            mixnet_packet_free(handle, m->slots[i].packet);
+        }
+    }
+    free(m->slots);
+    m->slots = NULL;
+    m->num_pending = 0;
+}
+
+const struct mixer_slot *mixer_release(struct mixer *m, uint16_t *num_slots) {
+    for (uint16_t i = m->num_pending; i > 1; i--) {
+        const uint32_t j = random_below(&(m->rng_state), i);
+        struct mixer_slot tmp = m->slots[i - 1];
+        m->slots[i - 1] = m->slots[j];
+        m->slots[j] = tmp;
+    }
+    *num_slots = m->num_pending;
+    m->num_pending = 0;
+    return m->slots;
+}
@@ -0,0 +1,101 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the Mixnet course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the Mixnet project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#ifndef MIXNET_MIXER_H
+#define MIXNET_MIXER_H
+
+#include "packet.h"
+#include "ports.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A packet waiting in the mixer, along with its output port(s).
+ */
+struct mixer_slot {
+    mixnet_packet *packet;          // Packet to send (owned by the mixer)
+    port_mask_t port_mask;          // Neighbor ports to broadcast it on,
+    uint8_t port;                   // else the port to send it on
+};
+
+/**
+ * Mixing stage. Buffers exactly mixing_factor (non-control) packets
+ * in a pool of slots allocated up-front, then releases the batch in
+ * a uniformly random order.
+ */
+struct mixer {
+    uint16_t mixing_factor;         // Packets per batch
+    uint16_t num_pending;           // Packets currently buffered
+    struct mixer_slot *slots;       // Slot pool (mixing_factor entries)
+    uint64_t rng_state;             // PRNG state (xorshift64*)
+};
+
+/**
+ * Initializes (or tears down) the mixer. Tearing it down frees any
+ * packets that are still buffered (with mixnet_packet_free).
+ *
+ * @param m Mixer to initialize
+ * @param mixing_factor Number of packets per batch (0 is treated as 1)
+ * @param seed Seed for the shuffle (must be non-zero)
+ * @return True if initialization was successful, else false
+ */
+bool mixer_init(struct mixer *m, const uint16_t mixing_factor,
+                const uint64_t seed);
+void mixer_destroy(void *handle, struct mixer *m);
+
+/**
+ * Buffers a packet (transferring ownership to the mixer).
+ *
+ * @return True if the batch is now full, and should be released
+ */
+static inline bool mixer_add(struct mixer *m, const uint8_t port,
+                             mixnet_packet *packet) {
+    m->slots[m->num_pending].packet = packet;
+    m->slots[m->num_pending].port_mask = 0;
+    m->slots[m->num_pending].port = port;
+    return (++(m->num_pending) == m->mixing_factor);
+}
+
+/**
+ * Buffers a packet to be broadcast on several (neighbor) ports. It
+ * takes a single slot, however many ports it goes out on.
+ *
+ * @return True if the batch is now full, and should be released
+ */
+static inline bool mixer_add_multi(struct mixer *m,
+                                   const port_mask_t port_mask,
+                                   mixnet_packet *packet) {
+    m->slots[m->num_pending].packet = packet;
+    m->slots[m->num_pending].port_mask = port_mask;
+    m->slots[m->num_pending].port = 0;
+    return (++(m->num_pending) == m->mixing_factor);
+}
+
+/**
+ * Shuffles the buffered packets (Fisher-Yates) and returns them. The
+ * caller takes ownership of the returned packets, which remain valid
+ * until the next call to mixer_add.
+ *
+ * @param m The mixer
+ * @param num_slots Set to the number of slots returned
+ * @return The shuffled slots
+ */
+const struct mixer_slot *mixer_release(struct mixer *m, uint16_t *num_slots);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MIXNET_MIXER_H
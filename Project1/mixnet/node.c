@@ -11,6 +11,14 @@
 #include "node.h"
 
 #include "connection.h"
+#include "dedup.h"
+#include "mixer.h"
+#include "ports.h"
+#include "routing.h"
+#include "routing_thread.h"
+#include "rstp.h"
+#include "timer.h"
+#include "txq.h"
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -19,6 +27,16 @@
 
 #define DEBUG_FLOOD 0
 #define DEBUG_STP 0
+#define DEBUG_ROUTING 0
+
+// Most packets taken off the network per receive call
+#define RECV_BATCH_SIZE 32
+
+// Link-state aging: every node re-floods its LSA periodically, and
+// adjacencies that go unrefreshed for several periods are withdrawn
+static const uint32_t LSA_REFRESH_INTERVAL_MS = 30000;
+static const uint32_t LSA_AGE_CHECK_INTERVAL_MS = 10000;
+static const uint32_t LSA_MAX_AGE_MS = 90000;
 
 typedef struct{
     mixnet_address root_address;
@@ -26,216 +44,542 @@ typedef struct{
     mixnet_address next_hop_address;    
 } stp_route_t;
 
-// the node's database for current STP path to root node
-//TODO: why create this here. Should be 1 per node right?
-static stp_route_t stp_route_db;
+// Per-node protocol state. Everything a node needs between packets
+// lives here (rather than in file-level globals), so that a single
+// process can host many nodes, each running in its own thread.
+struct node_context {
+    // Neighbor address -> port (built once from the config)
+    struct port_index neighbor_index;
+
+    // STP packet fowarding info (My Root, Path Length, Next Hop)
+    stp_route_t stp_route_db;
+    port_mask_t stp_ports;              // ports to send STP route advertisements on during convergence period
+    mixnet_address stp_parent_addr;
+    uint16_t stp_parent_path_length;
+    bool is_hello_root;
+
+    // Rapid STP (proposal/agreement), if enabled. Mirrored into the
+    // fields above, so that FLOOD handling is the same in both modes.
+    struct rstp_state rstp;
+    uint32_t rstp_changes_seen;
+
+    // Convergence metrics
+    uint32_t stp_pkt_ct;
+    bool printed_convergence;
+    struct timeval convergence_timer_start;
+
+    // Link-state routing: the LSDB (for flooding and re-syncs only, so
+    // unindexed), and the last-seen state of each link. Routes (and LSA
+    // aging) live on the routing thread, which is fed every LSDB change
+    // and publishes FIB snapshots.
+    struct lsdb lsdb;
+    struct routing_thread routing_thread;
+    uint64_t rr_rng_state;
+    port_mask_t link_ports;
+
+    // Mixing stage for DATA/PING packets (batches of mixing_factor)
+    struct mixer mixer;
+
+    // Packets that hit backpressure, per port (drained in order)
+    struct tx_queues txq;
+
+    // Seen (origin, sequence) tags of flooded packets. Duplicates are
+    // dropped, so floods stay bounded even if the tree has loops while
+    // it re-converges.
+    uint16_t flood_seq;
+    struct dedup_table flood_seen;
+    struct dedup_table lsa_seen;
+
+    // Protocol timers (the loop sleeps until the next one expires)
+    struct timer_wheel timer_wheel;
+    struct node_timer root_hello_timer;
+    struct node_timer reelection_timer;
+    struct node_timer lsa_refresh_timer;
+    struct node_timer lsa_age_timer;
+};
+
+// Node context functions
+struct node_context *node_context_create(void *handle,
+                                         const struct mixnet_node_config config);
+void node_context_destroy(void *handle, struct node_context *node);
+
+// Rapid STP functions
+void poll_rstp_links(const struct mixnet_node_config config,
+                     struct node_context *node);
+void flush_rstp(void *handle,
+                const struct mixnet_node_config config,
+                struct node_context *node);
 
 // STP functions
 void broadcast_stp(void *handle, 
+                   struct tx_queues *txq,
                    const struct mixnet_node_config config, 
                    stp_route_t *stp_route_db);
 void print_stp(const struct mixnet_node_config config, const char *prefix_str, mixnet_packet *packet);
-uint32_t STP_pkt_ct; // Metrics
 
 // FLOOD functions
 void broadcast_flood(void *handle, 
-                     const struct mixnet_node_config config, 
-                     uint8_t *active_ports);
+                     struct tx_queues *txq,
+                     struct mixer *mixer,
+                     port_mask_t active_ports,
+                     const mixnet_packet_flood *tag);
+
+// LSA functions
+void originate_lsa(void *handle,
+                   struct tx_queues *txq,
+                   const struct mixnet_node_config config,
+                   struct lsdb *db,
+                   struct routing_thread *rt,
+                   port_mask_t link_ports);
+void send_lsa(void *handle,
+              struct tx_queues *txq,
+              const struct mixnet_node_config config,
+              const struct lsdb *db,
+              const struct lsdb_entry *entry,
+              port_mask_t port_mask);
+void flood_lsa(void *handle,
+               struct tx_queues *txq,
+               const struct mixnet_node_config config,
+               const struct lsdb *db,
+               const struct lsdb_entry *entry,
+               port_mask_t link_ports,
+               uint8_t recv_port);
+void poll_link_states(void *handle,
+                      struct tx_queues *txq,
+                      const struct mixnet_node_config config,
+                      struct lsdb *db,
+                      struct routing_thread *rt,
+                      port_mask_t *link_ports);
+
+// DATA/PING functions
+void route_user_packet(void *handle,
+                       struct tx_queues *txq,
+                       const struct mixnet_node_config config,
+                       const struct fib_snapshot *fib,
+                       uint64_t *rng_state,
+                       const struct port_index *neighbors,
+                       port_mask_t link_ports,
+                       struct mixer *mixer,
+                       mixnet_packet *packet);
+void forward_routed_packet(void *handle,
+                           struct tx_queues *txq,
+                           const struct mixnet_node_config config,
+                           const struct fib_snapshot *fib,
+                           const struct port_index *neighbors,
+                           port_mask_t link_ports,
+                           struct mixer *mixer,
+                           mixnet_packet *packet);
+void send_routed_packet(void *handle,
+                        struct tx_queues *txq,
+                        const struct mixnet_node_config config,
+                        const struct fib_snapshot *fib,
+                        const struct port_index *neighbors,
+                        port_mask_t link_ports,
+                        struct mixer *mixer,
+                        mixnet_packet *packet);
+void deliver_routed_packet(void *handle,
+                           struct tx_queues *txq,
+                           const struct mixnet_node_config config,
+                           const struct fib_snapshot *fib,
+                           const struct port_index *neighbors,
+                           port_mask_t link_ports,
+                           struct mixer *mixer,
+                           mixnet_packet *packet);
+int repair_routed_packet(const struct fib_snapshot *fib,
+                         port_mask_t link_ports,
+                         mixnet_packet *packet);
+
+// Mixing functions
+void mix_packet(void *handle,
+                struct tx_queues *txq,
+                struct mixer *mixer,
+                uint8_t port,
+                mixnet_packet *packet);
+void mix_broadcast(void *handle,
+                   struct tx_queues *txq,
+                   struct mixer *mixer,
+                   port_mask_t port_mask,
+                   mixnet_packet *packet);
+void release_mixed(void *handle,
+                   struct tx_queues *txq,
+                   struct mixer *mixer);
 
 // Generic functions 
 void print_packet_header(mixnet_packet *pkt);
-int get_port_from_addr(const struct mixnet_node_config config, mixnet_address next_hop_address, uint8_t *stp_ports);
+int get_port_from_addr(const struct port_index *neighbors, mixnet_address next_hop_address, port_mask_t stp_ports);
 
 // Port-handling functions
 enum port_decision {BLOCK_PORT, OPEN_PORT};
-void activate_all_ports(const struct mixnet_node_config config, uint8_t *ports);
-void deactivate_all_ports(const struct mixnet_node_config config, uint8_t *ports);
-void port_to_neighbor(const struct mixnet_node_config config, 
+void port_to_neighbor(const struct port_index *neighbors, 
                             mixnet_address niegbhor_addr, 
-                            uint8_t *ports, 
+                            port_mask_t *ports, 
                             enum port_decision decision);
                             
-void print_ports(const struct mixnet_node_config config, uint8_t *ports);
+void print_ports(const struct mixnet_node_config config, port_mask_t ports);
 
 bool is_root(const struct mixnet_node_config config, stp_route_t *stp_route_db);
 
 double diff_in_microseconds(struct timeval t0, struct timeval t1);
+uint64_t time_in_microseconds(void);
 
+// Counter functions (see mixnet_get_stats)
+void count_drop(void *handle, enum mixnet_drop_reason_enum reason);
+void count_convergence(void *handle);
 
-void run_node(void *handle,
-              volatile bool *keep_running,
-              const struct mixnet_node_config config) {
 
-    // STP packet fowarding info (My Root, Path Length, Next Hop)
+struct node_context *node_context_create(void *handle,
+                                         const struct mixnet_node_config config)
+{
+    struct node_context *node = malloc(sizeof(struct node_context));
+    if (node == NULL) { return NULL; }
+
     // Initially, Node thinks it's the root
-    stp_route_db.root_address = config.node_addr;
-    stp_route_db.path_length = 0;
-    stp_route_db.next_hop_address = config.node_addr;
+    node->stp_route_db.root_address = config.node_addr;
+    node->stp_route_db.path_length = 0;
+    node->stp_route_db.next_hop_address = config.node_addr;
+    node->stp_parent_addr = -1;
+    node->stp_parent_path_length = -1;
+    node->is_hello_root = true;
+    node->stp_pkt_ct = 0;
+    node->printed_convergence = false;
+
+    port_index_init(&(node->neighbor_index), config.num_neighbors, config.neighbor_addrs);
+    node->stp_ports = port_mask_all(config.num_neighbors); //Initially assume no ST created
+    node->link_ports = 0;
+
+    // This node is always in its own LSDB (initially isolated)
+    if (!lsdb_init(&(node->lsdb), false) ||
+        !lsdb_update(&(node->lsdb), config.node_addr, 0, 0, NULL, 0)) {
+        printf("[%u] Error initializing LSDB\n", config.node_addr);
+        lsdb_destroy(&(node->lsdb));
+        free(node);
+        return NULL;
+    }
+    // Scrambled, so that random routing never draws the mixer's sequence
+    node->rr_rng_state = (((((uint64_t) config.node_addr) << 32) ^ time_in_microseconds()) *
+                          UINT64_C(0x9E3779B97F4A7C15)) | 1;
+
+    if (!mixer_init(&(node->mixer), config.mixing_factor,
+                    (((uint64_t) config.node_addr) << 32) ^ time_in_microseconds())) {
+        printf("[%u] Error initializing mixer\n", config.node_addr);
+        lsdb_destroy(&(node->lsdb));
+        free(node);
+        return NULL;
+    }
+
+    timer_wheel_init(&(node->timer_wheel), timer_now_us());
+    timer_init(&(node->root_hello_timer));
+    timer_init(&(node->reelection_timer));
+    timer_init(&(node->lsa_refresh_timer));
+    timer_init(&(node->lsa_age_timer));
+
+    // Fall back to forwarding after a reelection interval without an agreement
+    node->rstp_changes_seen = 0;
+    if (!rstp_init(&(node->rstp), config.node_addr, config.num_neighbors,
+                   &(node->timer_wheel), config.root_hello_interval_ms,
+                   config.reelection_interval_ms)) {
+        printf("[%u] Error initializing rapid STP state\n", config.node_addr);
+        mixer_destroy(handle, &(node->mixer));
+        lsdb_destroy(&(node->lsdb));
+        free(node);
+        return NULL;
+    }
 
-    uint8_t *stp_ports = malloc(sizeof(uint8_t) * config.num_neighbors);  // ports to send STP route advertisements on during convergence period
-    activate_all_ports(config, stp_ports); //Initially assume no ST created
+    node->flood_seq = 0;
+    const bool is_flood_seen_ok = dedup_init(&(node->flood_seen));
+    const bool is_lsa_seen_ok = dedup_init(&(node->lsa_seen));
+    if (!is_flood_seen_ok || !is_lsa_seen_ok) {
+        printf("[%u] Error initializing duplicate suppression\n", config.node_addr);
+        dedup_destroy(&(node->flood_seen));
+        dedup_destroy(&(node->lsa_seen));
+        rstp_destroy(&(node->rstp));
+        mixer_destroy(handle, &(node->mixer));
+        lsdb_destroy(&(node->lsdb));
+        free(node);
+        return NULL;
+    }
 
-    bool is_hello_root = true;
+    if (!txq_init(&(node->txq), config.num_neighbors)) {
+        printf("[%u] Error initializing transmit queues\n", config.node_addr);
+        dedup_destroy(&(node->flood_seen));
+        dedup_destroy(&(node->lsa_seen));
+        rstp_destroy(&(node->rstp));
+        mixer_destroy(handle, &(node->mixer));
+        lsdb_destroy(&(node->lsdb));
+        free(node);
+        return NULL;
+    }
+    return node;
+}
 
-    struct timeval root_hello_timer, root_hello_timer_start;
-    struct timeval election_timer, election_timer_start;
-    gettimeofday(&election_timer_start, NULL); //Initial reference point
+void node_context_destroy(void *handle, struct node_context *node)
+{
+    txq_destroy(handle, &(node->txq));
+    dedup_destroy(&(node->lsa_seen));
+    dedup_destroy(&(node->flood_seen));
+    rstp_destroy(&(node->rstp));
+    mixer_destroy(handle, &(node->mixer));
+    lsdb_destroy(&(node->lsdb));
+    free(node);
+}
+
+void run_node(void *handle,
+              volatile bool *keep_running,
+              const struct mixnet_node_config config) {
 
+    struct node_context *node = node_context_create(handle, config);
+    if (node == NULL) { return; }
+    if (!routing_thread_start(&(node->routing_thread), config.node_addr,
+                              config.num_neighbors, config.neighbor_addrs,
+                              &(node->neighbor_index), mixnet_get_stats(handle))) {
+        printf("[%u] Error starting routing thread\n", config.node_addr);
+        node_context_destroy(handle, node);
+        return;
+    }
+    if (!config.use_rapid_stp) {
+        timer_arm(&(node->timer_wheel), &(node->reelection_timer), config.reelection_interval_ms); //Initial reference point
+    }
 
-    struct timeval convergence_timer_start, convergence_timer;
-                                                  //
+    struct timeval convergence_timer;
+    mixnet_packet *recvd_packets[RECV_BATCH_SIZE];
+    uint8_t recv_ports[RECV_BATCH_SIZE];
     mixnet_packet *recvd_packet = NULL;
     mixnet_packet_stp *recvd_stp_packet = NULL;
-    mixnet_address stp_parent_addr = -1;
-    uint16_t stp_parent_path_length = -1;
     uint8_t recv_port;
     
-    int err=0;
     const int user_port = config.num_neighbors;
-    bool printed_convergence= false;
 
     // Broadcast (My Root, Path Length, My ID) initially 
-    if (is_root(config, &stp_route_db)){
-        broadcast_stp(handle, config, &stp_route_db);
-        gettimeofday(&root_hello_timer_start, NULL); //Reset root hello timer start
+    if (config.use_rapid_stp) {
+        timer_arm(&(node->timer_wheel), &(node->root_hello_timer), config.root_hello_interval_ms);
+    }
+    else if (is_root(config, &(node->stp_route_db))){
+        broadcast_stp(handle, &(node->txq), config, &(node->stp_route_db));
+        timer_arm(&(node->timer_wheel), &(node->root_hello_timer), config.root_hello_interval_ms); //Reset root hello timer
     }
 
-    gettimeofday(&convergence_timer_start, NULL); // On receiving hello root, reset election timer
+    gettimeofday(&(node->convergence_timer_start), NULL); // On receiving hello root, reset election timer
+    mixnet_stats_set(&(mixnet_get_stats(handle)->stp_changed_us), timer_now_us());
+
+    // Advertise our initial adjacency to every neighbor that is up
+    poll_link_states(handle, &(node->txq), config, &(node->lsdb), &(node->routing_thread), &(node->link_ports));
+    timer_arm(&(node->timer_wheel), &(node->lsa_refresh_timer), LSA_REFRESH_INTERVAL_MS);
+    timer_arm(&(node->timer_wheel), &(node->lsa_age_timer), LSA_AGE_CHECK_INTERVAL_MS);
+    if (config.use_rapid_stp) {
+        poll_rstp_links(config, node); // Propose on every link that is up
+        flush_rstp(handle, config, node);
+    }
 
     while (*keep_running) {
 
-        // Send Root Hello at regular intervals 
-        gettimeofday(&root_hello_timer, NULL);
-        if(is_root(config, &stp_route_db) && 
-            ((diff_in_microseconds(root_hello_timer_start, root_hello_timer) >= config.root_hello_interval_ms * 1000))) {
-            broadcast_stp(handle, config, &stp_route_db); 
-            gettimeofday(&root_hello_timer_start, NULL); //Reset root hello timer start
+        // Re-advertise (and re-sync) whenever a local link flips
+        poll_link_states(handle, &(node->txq), config, &(node->lsdb), &(node->routing_thread), &(node->link_ports));
+        if (config.use_rapid_stp) { poll_rstp_links(config, node); }
+
+        // Handle expired timers: Root Hello at regular intervals, and
+        // reelection when no hello has arrived within the interval. LSAs
+        // are refreshed (and aged out) on timers of their own.
+        timer_wheel_advance(&(node->timer_wheel), timer_now_us());
+        struct node_timer *expired_timer;
+        while ((expired_timer = timer_wheel_next_expired(&(node->timer_wheel))) != NULL) {
+            if (expired_timer == &(node->lsa_refresh_timer)) {
+                originate_lsa(handle, &(node->txq), config, &(node->lsdb),
+                              &(node->routing_thread), node->link_ports);
+                timer_arm(&(node->timer_wheel), &(node->lsa_refresh_timer), LSA_REFRESH_INTERVAL_MS);
+                continue;
+            } else if (expired_timer == &(node->lsa_age_timer)) {
+                const uint32_t now_ms = (uint32_t) (timer_now_us() / 1000);
+                routing_thread_submit_expiry(&(node->routing_thread), now_ms, LSA_MAX_AGE_MS);
+                timer_arm(&(node->timer_wheel), &(node->lsa_age_timer), LSA_AGE_CHECK_INTERVAL_MS);
+                continue;
+            }
+            // In rapid mode, every node sends hellos on its designated ports
+            if (config.use_rapid_stp) {
+                if (expired_timer == &(node->root_hello_timer)) {
+                    rstp_hello(&(node->rstp));
+                    timer_arm(&(node->timer_wheel), &(node->root_hello_timer), config.root_hello_interval_ms);
+                } else {
+                    rstp_handle_timer(&(node->rstp), expired_timer);
+                }
+            } else if (expired_timer == &(node->root_hello_timer)) {
+                if (is_root(config, &(node->stp_route_db))) {
+                    broadcast_stp(handle, &(node->txq), config, &(node->stp_route_db)); 
+                    timer_arm(&(node->timer_wheel), &(node->root_hello_timer), config.root_hello_interval_ms); //Reset root hello timer
+                } // Else, no longer the root
+            } else if (expired_timer == &(node->reelection_timer)) {
+                timer_arm(&(node->timer_wheel), &(node->reelection_timer), config.reelection_interval_ms);
+                if (is_root(config, &(node->stp_route_db))) { continue; } // Roots don't time out
+
+                // printf("election interval elapsed. Resetting ports. Node %d thinks it's root \n", config.node_addr);
+                // print_ports(config, node->stp_ports);
+                // Node thinks it's now the root. Forget about stale spanning tree
+                node->stp_route_db.root_address = config.node_addr;
+                node->stp_route_db.path_length = 0;
+                node->stp_route_db.next_hop_address = config.node_addr;
+                node->stp_ports = port_mask_all(config.num_neighbors);
+                node->stp_parent_addr = -1;
+                node->stp_parent_path_length = -1;
+
+                //Reset hello_timer_start
+                broadcast_stp(handle, &(node->txq), config, &(node->stp_route_db));
+                timer_arm(&(node->timer_wheel), &(node->root_hello_timer), config.root_hello_interval_ms);
+            }
         }
 
+        if (config.use_rapid_stp) { flush_rstp(handle, config, node); }
+
+        // Retry queued packets (the watched sockets wake us once writable)
+        if (txq_is_backlogged(&(node->txq))) { txq_drain(handle, &(node->txq)); }
+
+        // Hand over LSDB changes that found the ring full, and drop our
+        // hold on the FIB before going idle (so it can be replaced)
+        routing_thread_flush(&(node->routing_thread));
+        routing_thread_quiescent(&(node->routing_thread));
+
         /*** RECEIVE ***/
-        int value = mixnet_recv(handle, &recv_port, &recvd_packet);
-        if (value != 0) {
+        // Block until packets arrive (or the next timer is due), then
+        // handle everything that was ready before checking timers again
+        int num_recvd = mixnet_recv_batch_timeout(handle, recv_ports, recvd_packets, RECV_BATCH_SIZE,
+                                                  timer_wheel_ms_until_next(&(node->timer_wheel)));
+        for (int b = 0; b < num_recvd; b++) {
+            recv_port = recv_ports[b];
+            recvd_packet = recvd_packets[b];
             //print_packet_header(recvd_packet);
             switch (recvd_packet->type){
                 
                 //Run Spanning Tree Protocol updates. Brodcast root changes to neighbours as necessary
                 case PACKET_TYPE_STP: {
-                    STP_pkt_ct++;
+                    node->stp_pkt_ct++;
+
+                    if (config.use_rapid_stp) {
+                        if (recv_port != user_port &&
+                            recvd_packet->payload_size == sizeof(mixnet_packet_rstp)) {
+                            rstp_receive(&(node->rstp), recv_port,
+                                         (mixnet_packet_rstp *) recvd_packet->payload);
+                            flush_rstp(handle, config, node);
+                        } else {
+                            count_drop(handle, (recv_port == user_port) ?
+                                       MIXNET_DROP_BLOCKED : MIXNET_DROP_MALFORMED);
+                        }
+                        mixnet_packet_free(handle, recvd_packet);
+                        break;
+                    }
 
-                    if (!is_root(config, &stp_route_db) && is_hello_root) {
+                    if (!is_root(config, &(node->stp_route_db)) && node->is_hello_root) {
                         
                         // Convergence Metrics
-                        if(!printed_convergence){
+                        if(!node->printed_convergence){
                             gettimeofday(&convergence_timer, NULL); 
                             printf("[%u] @ %lf us: (my_root: %u, path_len: %u, next_hop: %u) -- in %u STP packets\n", 
                                 config.node_addr,
-                                diff_in_microseconds(convergence_timer_start, convergence_timer) / 1000.0,
-                                stp_route_db.root_address,
-                                stp_route_db.path_length,
-                                stp_route_db.next_hop_address,
-                                STP_pkt_ct);
-                            printed_convergence = true;
+                                diff_in_microseconds(node->convergence_timer_start, convergence_timer) / 1000.0,
+                                node->stp_route_db.root_address,
+                                node->stp_route_db.path_length,
+                                node->stp_route_db.next_hop_address,
+                                node->stp_pkt_ct);
+                            node->printed_convergence = true;
+                            count_convergence(handle);
                         }
                     }
                     
                     recvd_stp_packet = (mixnet_packet_stp*) recvd_packet->payload;
-                    is_hello_root = true;
+                    node->is_hello_root = true;
                     // printf("STP msg from: %u with root: %u, path length: %u, Node [%u] curr root:%u, curr parent %u \n", 
                     // recvd_stp_packet->node_address, 
                     // recvd_stp_packet->root_address, 
                     // recvd_stp_packet->path_length,
                     // config.node_addr,
-                    // stp_route_db.root_address,
-                    // stp_parent_addr);
+                    // node->stp_route_db.root_address,
+                    // node->stp_parent_addr);
 
-                    // print_ports(config, stp_ports);
+                    // print_ports(config, node->stp_ports);
 
                     // Receive STP message from smaller ID root node
                     // Make him root and increment path length
-                    if(recvd_stp_packet->root_address < stp_route_db.root_address) {
-                        is_hello_root = false;
+                    if(recvd_stp_packet->root_address < node->stp_route_db.root_address) {
+                        node->is_hello_root = false;
                         // printf("New Root node is %d Next hop is %u \n.", 
                         // recvd_stp_packet->root_address, recvd_stp_packet->node_address);
-                        // print_ports(config, stp_ports);
+                        // print_ports(config, node->stp_ports);
 
-                        stp_route_db.root_address = recvd_stp_packet->root_address;
-                        stp_route_db.path_length = recvd_stp_packet->path_length + 1;
-                        stp_route_db.next_hop_address = recvd_stp_packet->node_address;
+                        node->stp_route_db.root_address = recvd_stp_packet->root_address;
+                        node->stp_route_db.path_length = recvd_stp_packet->path_length + 1;
+                        node->stp_route_db.next_hop_address = recvd_stp_packet->node_address;
 
-                        stp_parent_addr = recvd_stp_packet->node_address;
-                        stp_parent_path_length = recvd_stp_packet->path_length;                        
+                        node->stp_parent_addr = recvd_stp_packet->node_address;
+                        node->stp_parent_path_length = recvd_stp_packet->path_length;                        
 
-                        stp_ports[recv_port] = 1; //Open parent port
+                        node->stp_ports |= port_mask_bit(recv_port); //Open parent port
 
                         // tell everyone but informant about new best root candidate
-                        stp_ports[recv_port] = 0;
-                        broadcast_stp(handle, config, &stp_route_db);
-                        stp_ports[recv_port] = 1;
+                        node->stp_ports &= ~port_mask_bit(recv_port);
+                        broadcast_stp(handle, &(node->txq), config, &(node->stp_route_db));
+                        node->stp_ports |= port_mask_bit(recv_port);
 
 
-                    }else if(recvd_stp_packet->root_address == stp_route_db.root_address) {
+                    }else if(recvd_stp_packet->root_address == node->stp_route_db.root_address) {
                         // Recieve from same ID, shorter path root node
                         // Follow his path instead, increment path length
-                        if(recvd_stp_packet->path_length + 1 < stp_route_db.path_length) {
-                            stp_route_db.next_hop_address = recvd_stp_packet->node_address;
-                            stp_route_db.path_length = recvd_stp_packet->path_length + 1;
+                        if(recvd_stp_packet->path_length + 1 < node->stp_route_db.path_length) {
+                            node->stp_route_db.next_hop_address = recvd_stp_packet->node_address;
+                            node->stp_route_db.path_length = recvd_stp_packet->path_length + 1;
                             
                             // printf("Found better path to same root %u with node %u pathlen %u \n", recvd_stp_packet->root_address, recvd_stp_packet->node_address, recvd_stp_packet->path_length);
-                            // print_ports(config, stp_ports);
+                            // print_ports(config, node->stp_ports);
 
                             
-                            stp_parent_addr = recvd_stp_packet->node_address;
-                            stp_parent_path_length = recvd_stp_packet->path_length;   
+                            node->stp_parent_addr = recvd_stp_packet->node_address;
+                            node->stp_parent_path_length = recvd_stp_packet->path_length;   
                             
-                            stp_ports[recv_port] = 1; //Open parent port
-                            is_hello_root = false;   
+                            node->stp_ports |= port_mask_bit(recv_port); //Open parent port
+                            node->is_hello_root = false;   
                         
                         //Tie for ID and path length
-                        } else if (stp_parent_addr != -1 && recvd_stp_packet->path_length == stp_parent_path_length){
+                        } else if (node->stp_parent_addr != -1 && recvd_stp_packet->path_length == node->stp_parent_path_length){
                             // printf("Tied for ID & parent pathlen with node %u pathlen %u \n", recvd_stp_packet->node_address, recvd_stp_packet->path_length);
-                            // printf("Parent %u recvd_node_addr %u \n", stp_parent_addr, recvd_stp_packet->node_address);
+                            // printf("Parent %u recvd_node_addr %u \n", node->stp_parent_addr, recvd_stp_packet->node_address);
                             
-                            if (recvd_stp_packet->node_address < stp_parent_addr){
+                            if (recvd_stp_packet->node_address < node->stp_parent_addr){
                                 // Close port for to-be-removed parent. Open port for new parent
-                                port_to_neighbor(config, stp_parent_addr, stp_ports, BLOCK_PORT);
-                                port_to_neighbor(config, recvd_stp_packet->node_address, stp_ports, OPEN_PORT);
+                                port_to_neighbor(&(node->neighbor_index), node->stp_parent_addr, &(node->stp_ports), BLOCK_PORT);
+                                port_to_neighbor(&(node->neighbor_index), recvd_stp_packet->node_address, &(node->stp_ports), OPEN_PORT);
 
                                 // printf("Choosing smaller ID path via node %u \n", recvd_stp_packet->node_address);
                                 // choose lesser indexed node to route through
-                                stp_route_db.next_hop_address = recvd_stp_packet->node_address;
-                                stp_parent_addr = recvd_stp_packet->node_address;         
+                                node->stp_route_db.next_hop_address = recvd_stp_packet->node_address;
+                                node->stp_parent_addr = recvd_stp_packet->node_address;         
                                 
-                                is_hello_root = false;
+                                node->is_hello_root = false;
 
-                            }else if (recvd_stp_packet->node_address > stp_parent_addr){
+                            }else if (recvd_stp_packet->node_address > node->stp_parent_addr){
                                 // Close port for failed parent candidate
                                 // printf("Severing link in other direction \n");
-                                port_to_neighbor(config, recvd_stp_packet->node_address, stp_ports, BLOCK_PORT);
-                                // print_ports(config, stp_ports);
+                                port_to_neighbor(&(node->neighbor_index), recvd_stp_packet->node_address, &(node->stp_ports), BLOCK_PORT);
+                                // print_ports(config, node->stp_ports);
                                 
-                                is_hello_root = false;
+                                node->is_hello_root = false;
                             }
                         } else {
-                            is_hello_root = false;
+                            node->is_hello_root = false;
                         }
 
                         // If path advertised is equal to path length, node must be peer, not {child, parent} 
-                        if (recvd_stp_packet->path_length == stp_route_db.path_length){
+                        if (recvd_stp_packet->path_length == node->stp_route_db.path_length){
                                 // printf("Tied for ID & pathlen with node %u pathlen %u \n", recvd_stp_packet->node_address, recvd_stp_packet->path_length);
-                                stp_ports[recv_port] = 0;
+                                node->stp_ports &= ~port_mask_bit(recv_port);
                         }
                     } else {
-                        is_hello_root = false;
-                        port_to_neighbor(config, recvd_stp_packet->node_address, stp_ports, OPEN_PORT); //Open child port
+                        node->is_hello_root = false;
+                        port_to_neighbor(&(node->neighbor_index), recvd_stp_packet->node_address, &(node->stp_ports), OPEN_PORT); //Open child port
                     }
 
-                    if (!is_root(config, &stp_route_db) && is_hello_root) {
+                    if (!is_root(config, &(node->stp_route_db)) && node->is_hello_root) {
                         
-                        stp_ports[recv_port] = 0;
-                        broadcast_stp(handle, config, &stp_route_db);
-                        stp_ports[recv_port] = 1;
+                        node->stp_ports &= ~port_mask_bit(recv_port);
+                        broadcast_stp(handle, &(node->txq), config, &(node->stp_route_db));
+                        node->stp_ports |= port_mask_bit(recv_port);
 
-                        gettimeofday(&election_timer_start, NULL); // On receiving hello root, reset election timer
+                        timer_arm(&(node->timer_wheel), &(node->reelection_timer), config.reelection_interval_ms); // On receiving hello root, reset election timer
                         
                     }
 
@@ -243,126 +587,633 @@ void run_node(void *handle,
                     #if DEBUG_STP
                     // printf("[%u] STP DB: (my_root: %u, path_len: %u, next_hop: %u)\n", 
                     //     config.node_addr, 
-                    //     stp_route_db.root_address,
-                    //     stp_route_db.path_length,
-                    //     stp_route_db.next_hop_address);
-                    // print_ports(config, stp_ports);
+                    //     node->stp_route_db.root_address,
+                    //     node->stp_route_db.path_length,
+                    //     node->stp_route_db.next_hop_address);
+                    // print_ports(config, node->stp_ports);
                     #endif
+                    mixnet_packet_free(handle, recvd_packet);
                     } break;
 
                 case PACKET_TYPE_FLOOD: {
 
-                    // Packet received on INPUT port. Flood as is
+                    // Packet received on INPUT port. Tag it as ours, and flood
                     if(recv_port == user_port) {
                         #if DEBUG_FLOOD
                         printf("[%u] Received FLOOD packet from user\n", config.node_addr);
                         #endif
-                        broadcast_flood(handle, config, stp_ports);
+                        const mixnet_packet_flood tag = {config.node_addr, node->flood_seq++};
+                        dedup_check_and_mark(&(node->flood_seen), tag.origin_address, tag.sequence);
+                        broadcast_flood(handle, &(node->txq), &(node->mixer), node->stp_ports, &tag);
+                        mixnet_packet_free(handle, recvd_packet);
+                        break;
                     }
 
-                    if(stp_ports[recv_port] && recv_port != user_port) {
-                        #if DEBUG_FLOOD
-                        printf("[%u] Received FLOOD packet from Node %u\n", config.node_addr, config.neighbor_addrs[recv_port]);
-                        #endif
+                    // Drop FLOODs off the tree, and any we have seen before
+                    if(!port_mask_has(node->stp_ports, recv_port) ||
+                       (recvd_packet->payload_size != sizeof(mixnet_packet_flood))) {
+                        count_drop(handle, port_mask_has(node->stp_ports, recv_port) ?
+                                   MIXNET_DROP_MALFORMED : MIXNET_DROP_BLOCKED);
+                        mixnet_packet_free(handle, recvd_packet);
+                        break;
+                    }
+                    const mixnet_packet_flood tag = *((mixnet_packet_flood *) recvd_packet->payload);
+                    if(!dedup_check_and_mark(&(node->flood_seen), tag.origin_address, tag.sequence)) {
+                        count_drop(handle, MIXNET_DROP_DUPLICATE);
+                        mixnet_packet_free(handle, recvd_packet);
+                        break;
+                    }
+                    #if DEBUG_FLOOD
+                    printf("[%u] Received FLOOD packet (%u, %u) from Node %u\n", config.node_addr,
+                        tag.origin_address, tag.sequence, config.neighbor_addrs[recv_port]);
+                    #endif
 
-                        // Forward received FLOOD from neighbour via OUTPUT port to user stack
-                        if( (err = mixnet_send(handle, user_port, recvd_packet)) < 0){
-                            printf("Error sending FLOOD pkt to user\n");
-                        }
+                    // Broadcast to every tree neighbour but the one it came from
+                    broadcast_flood(handle, &(node->txq), &(node->mixer),
+                                    node->stp_ports & ~port_mask_bit(recv_port), &tag);
 
-                        // Temporarily block receiving port while broadcasting to other neighbours
-                        stp_ports[recv_port] = 0;
-                        broadcast_flood(handle, config, stp_ports);
-                        stp_ports[recv_port] = 1;
+                    // Forward received FLOOD from neighbour via OUTPUT port to user stack (untagged)
+                    recvd_packet->payload_size = 0;
+                    mix_packet(handle, &(node->txq), &(node->mixer), user_port, recvd_packet);
 
-                        #if DEBUG_FLOOD
-                        printf("[%u] Delivered FLOOD pkt to user\n", config.node_addr);
-                        #endif
-                    }                    
+                    #if DEBUG_FLOOD
+                    printf("[%u] Delivered FLOOD pkt to user\n", config.node_addr);
+                    #endif
                     } break;
-                
-                default: break;
-            }
-        } else {
-            gettimeofday(&election_timer, NULL);
-            if ((!is_root(config, &stp_route_db) && diff_in_microseconds(election_timer_start, election_timer) >= config.reelection_interval_ms * 1000)){
-                gettimeofday(&election_timer_start, NULL);
-                // printf("election interval elapsed. Resetting ports. Node %d thinks it's root \n", config.node_addr);
-                // print_ports(config, stp_ports);
-                // Node thinks it's now the root. Forget about stale spanning tree
-                stp_route_db.root_address = config.node_addr;
-                stp_route_db.path_length = 0;
-                stp_route_db.next_hop_address = config.node_addr;
-                activate_all_ports(config, stp_ports);
-                stp_parent_addr = -1;
-                stp_parent_path_length = -1;
 
-                //Reset hello_timer_start
-                broadcast_stp(handle, config, &stp_route_db);
-                gettimeofday(&root_hello_timer_start, NULL); 
+                // Install news in the LSDB and flood it onwards
+                case PACKET_TYPE_LSA: {
+                    mixnet_packet_lsa *lsa = (mixnet_packet_lsa *) recvd_packet->payload;
+                    mixnet_address *lsa_neighbors = (mixnet_address *) (
+                        recvd_packet->payload + sizeof(mixnet_packet_lsa));
+                    const uint32_t now_ms = (uint32_t) (timer_now_us() / 1000);
+
+                    // Our own LSA is authoritative; only flood what changed (or
+                    // refreshed) the LSDB, which also stops LSAs from circulating
+                    // on loops. Duplicates (e.g., from re-syncs) are dropped up front.
+                    if (recv_port == user_port) {
+                        count_drop(handle, MIXNET_DROP_BLOCKED);
+                    } else if (lsa->node_address == config.node_addr) {
+                        // Nothing to learn
+                    } else if (!dedup_check_and_mark(&(node->lsa_seen), lsa->node_address, lsa->sequence)) {
+                        count_drop(handle, MIXNET_DROP_DUPLICATE);
+                    } else if (lsdb_update(&(node->lsdb), lsa->node_address, lsa->sequence,
+                                           lsa->neighbor_count, lsa_neighbors, now_ms)) {
+                        #if DEBUG_ROUTING
+                        printf("[%u] LSA update from %u (%u neighbors)\n",
+                            config.node_addr, lsa->node_address, lsa->neighbor_count);
+                        #endif
+                        routing_thread_submit_lsa(&(node->routing_thread), lsa->node_address,
+                                                  lsa->sequence, lsa->neighbor_count,
+                                                  lsa_neighbors, now_ms);
+                        flood_lsa(handle, &(node->txq), config, &(node->lsdb),
+                                  lsdb_find(&(node->lsdb), lsa->node_address),
+                                  node->link_ports, recv_port);
+                    }
+                    mixnet_packet_free(handle, recvd_packet);
+                    } break;
 
+                case PACKET_TYPE_DATA:
+                case PACKET_TYPE_PING: {
+                    // Packet received on INPUT port. Compute its source route
+                    // (using whichever FIB the routing thread published last)
+                    const struct fib_snapshot *fib = routing_thread_fib(&(node->routing_thread));
+                    if (recv_port == user_port) {
+                        route_user_packet(handle, &(node->txq), config, fib, &(node->rr_rng_state), &(node->neighbor_index), node->link_ports, &(node->mixer), recvd_packet);
+                    } else {
+                        forward_routed_packet(handle, &(node->txq), config, fib, &(node->neighbor_index), node->link_ports, &(node->mixer), recvd_packet);
+                    }
+                    } break;
+                
+                default: {
+                    count_drop(handle, MIXNET_DROP_MALFORMED);
+                    mixnet_packet_free(handle, recvd_packet);
+                    } break;
             }
-
         }
-
     }
+
+    routing_thread_stop(&(node->routing_thread));
+    node_context_destroy(handle, node);
 } 
 
 void broadcast_stp(void *handle, 
+                   struct tx_queues *txq,
                    const struct mixnet_node_config config, 
                    stp_route_t *stp_route_db)
 {
     mixnet_packet_stp stp_payload;
     int err=0;
-    for (size_t nid = 0; nid < config.num_neighbors; nid++) {
-        mixnet_packet* broadcast_packet = malloc(sizeof(mixnet_packet) + sizeof(mixnet_packet_stp));
-        broadcast_packet->src_address = config.node_addr;
-        broadcast_packet->dst_address = config.neighbor_addrs[nid];
-        broadcast_packet->type = PACKET_TYPE_STP;
-        broadcast_packet->payload_size = sizeof(mixnet_packet_stp);
+    if (config.num_neighbors == 0) return;
 
-        stp_payload.root_address = stp_route_db->root_address;
-        stp_payload.path_length = stp_route_db->path_length;
-        stp_payload.node_address = config.node_addr;
+    // One buffer, sent to every neighbor (hence no single dst_address)
+    mixnet_packet* broadcast_packet = mixnet_packet_alloc(handle, sizeof(mixnet_packet) + sizeof(mixnet_packet_stp));
+    if (broadcast_packet == NULL) {
+        count_drop(handle, MIXNET_DROP_NO_MEMORY);
+        return;
+    }
+    broadcast_packet->src_address = config.node_addr;
+    broadcast_packet->dst_address = 0;
+    broadcast_packet->type = PACKET_TYPE_STP;
+    broadcast_packet->payload_size = sizeof(mixnet_packet_stp);
+
+    stp_payload.root_address = stp_route_db->root_address;
+    stp_payload.path_length = stp_route_db->path_length;
+    stp_payload.node_address = config.node_addr;
+
+    memcpy(broadcast_packet->payload, &stp_payload, sizeof(mixnet_packet_stp));
+
+    #if DEBUG_STP
+    printf("[%u] Broadcast (%u, %u, %u) to neighbours\n", 
+        config.node_addr,
+        stp_payload.root_address, stp_payload.path_length, stp_payload.node_address);
+    #endif
+
+    if( (err = txq_send_multi(handle, txq, port_mask_all(config.num_neighbors), broadcast_packet)) < 0) {
+        printf("Error sending STP pkt\n");
+        mixnet_packet_free(handle, broadcast_packet);
+    }
+}
 
-        memcpy(broadcast_packet->payload, &stp_payload, sizeof(mixnet_packet_stp));
+// Tells rapid STP about links that went up or down since the last poll
+// (poll_link_states keeps link_ports current).
+void poll_rstp_links(const struct mixnet_node_config config,
+                     struct node_context *node)
+{
+    for (uint16_t nid = 0; nid < config.num_neighbors; nid++) {
+        rstp_link_changed(&(node->rstp), nid, port_mask_has(node->link_ports, nid));
+    }
+}
+
+// Sends the BPDUs rapid STP has queued, and mirrors the resulting tree
+// into the STP route and ports used for FLOOD packets.
+void flush_rstp(void *handle,
+                const struct mixnet_node_config config,
+                struct node_context *node)
+{
+    int err=0;
+    mixnet_packet_rstp bpdu;
+    for (uint16_t nid = 0; nid < config.num_neighbors; nid++) {
+        if (!rstp_take_bpdu(&(node->rstp), nid, &bpdu)) continue;
+
+        mixnet_packet *packet = mixnet_packet_alloc(handle, sizeof(mixnet_packet) + sizeof(mixnet_packet_rstp));
+        if (packet == NULL) {
+            count_drop(handle, MIXNET_DROP_NO_MEMORY);
+            continue;
+        }
+        packet->src_address = config.node_addr;
+        packet->dst_address = config.neighbor_addrs[nid];
+        packet->type = PACKET_TYPE_STP;
+        packet->payload_size = sizeof(mixnet_packet_rstp);
+        memcpy(packet->payload, &bpdu, sizeof(mixnet_packet_rstp));
 
         #if DEBUG_STP
-        printf("[%u] Broadcast (%u, %u, %u) to neighbours\n", 
-            config.node_addr,
-            stp_payload.root_address, stp_payload.path_length, stp_payload.node_address);
+        printf("[%u] RSTP (%u, %u, %u, flags %u) to Node %u\n",
+            config.node_addr, bpdu.root_address, bpdu.path_length,
+            bpdu.node_address, bpdu.flags, config.neighbor_addrs[nid]);
         #endif
 
-        if( (err = mixnet_send(handle, nid, broadcast_packet)) < 0) {
-            printf("Error sending STP pkt\n");
+        if( (err = txq_send(handle, &(node->txq), nid, packet)) < 0) {
+            printf("Error sending RSTP pkt\n");
+            mixnet_packet_free(handle, packet);
+        }
+    }
+    node->stp_ports = 0;
+    for (uint16_t nid = 0; nid < config.num_neighbors; nid++) {
+        if (rstp_is_forwarding(&(node->rstp), nid)) { node->stp_ports |= port_mask_bit(nid); }
+    }
+    node->stp_route_db.root_address = node->rstp.root.root_address;
+    node->stp_route_db.path_length = node->rstp.root.path_length;
+    node->stp_route_db.next_hop_address = node->rstp.root.node_address;
+
+    // Convergence Metrics: time each reconfiguration until it settles
+    if (node->rstp.num_changes != node->rstp_changes_seen) {
+        node->rstp_changes_seen = node->rstp.num_changes;
+        if (node->printed_convergence) {
+            gettimeofday(&(node->convergence_timer_start), NULL);
+            node->printed_convergence = false;
+            mixnet_stats_set(&(mixnet_get_stats(handle)->stp_changed_us), timer_now_us());
         }
     }
+    if (!node->printed_convergence && rstp_is_stable(&(node->rstp))) {
+        struct timeval convergence_timer;
+        gettimeofday(&convergence_timer, NULL);
+        printf("[%u] @ %lf us: (my_root: %u, path_len: %u, next_hop: %u) -- in %u STP packets\n",
+            config.node_addr,
+            diff_in_microseconds(node->convergence_timer_start, convergence_timer) / 1000.0,
+            node->stp_route_db.root_address,
+            node->stp_route_db.path_length,
+            node->stp_route_db.next_hop_address,
+            node->stp_pkt_ct);
+        node->printed_convergence = true;
+        count_convergence(handle);
+    }
 }
 
 void broadcast_flood(void *handle, 
-                     const struct mixnet_node_config config, 
-                     uint8_t *active_ports) 
+                     struct tx_queues *txq,
+                     struct mixer *mixer,
+                     port_mask_t active_ports,
+                     const mixnet_packet_flood *tag) 
+{
+    if (active_ports == 0) return;
+
+    mixnet_packet *flood_pkt = mixnet_packet_alloc(handle, sizeof(mixnet_packet) + sizeof(mixnet_packet_flood)); // flood packet received to be broadcast across STP tree
+    if (flood_pkt == NULL) {
+        count_drop(handle, MIXNET_DROP_NO_MEMORY);
+        return;
+    }
+    flood_pkt->src_address = 0;
+    flood_pkt->dst_address = 0;
+    flood_pkt->type = PACKET_TYPE_FLOOD;
+    flood_pkt->payload_size = sizeof(mixnet_packet_flood);
+    memcpy(flood_pkt->payload, tag, sizeof(mixnet_packet_flood));
+
+    #if DEBUG_FLOOD
+    printf("Broadcast FLOOD (%u, %u) to ports 0x%llx\n", tag->origin_address,
+        tag->sequence, (unsigned long long) active_ports);
+    #endif 
+
+    mix_broadcast(handle, txq, mixer, active_ports, flood_pkt);
+}
+
+void originate_lsa(void *handle,
+                   struct tx_queues *txq,
+                   const struct mixnet_node_config config,
+                   struct lsdb *db,
+                   struct routing_thread *rt,
+                   port_mask_t link_ports)
+{
+    mixnet_address *neighbors = calloc(config.num_neighbors + 1, sizeof(mixnet_address));
+    uint16_t neighbor_count = 0;
+    if (neighbors == NULL) {
+        // The next refresh (or link change) originates it instead
+        count_drop(handle, MIXNET_DROP_NO_MEMORY);
+        return;
+    }
+
+    // Advertise only the neighbors whose links are currently up
+    for (port_mask_t ports = link_ports; ports != 0; ) {
+        neighbors[neighbor_count++] = config.neighbor_addrs[port_mask_pop(&ports)];
+    }
+    // A new LSA supersedes the one we last advertised
+    const uint16_t sequence = lsdb_find(db, config.node_addr)->sequence + 1;
+    const uint32_t now_ms = (uint32_t) (timer_now_us() / 1000);
+    lsdb_update(db, config.node_addr, sequence, neighbor_count, neighbors, now_ms);
+    routing_thread_submit_lsa(rt, config.node_addr, sequence, neighbor_count, neighbors, now_ms);
+    free(neighbors);
+    flood_lsa(handle, txq, config, db, lsdb_find(db, config.node_addr),
+              link_ports, config.num_neighbors);
+}
+
+void send_lsa(void *handle,
+              struct tx_queues *txq,
+              const struct mixnet_node_config config,
+              const struct lsdb *db,
+              const struct lsdb_entry *entry,
+              port_mask_t port_mask)
 {
     int err=0;
-    mixnet_packet *flood_pkt;
-
-    for (size_t nid = 0; nid < config.num_neighbors; nid++) {
-        if(active_ports[nid]) {
-            flood_pkt = malloc(sizeof(mixnet_packet)); // flood packet received to be broadcast across STP tree
-            flood_pkt->src_address = 0;
-            flood_pkt->dst_address = 0;
-            flood_pkt->type = PACKET_TYPE_FLOOD;
-            flood_pkt->payload_size = 0;
-
-            if( (err = mixnet_send(handle, nid, flood_pkt)) < 0){
-                printf("Error sending FLOOD pkt\n");
+    if (port_mask == 0) return;
+
+    const uint16_t payload_size = sizeof(mixnet_packet_lsa) +
+                                  (sizeof(mixnet_address) * entry->neighbor_count);
+
+    mixnet_packet *lsa_pkt = mixnet_packet_alloc(handle, sizeof(mixnet_packet) + payload_size);
+    if (lsa_pkt == NULL) {
+        count_drop(handle, MIXNET_DROP_NO_MEMORY);
+        return;
+    }
+    lsa_pkt->src_address = config.node_addr;
+    lsa_pkt->dst_address = 0;
+    lsa_pkt->type = PACKET_TYPE_LSA;
+    lsa_pkt->payload_size = payload_size;
+
+    mixnet_packet_lsa *lsa = (mixnet_packet_lsa *) lsa_pkt->payload;
+    lsa->node_address = entry->node_address;
+    lsa->neighbor_count = entry->neighbor_count;
+    lsa->sequence = entry->sequence;
+    memcpy(lsa_pkt->payload + sizeof(mixnet_packet_lsa), lsdb_neighbors(db, entry),
+           sizeof(mixnet_address) * entry->neighbor_count);
+
+    if( (err = txq_send_multi(handle, txq, port_mask, lsa_pkt)) < 0) {
+        printf("Error sending LSA pkt\n");
+        mixnet_packet_free(handle, lsa_pkt);
+    }
+}
+
+// Floods an LSDB entry on every live port except the one it came in on
+void flood_lsa(void *handle,
+               struct tx_queues *txq,
+               const struct mixnet_node_config config,
+               const struct lsdb *db,
+               const struct lsdb_entry *entry,
+               port_mask_t link_ports,
+               uint8_t recv_port)
+{
+    if (entry == NULL) return;
+    send_lsa(handle, txq, config, db, entry, link_ports & ~port_mask_bit(recv_port));
+}
+
+void poll_link_states(void *handle,
+                      struct tx_queues *txq,
+                      const struct mixnet_node_config config,
+                      struct lsdb *db,
+                      struct routing_thread *rt,
+                      port_mask_t *link_ports)
+{
+    port_mask_t is_up = 0;
+    for (uint16_t nid = 0; nid < config.num_neighbors; nid++) {
+        if (mixnet_link_is_up(handle, nid)) { is_up |= port_mask_bit(nid); }
+    }
+    if (is_up == *link_ports) return;
+    const port_mask_t new_ports = is_up & ~(*link_ports);
+    *link_ports = is_up;
+
+    #if DEBUG_ROUTING
+    printf("[%u] Link state changed, re-advertising\n", config.node_addr);
+    print_ports(config, *link_ports);
+    #endif
+
+    // Flood our new adjacency (a single LSA, however many links flipped).
+    // Only neighbors whose links just came up may have missed floods, so
+    // they alone get the rest of the LSDB to catch up; peers only re-flood
+    // entries that are newer than their own. Entries the routing thread
+    // has aged out are left behind, since they no longer carry routes.
+    originate_lsa(handle, txq, config, db, rt, *link_ports);
+    if (new_ports == 0) return;
+    const uint32_t now_ms = (uint32_t) (timer_now_us() / 1000);
+    for (uint32_t idx = 0; idx < db->num_entries; idx++) {
+        const struct lsdb_entry *entry = &(db->entries[idx]);
+        if ((entry->node_address != config.node_addr) &&
+            ((uint32_t) (now_ms - entry->updated_ms) <= LSA_MAX_AGE_MS)) {
+            send_lsa(handle, txq, config, db, entry, new_ports);
+        }
+    }
+}
+
+// Prepends a route template (a random candidate, if this node does
+// random routing, else one of the equal-cost routes if it does ECMP,
+// else the FIB's) to a DATA/PING packet from the user, "fixing up" its
+// payload in place (the buffer is maximum-sized).
+void route_user_packet(void *handle,
+                       struct tx_queues *txq,
+                       const struct mixnet_node_config config,
+                       const struct fib_snapshot *fib,
+                       uint64_t *rng_state,
+                       const struct port_index *neighbors,
+                       port_mask_t link_ports,
+                       struct mixer *mixer,
+                       mixnet_packet *packet)
+{
+    const struct fib_entry *entry = NULL;
+    const mixnet_packet_routing_header *route_template = NULL;
+
+    // User DATA arrives with payload_size set to the data size
+    const uint16_t data_size = (packet->type == PACKET_TYPE_DATA) ?
+                               packet->payload_size : sizeof(mixnet_packet_ping);
+
+    if (config.use_random_routing) {
+        entry = rr_sample(fib, rng_state, packet->dst_address, &route_template);
+    } else if (config.use_ecmp) {
+        // PINGs carry no user data, so hash only the endpoints
+        const uint16_t prefix_size = (packet->type == PACKET_TYPE_DATA) ? data_size : 0;
+        const uint64_t hash = flow_hash(packet->src_address, packet->dst_address,
+                                        packet->payload + sizeof(mixnet_packet_routing_header),
+                                        prefix_size);
+        entry = ecmp_select(fib, packet->dst_address, hash, &route_template);
+    }
+    // Shortest path (also used if the random route would not fit)
+    if (entry == NULL ||
+        (sizeof(mixnet_packet) + fib_template_size(entry) + data_size) > MAX_MIXNET_PACKET_SIZE) {
+        entry = fib_snapshot_lookup(fib, packet->dst_address);
+        if (entry != NULL) { route_template = fib_snapshot_route_template(fib, packet->dst_address, entry); }
+    }
+    // First hop is down (FIB not yet updated), use a loop-free alternate
+    if (entry != NULL && entry->port != config.num_neighbors &&
+        !mixnet_link_is_up(handle, entry->port)) {
+        link_ports &= ~port_mask_bit(entry->port);
+    }
+    if (entry != NULL && entry->port != config.num_neighbors &&
+        !port_mask_has(link_ports, entry->port)) {
+        entry = lfa_select(fib, packet->dst_address, link_ports, &route_template);
+    }
+    if (entry == NULL ||
+        (sizeof(mixnet_packet) + fib_template_size(entry) + data_size) > MAX_MIXNET_PACKET_SIZE) {
+        #if DEBUG_ROUTING
+        printf("[%u] No route to %u, dropping\n", config.node_addr, packet->dst_address);
+        #endif
+        count_drop(handle, MIXNET_DROP_NO_ROUTE);
+        mixnet_packet_free(handle, packet);
+        return;
+    }
+
+    // User data follows an empty routing header (see mixnet_recv)
+    const size_t template_size = fib_template_size(entry);
+    char *data = packet->payload + template_size;
+    if (packet->type == PACKET_TYPE_DATA) {
+        memmove(data, packet->payload + sizeof(mixnet_packet_routing_header), data_size);
+    } else {
+        mixnet_packet_ping ping = {.ping_direction = 0, .send_time = time_in_microseconds()};
+        memcpy(data, &ping, sizeof(mixnet_packet_ping));
+    }
+    memcpy(packet->payload, route_template, template_size);
+    packet->payload_size = template_size + data_size;
+
+    if (entry->port == config.num_neighbors) {
+        deliver_routed_packet(handle, txq, config, fib, neighbors, link_ports, mixer, packet);
+        return;
+    }
+    mix_packet(handle, txq, mixer, entry->port, packet);
+}
+
+// Handles a source-routed packet received from a neighbor
+void forward_routed_packet(void *handle,
+                           struct tx_queues *txq,
+                           const struct mixnet_node_config config,
+                           const struct fib_snapshot *fib,
+                           const struct port_index *neighbors,
+                           port_mask_t link_ports,
+                           struct mixer *mixer,
+                           mixnet_packet *packet)
+{
+    mixnet_packet_routing_header *rh = (mixnet_packet_routing_header *) packet->payload;
+    mixnet_address *route = (mixnet_address *) rh->route;
+
+    if (rh->hop_index >= rh->route_length) {
+        // Reached the end of the route
+        if (packet->dst_address == config.node_addr) {
+            deliver_routed_packet(handle, txq, config, fib, neighbors, link_ports, mixer, packet);
+        } else {
+            count_drop(handle, MIXNET_DROP_MISROUTED);
+            mixnet_packet_free(handle, packet);
+        }
+    } else if (route[rh->hop_index] == config.node_addr) {
+        // We are the current hop, advance along the route
+        rh->hop_index++;
+        send_routed_packet(handle, txq, config, fib, neighbors, link_ports, mixer, packet);
+    } else {
+        count_drop(handle, MIXNET_DROP_MISROUTED);
+        mixnet_packet_free(handle, packet); // Misrouted
+    }
+}
+
+// Sends a source-routed packet to its next hop (or delivers it locally)
+void send_routed_packet(void *handle,
+                        struct tx_queues *txq,
+                        const struct mixnet_node_config config,
+                        const struct fib_snapshot *fib,
+                        const struct port_index *neighbors,
+                        port_mask_t link_ports,
+                        struct mixer *mixer,
+                        mixnet_packet *packet)
+{
+    mixnet_packet_routing_header *rh = (mixnet_packet_routing_header *) packet->payload;
+    mixnet_address *route = (mixnet_address *) rh->route;
+
+    const mixnet_address next_hop = (rh->hop_index < rh->route_length) ?
+                                    route[rh->hop_index] : packet->dst_address;
+
+    if (next_hop == config.node_addr) {
+        deliver_routed_packet(handle, txq, config, fib, neighbors, link_ports, mixer, packet);
+        return;
+    }
+    // Also check the link itself, in case it failed since the last poll
+    int port = port_index_find(neighbors, next_hop);
+    if (port >= 0 && !mixnet_link_is_up(handle, port)) {
+        link_ports &= ~port_mask_bit(port);
+    }
+    if (port < 0 || !port_mask_has(link_ports, port)) {
+        port = repair_routed_packet(fib, link_ports, packet);
+    }
+    if (port < 0) {
+        count_drop(handle, MIXNET_DROP_NO_ROUTE);
+        mixnet_packet_free(handle, packet); // Next hop is unreachable
+        return;
+    }
+    mix_packet(handle, txq, mixer, port, packet);
+}
+
+// Local repair: re-routes a packet whose next hop is unreachable along
+// a loop-free alternate, keeping the hops it has already visited. This
+// happens in the data path, before any LSAs are exchanged. Returns the
+// new next hop's port, or -1 if there is no (fitting) alternate.
+int repair_routed_packet(const struct fib_snapshot *fib,
+                         port_mask_t link_ports,
+                         mixnet_packet *packet)
+{
+    const mixnet_packet_routing_header *route_template = NULL;
+    const struct fib_entry *entry = lfa_select(fib, packet->dst_address,
+                                                link_ports, &route_template);
+    if (entry == NULL) { return -1; }
+
+    mixnet_packet_routing_header *rh = (mixnet_packet_routing_header *) packet->payload;
+    const size_t old_route_size = sizeof(mixnet_address) * rh->route_length;
+    const size_t data_size = packet->payload_size - sizeof(mixnet_packet_routing_header) - old_route_size;
+    const uint32_t route_length = (uint32_t) rh->hop_index + entry->route_length;
+    const size_t new_route_size = sizeof(mixnet_address) * route_length;
+    const size_t total_size = sizeof(mixnet_packet) + sizeof(mixnet_packet_routing_header) +
+                              new_route_size + data_size;
+
+    // Routed packets are maximum-sized buffers (see mixnet_recv), so
+    // a longer route fits in place
+    if (total_size > MAX_MIXNET_PACKET_SIZE) { return -1; }
+
+    // Splice the alternate in after the visited hops, then the data
+    memmove(rh->route + new_route_size, rh->route + old_route_size, data_size);
+    memcpy(rh->route + (sizeof(mixnet_address) * rh->hop_index),
+           route_template->route, sizeof(mixnet_address) * entry->route_length);
+    rh->route_length = (uint16_t) route_length;
+    packet->payload_size = (uint16_t) (total_size - sizeof(mixnet_packet));
+    return entry->port;
+}
+
+// Delivers a packet destined for this node to the user, answering PINGs
+void deliver_routed_packet(void *handle,
+                           struct tx_queues *txq,
+                           const struct mixnet_node_config config,
+                           const struct fib_snapshot *fib,
+                           const struct port_index *neighbors,
+                           port_mask_t link_ports,
+                           struct mixer *mixer,
+                           mixnet_packet *packet)
+{
+    const uint8_t user_port = config.num_neighbors;
+    mixnet_packet_routing_header *rh = (mixnet_packet_routing_header *) packet->payload;
+    mixnet_address *route = (mixnet_address *) rh->route;
+
+    if (packet->type == PACKET_TYPE_PING) {
+        mixnet_packet_ping *ping = (mixnet_packet_ping *) (
+            rh->route + (sizeof(mixnet_address) * rh->route_length));
+
+        // Answer requests along the reversed route
+        if (ping->ping_direction == 0) {
+            const size_t total_size = sizeof(mixnet_packet) + packet->payload_size;
+            // Maximum-sized, like received packets (its route may grow)
+            mixnet_packet *response = mixnet_packet_alloc(handle, MAX_MIXNET_PACKET_SIZE);
+            if (response == NULL) {
+                count_drop(handle, MIXNET_DROP_NO_MEMORY);
+                mixnet_packet_free(handle, packet);
+                return;
             }
+            memcpy(response, packet, total_size);
+            response->src_address = packet->dst_address;
+            response->dst_address = packet->src_address;
+
+            mixnet_packet_routing_header *response_rh = (
+                (mixnet_packet_routing_header *) response->payload);
+            mixnet_address *response_route = (mixnet_address *) response_rh->route;
+            for (uint16_t i = 0; i < rh->route_length; i++) {
+                response_route[i] = route[rh->route_length - 1 - i];
+            }
+            response_rh->hop_index = 0;
+
+            mixnet_packet_ping *response_ping = (mixnet_packet_ping *) (
+                response_rh->route + (sizeof(mixnet_address) * rh->route_length));
+            response_ping->ping_direction = 1;
+
+            send_routed_packet(handle, txq, config, fib, neighbors, link_ports, mixer, response);
+        }
+    }
+    mix_packet(handle, txq, mixer, user_port, packet);
+}
+
+// Hands a DATA/PING/FLOOD packet to the mixer, sending out the whole
+// batch (in a random order) once mixing_factor packets have been buffered.
+void mix_packet(void *handle,
+                struct tx_queues *txq,
+                struct mixer *mixer,
+                uint8_t port,
+                mixnet_packet *packet)
+{
+    if (mixer_add(mixer, port, packet)) { release_mixed(handle, txq, mixer); }
+}
+
+// Same, for a FLOOD broadcast on several ports (it takes a single slot)
+void mix_broadcast(void *handle,
+                   struct tx_queues *txq,
+                   struct mixer *mixer,
+                   port_mask_t port_mask,
+                   mixnet_packet *packet)
+{
+    if (mixer_add_multi(mixer, port_mask, packet)) { release_mixed(handle, txq, mixer); }
+}
 
-            #if DEBUG_FLOOD
-            printf("[%u] Broadcast FLOOD to Node %u\n", 
-                config.node_addr,
-                config.neighbor_addrs[nid]);
-            #endif 
+// Sends out a full batch of mixed packets
+void release_mixed(void *handle,
+                   struct tx_queues *txq,
+                   struct mixer *mixer)
+{
+    int err=0;
+    uint16_t num_slots = 0;
+    const struct mixer_slot *slots = mixer_release(mixer, &num_slots);
+    for (uint16_t i = 0; i < num_slots; i++) {
+        err = (slots[i].port_mask != 0) ?
+              txq_send_multi(handle, txq, slots[i].port_mask, slots[i].packet) :
+              txq_send(handle, txq, slots[i].port, slots[i].packet);
+        if (err < 0) {
+            printf("Error sending mixed pkt\n");
+            mixnet_packet_free(handle, slots[i].packet);
         }
     }
 }
@@ -378,37 +1229,22 @@ bool is_root(const struct mixnet_node_config config, stp_route_t *stp_route_db){
 }
 
 
-void activate_all_ports(const struct mixnet_node_config config, uint8_t *ports){
-    for(int nid=0; nid<config.num_neighbors; nid++){
-        ports[nid] = 1;
-    }
-}
-
-void deactivate_all_ports(const struct mixnet_node_config config, uint8_t *ports){
-    for(int nid=0; nid<config.num_neighbors; nid++){
-        ports[nid] = 0;
-    }
-}
-
 //TODO: Be careful about thre transformational all-in-one nature of this function. Might overdo certain this we don't want it to as impl expands
-void port_to_neighbor(const struct mixnet_node_config config, 
+void port_to_neighbor(const struct port_index *neighbors, 
                         mixnet_address niegbhor_addr, 
-                        uint8_t *ports, 
+                        port_mask_t *ports, 
                         enum port_decision decision) {
     
-    for(int nid=0; nid<config.num_neighbors; nid++){
-        if(config.neighbor_addrs[nid] == niegbhor_addr){
+    const int nid = port_index_find(neighbors, niegbhor_addr);
+    if (nid < 0) return;
 
-            if(decision == BLOCK_PORT)
-                ports[nid] = 0;
-            else if(decision == OPEN_PORT)
-                ports[nid] = 1;      
-            break;
-        }
-    } 
+    if(decision == BLOCK_PORT)
+        *ports &= ~port_mask_bit(nid);
+    else if(decision == OPEN_PORT)
+        *ports |= port_mask_bit(nid);
 }
 
-void print_ports(const struct mixnet_node_config config, uint8_t *ports){
+void print_ports(const struct mixnet_node_config config, port_mask_t ports){
     printf("[%u] Ports [", config.node_addr);
     for(int nid=0; nid<config.num_neighbors; nid++){
         printf("%u", config.neighbor_addrs[nid]);
@@ -419,7 +1255,7 @@ void print_ports(const struct mixnet_node_config config, uint8_t *ports){
 
     printf("[%u]       [", config.node_addr);
     for(int nid=0; nid<config.num_neighbors; nid++){
-        printf("%u", ports[nid]);
+        printf("%u", port_mask_has(ports, nid));
         if(nid != config.num_neighbors-1)
             printf(", ");
     }
@@ -434,13 +1270,9 @@ void print_packet_header(mixnet_packet *packet) {
         packet->payload_size);
 }
 
-int get_port_from_addr(const struct mixnet_node_config config, mixnet_address next_hop_address, uint8_t *stp_ports){
-    for(int nid=0; nid<config.num_neighbors; nid++){
-        if(config.neighbor_addrs[nid] == next_hop_address) {
-            if(stp_ports[nid]) return nid;
-            else               return -1;
-        }
-    }
+int get_port_from_addr(const struct port_index *neighbors, mixnet_address next_hop_address, port_mask_t stp_ports){
+    const int nid = port_index_find(neighbors, next_hop_address);
+    if (nid >= 0 && port_mask_has(stp_ports, nid)) return nid;
     return -1;
 }
 
@@ -448,3 +1280,19 @@ int get_port_from_addr(const struct mixnet_node_config config, mixnet_address ne
 double diff_in_microseconds(struct timeval b4, struct timeval later){
     return (later.tv_sec - b4.tv_sec) * 1000000 + (later.tv_usec - b4.tv_usec);
 }
+
+uint64_t time_in_microseconds(void){
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return ((uint64_t) now.tv_sec * 1000000) + now.tv_usec;
+}
+
+void count_drop(void *handle, enum mixnet_drop_reason_enum reason){
+    mixnet_stats_add(&(mixnet_get_stats(handle)->drops[reason]), 1);
+}
+
+void count_convergence(void *handle){
+    struct mixnet_stats *stats = mixnet_get_stats(handle);
+    mixnet_stats_set(&(stats->stp_converged_us), timer_now_us());
+    mixnet_stats_add(&(stats->stp_num_convergences), 1);
+}
@@ -68,15 +68,51 @@ typedef struct mixnet_packet_stp {
 }__attribute__((packed)) mixnet_packet_stp;
 CHECK_ALIGNMENT_AND_SIZE(mixnet_packet_stp, 6, 2);
 
+/**
+ * Represents the payload for an STP packet in rapid STP mode. This is
+ * the regular STP payload, followed by the sending port's flags.
+ */
+typedef struct mixnet_packet_rstp {
+    mixnet_address root_address;    // Root of the spanning tree
+    uint16_t path_length;           // Length of path to the root
+    mixnet_address node_address;    // Current node's mixnet address
+    uint16_t flags;                 // RSTP_FLAG_* bits
+
+}__attribute__((packed)) mixnet_packet_rstp;
+CHECK_ALIGNMENT_AND_SIZE(mixnet_packet_rstp, 8, 2);
+
+/**
+ * Rapid STP flags.
+ */
+enum mixnet_rstp_flag_enum {
+    RSTP_FLAG_PROPOSAL = (1 << 0),  // Designated port asks to forward
+    RSTP_FLAG_AGREEMENT = (1 << 1), // Reply to a proposal
+    RSTP_FLAG_DESIGNATED = (1 << 2),// Sent from a designated port
+};
+
+/**
+ * Represents the payload for a FLOOD packet between nodes: the node
+ * that injected it (from its user port) and that node's sequence
+ * number for it, used to suppress duplicates. Packets to and from the
+ * user port carry no payload.
+ */
+typedef struct mixnet_packet_flood {
+    mixnet_address origin_address;  // Originating node's mixnet address
+    uint16_t sequence;              // Origin's FLOOD sequence number
+
+}__attribute__((packed)) mixnet_packet_flood;
+CHECK_ALIGNMENT_AND_SIZE(mixnet_packet_flood, 4, 2);
+
 /**
  * Represents the payload for an LSA packet.
  */
 typedef struct mixnet_packet_lsa {
     mixnet_address node_address;    // Advertising node's mixnet address
     uint16_t neighbor_count;        // Length of path to the root
+    uint16_t sequence;              // Advertising node's LSA sequence number
 
 }__attribute__((packed)) mixnet_packet_lsa;
-CHECK_ALIGNMENT_AND_SIZE(mixnet_packet_lsa, 4, 2);
+CHECK_ALIGNMENT_AND_SIZE(mixnet_packet_lsa, 6, 2);
 
 /**
  * Represents a Routing Header (RH).
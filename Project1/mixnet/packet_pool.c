@@ -0,0 +1,150 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the Mixnet course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the Mixnet project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#include "packet_pool.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+/**
+ * Precedes every block's packet (its size keeps packets 16-byte
+ * aligned). The link is only used while the block is in the depot.
+ */
+struct pool_block {
+    struct pool_block *next;        // Next free block (depot only)
+    uint32_t size_class;            // Index of the block's size class
+    uint32_t reserved;
+};
+
+/**
+ * Per-thread cache of free blocks, per size class (LIFO, so recently
+ * freed blocks are handed out first, while still cache-warm).
+ */
+struct pool_cache {
+    struct pool_block *blocks[PACKET_POOL_NUM_CLASSES][PACKET_POOL_CACHE_SIZE];
+    uint32_t counts[PACKET_POOL_NUM_CLASSES];
+    bool is_registered;             // Flushed on thread exit?
+};
+
+static __thread struct pool_cache thread_cache;
+static pthread_key_t cache_key;
+static pthread_once_t cache_key_once = PTHREAD_ONCE_INIT;
+
+// Shared depot of free blocks (guarded by the lock)
+static pthread_mutex_t depot_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct pool_block *depot[PACKET_POOL_NUM_CLASSES];
+
+static size_t class_size(const uint32_t size_class) {
+    return ((size_t) PACKET_POOL_MIN_CLASS_SIZE << size_class);
+}
+
+static uint32_t class_of(const size_t size) {
+    uint32_t size_class = 0;
+    while (class_size(size_class) < size) { size_class++; }
+    return size_class;
+}
+
+// Moves up to num_blocks cached blocks of a class to the depot
+static void pool_cache_flush(struct pool_cache *cache,
+                             const uint32_t size_class,
+                             const uint32_t num_blocks) {
+    pthread_mutex_lock(&depot_lock);
+    for (uint32_t i = 0; (i < num_blocks) && (cache->counts[size_class] > 0); i++) {
+        struct pool_block *block = (
+            cache->blocks[size_class][--cache->counts[size_class]]);
+
+        block->next = depot[size_class];
+        depot[size_class] = block;
+    }
+    pthread_mutex_unlock(&depot_lock);
+}
+
+// Thread exit: hands the cached blocks over to the depot
+static void pool_cache_release(void *arg) {
+    struct pool_cache *cache = (struct pool_cache *) arg;
+    for (uint32_t c = 0; c < PACKET_POOL_NUM_CLASSES; c++) {
+        pool_cache_flush(cache, c, cache->counts[c]);
+    }
+    cache->is_registered = false;
+}
+
+static void pool_cache_create_key(void) {
+    pthread_key_create(&cache_key, &pool_cache_release);
+}
+
+static struct pool_cache *pool_cache_get(void) {
+    struct pool_cache *cache = &thread_cache;
+    if (!cache->is_registered) {
+        pthread_once(&cache_key_once, &pool_cache_create_key);
+        pthread_setspecific(cache_key, cache);
+        cache->is_registered = true;
+    }
+    return cache;
+}
+
+/**
+ * Refills an empty cache: takes half a cache's worth of blocks from the
+ * depot or, if it has none, carves a new slab (charged to reserved_bytes).
+ *
+ * @return True if the cache has blocks, else false (out of memory)
+ */
+static bool pool_cache_refill(struct pool_cache *cache,
+                              const uint32_t size_class,
+                              uint64_t *reserved_bytes) {
+    pthread_mutex_lock(&depot_lock);
+    while ((cache->counts[size_class] < (PACKET_POOL_CACHE_SIZE / 2)) &&
+           (depot[size_class] != NULL)) {
+        struct pool_block *block = depot[size_class];
+        depot[size_class] = block->next;
+        cache->blocks[size_class][cache->counts[size_class]++] = block;
+    }
+    pthread_mutex_unlock(&depot_lock);
+    if (cache->counts[size_class] > 0) { return true; }
+
+    const size_t stride = sizeof(struct pool_block) + class_size(size_class);
+    char *slab = malloc(stride * PACKET_POOL_SLAB_BLOCKS);
+    if (slab == NULL) { return false; }
+
+    for (uint32_t i = 0; i < PACKET_POOL_SLAB_BLOCKS; i++) {
+        struct pool_block *block = (struct pool_block *) (slab + (stride * i));
+        block->next = NULL;
+        block->size_class = size_class;
+        cache->blocks[size_class][cache->counts[size_class]++] = block;
+    }
+    __atomic_add_fetch(reserved_bytes, (stride * PACKET_POOL_SLAB_BLOCKS),
+                       __ATOMIC_RELAXED);
+    return true;
+}
+
+mixnet_packet *packet_pool_alloc(const size_t size, uint64_t *reserved_bytes) {
+    if (size > MAX_MIXNET_PACKET_SIZE) { return NULL; }
+    const uint32_t size_class = class_of(size);
+
+    struct pool_cache *cache = pool_cache_get();
+    if ((cache->counts[size_class] == 0) &&
+        !pool_cache_refill(cache, size_class, reserved_bytes)) { return NULL; }
+
+    struct pool_block *block = (
+        cache->blocks[size_class][--cache->counts[size_class]]);
+    return (mixnet_packet *) (block + 1);
+}
+
+void packet_pool_free(mixnet_packet *packet) {
+    if (packet == NULL) { return; }
+    struct pool_block *block = ((struct pool_block *) packet) - 1;
+    const uint32_t size_class = block->size_class;
+
+    struct pool_cache *cache = pool_cache_get();
+    if (cache->counts[size_class] == PACKET_POOL_CACHE_SIZE) {
+        pool_cache_flush(cache, size_class, (PACKET_POOL_CACHE_SIZE / 2));
+    }
+    cache->blocks[size_class][cache->counts[size_class]++] = block;
+}
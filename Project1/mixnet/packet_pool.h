@@ -0,0 +1,59 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the Mixnet course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the Mixnet project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#ifndef MIXNET_PACKET_POOL_H
+#define MIXNET_PACKET_POOL_H
+
+#include "packet.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Constant parameters
+#define PACKET_POOL_MIN_CLASS_SIZE  (64)    // Smallest size class (bytes)
+#define PACKET_POOL_NUM_CLASSES     (5)     // Doubling, up to 1024 bytes
+#define PACKET_POOL_CACHE_SIZE      (64)    // Blocks cached per thread and class
+#define PACKET_POOL_SLAB_BLOCKS     (32)    // Blocks carved out per slab
+
+/**
+ * Process-wide allocator for packet buffers. Buffers come in power-of-2
+ * size classes (up to MAX_MIXNET_PACKET_SIZE), carved out of slabs that
+ * are never returned to the system. Each thread allocates from (and
+ * frees into) its own cache of free blocks per class, so the common case
+ * takes no lock; caches exchange half their blocks with a shared depot
+ * when they run empty (or full), e.g., when one thread receives packets
+ * that another frees. A thread's cached blocks go back to the depot when
+ * it exits.
+ */
+
+/**
+ * Returns a buffer of at least size bytes (NULL if the size is larger
+ * than MAX_MIXNET_PACKET_SIZE, or if out of memory). If a new slab has
+ * to be carved out for it, the slab's size is added to reserved_bytes,
+ * so each caller (e.g., a node) is charged for the slabs it reserves,
+ * even if many share the process.
+ */
+mixnet_packet *packet_pool_alloc(const size_t size, uint64_t *reserved_bytes);
+
+/**
+ * Returns a buffer (from packet_pool_alloc) to the pool. Any thread may
+ * free any buffer. Freeing NULL does nothing.
+ */
+void packet_pool_free(mixnet_packet *packet);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MIXNET_PACKET_POOL_H
@@ -0,0 +1,30 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the Mixnet course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the Mixnet project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#include "ports.h"
+
+#include <string.h>
+
+void port_index_init(struct port_index *index, const uint16_t num_ports,
+                     const mixnet_address *neighbor_addrs) {
+    memset(index->ports, 0, sizeof(index->ports));
+    for (uint16_t port = 0; (port < num_ports) &&
+                            (port < PORT_MASK_MAX_PORTS); port++) {
+        const mixnet_address addr = neighbor_addrs[port];
+        if (port_index_find(index, addr) >= 0) { continue; }
+
+        uint32_t slot = port_index_slot(addr);
+        while (index->ports[slot] != 0) {
+            slot = (slot + 1) & (PORT_INDEX_SLOTS - 1);
+        }
+        index->addrs[slot] = addr;
+        index->ports[slot] = (uint8_t) (port + 1);
+    }
+}
@@ -0,0 +1,101 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the Mixnet course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the Mixnet project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#ifndef MIXNET_PORTS_H
+#define MIXNET_PORTS_H
+
+#include "address.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A set of (neighbor) ports, as a bitset: bit i is port i. Nodes have
+ * at most MAX_NUM_NEIGHBORS (64) neighbors, so any set fits in a word.
+ * Ports outside the mask's range (e.g., the user port of a node with
+ * 64 neighbors) are never members.
+ */
+typedef uint64_t port_mask_t;
+#define PORT_MASK_MAX_PORTS 64
+
+static inline port_mask_t port_mask_bit(const uint16_t port) {
+    return (port < PORT_MASK_MAX_PORTS) ? (UINT64_C(1) << port) : 0;
+}
+
+// Set of ports [0, num_ports)
+static inline port_mask_t port_mask_all(const uint16_t num_ports) {
+    return (num_ports >= PORT_MASK_MAX_PORTS) ?
+           UINT64_MAX : ((UINT64_C(1) << num_ports) - 1);
+}
+
+static inline bool port_mask_has(const port_mask_t mask, const uint16_t port) {
+    return ((mask & port_mask_bit(port)) != 0);
+}
+
+static inline int port_mask_count(const port_mask_t mask) {
+    return __builtin_popcountll(mask);
+}
+
+/**
+ * Removes and returns the lowest port in a (non-empty) set. Iterate
+ * over a set with: while (mask != 0) { port = port_mask_pop(&mask); }
+ */
+static inline uint16_t port_mask_pop(port_mask_t *mask) {
+    const uint16_t port = (uint16_t) __builtin_ctzll(*mask);
+    *mask &= (*mask - 1);
+    return port;
+}
+
+// Open-addressing hash table size (a power of 2, at least twice the
+// maximum number of ports, so probe sequences stay short).
+#define PORT_INDEX_SLOTS 128
+
+/**
+ * Neighbor address -> port index, built once from the node's config.
+ */
+struct port_index {
+    mixnet_address addrs[PORT_INDEX_SLOTS];
+    uint8_t ports[PORT_INDEX_SLOTS];    // Port + 1 (0 marks an empty slot)
+};
+
+static inline uint32_t port_index_slot(const mixnet_address addr) {
+    const uint32_t hash = ((uint32_t) addr * UINT32_C(2654435769));
+    return (hash ^ (hash >> 16)) & (PORT_INDEX_SLOTS - 1);
+}
+
+/**
+ * Builds the index for the given port -> neighbor address mapping. If
+ * an address appears more than once, the lowest port wins.
+ */
+void port_index_init(struct port_index *index, const uint16_t num_ports,
+                     const mixnet_address *neighbor_addrs);
+
+/**
+ * Returns the port to the given neighbor, or -1 if it isn't one.
+ */
+static inline int port_index_find(const struct port_index *index,
+                                  const mixnet_address addr) {
+    uint32_t slot = port_index_slot(addr);
+    while (index->ports[slot] != 0) {
+        if (index->addrs[slot] == addr) { return (index->ports[slot] - 1); }
+        slot = (slot + 1) & (PORT_INDEX_SLOTS - 1);
+    }
+    return -1;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MIXNET_PORTS_H
@@ -0,0 +1,54 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the Mixnet course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the Mixnet project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#ifndef MIXNET_RANDOM_H
+#define MIXNET_RANDOM_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Returns the next 64-bit value from a xorshift64* generator. The
+ * state must be seeded with a non-zero value.
+ */
+static inline uint64_t random_next(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= (x >> 12);
+    x ^= (x << 25);
+    x ^= (x >> 27);
+    *state = x;
+    return (x * 0x2545F4914F6CDD1DULL);
+}
+
+/**
+ * Returns a uniformly random integer in [0, bound), using Lemire's
+ * multiply-shift reduction (with rejection to remove the bias).
+ */
+static inline uint32_t random_below(uint64_t *state, const uint32_t bound) {
+    uint64_t product = (random_next(state) >> 32) * bound;
+    uint32_t low = (uint32_t) product;
+    if (low < bound) {
+        const uint32_t threshold = (-bound) % bound;
+        while (low < threshold) {
+            product = (random_next(state) >> 32) * bound;
+            low = (uint32_t) product;
+        }
+    }
+    return (uint32_t) (product >> 32);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MIXNET_RANDOM_H
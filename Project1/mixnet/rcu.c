@@ -0,0 +1,62 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the Mixnet course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the Mixnet project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#include "rcu.h"
+
+#include <stdlib.h>
+
+void rcu_init(struct rcu_pointer *rcu, void *object,
+              void (*free_object)(void *)) {
+    rcu->current = object;
+    rcu->reader_epoch = 0;
+    rcu->free_object = free_object;
+    rcu->retired = NULL;
+}
+
+void rcu_destroy(struct rcu_pointer *rcu) {
+    while (rcu->retired != NULL) {
+        struct rcu_retired *retired = rcu->retired;
+        rcu->retired = retired->next;
+        rcu->free_object(retired->object);
+        free(retired);
+    }
+    if (rcu->current != NULL) { rcu->free_object(rcu->current); }
+    rcu->current = NULL;
+}
+
+bool rcu_publish(struct rcu_pointer *rcu, void *object) {
+    struct rcu_retired *retired = malloc(sizeof(struct rcu_retired));
+    if (retired == NULL) { return false; }
+
+    // A reader that loaded the old object did so after announcing the
+    // epoch read here (or earlier), so it is done with it once the
+    // reader's epoch moves past this one.
+    retired->object = __atomic_exchange_n(&(rcu->current), object,
+                                          __ATOMIC_SEQ_CST);
+    retired->epoch = __atomic_load_n(&(rcu->reader_epoch), __ATOMIC_SEQ_CST);
+    retired->next = rcu->retired;
+    rcu->retired = retired;
+    return true;
+}
+
+bool rcu_reclaim(struct rcu_pointer *rcu) {
+    const uint64_t epoch = __atomic_load_n(&(rcu->reader_epoch),
+                                           __ATOMIC_SEQ_CST);
+    struct rcu_retired **link = &(rcu->retired);
+    while (*link != NULL) {
+        struct rcu_retired *retired = *link;
+        if (retired->epoch >= epoch) { link = &(retired->next); continue; }
+
+        *link = retired->next;
+        rcu->free_object(retired->object);
+        free(retired);
+    }
+    return (rcu->retired != NULL);
+}
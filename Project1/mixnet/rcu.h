@@ -0,0 +1,82 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the Mixnet course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the Mixnet project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#ifndef MIXNET_RCU_H
+#define MIXNET_RCU_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A published object that has been replaced, but may still be in use.
+ */
+struct rcu_retired {
+    struct rcu_retired *next;
+    void *object;
+    uint64_t epoch;                 // Reader epoch when it was replaced
+};
+
+/**
+ * RCU-style pointer with one writer and one reader (quiescent-state
+ * based). The writer swaps in new immutable objects; the reader loads
+ * the current one without locks, and periodically announces that it
+ * holds no references (e.g., before blocking). Replaced objects are
+ * freed once the reader has announced a quiescent state since, so
+ * neither side ever waits on the other.
+ */
+struct rcu_pointer {
+    void *current;                  // Published object
+    uint64_t reader_epoch;          // Quiescent states announced so far
+    void (*free_object)(void *);    // Destructor for replaced objects
+    struct rcu_retired *retired;    // Replaced objects (writer only)
+};
+
+void rcu_init(struct rcu_pointer *rcu, void *object,
+              void (*free_object)(void *));
+
+// Frees every object (once neither side uses the pointer anymore)
+void rcu_destroy(struct rcu_pointer *rcu);
+
+/**
+ * Reader side: returns the current object. It stays valid until the
+ * reader's next call to rcu_quiescent().
+ */
+static inline void *rcu_dereference(const struct rcu_pointer *rcu) {
+    return __atomic_load_n(&(rcu->current), __ATOMIC_SEQ_CST);
+}
+
+static inline void rcu_quiescent(struct rcu_pointer *rcu) {
+    __atomic_store_n(&(rcu->reader_epoch), rcu->reader_epoch + 1,
+                     __ATOMIC_SEQ_CST);
+}
+
+/**
+ * Writer side: publishes a new object, retiring the previous one.
+ *
+ * @return True if successful, else false (the object is not published)
+ */
+bool rcu_publish(struct rcu_pointer *rcu, void *object);
+
+/**
+ * Writer side: frees retired objects the reader can no longer hold.
+ *
+ * @return True if any retired objects remain, else false
+ */
+bool rcu_reclaim(struct rcu_pointer *rcu);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MIXNET_RCU_H
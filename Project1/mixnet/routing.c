@@ -0,0 +1,1653 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the Mixnet course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the Mixnet project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#include "routing.h"
+
+#include "dedup.h"
+#include "random.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Constant parameters
+static const uint32_t ROUTING_INITIAL_CAPACITY = 16;
+static const uint32_t SPF_NO_PARENT = UINT32_MAX;
+static const uint16_t SPF_INFINITY = UINT16_MAX;
+
+/**
+ * What installing an LSA did to the LSDB: nothing (a stale LSA, or
+ * out of memory), refreshed an entry, or changed (or added) one.
+ */
+enum lsdb_change {
+    LSDB_UNCHANGED = 0,
+    LSDB_REFRESHED,
+    LSDB_CHANGED,
+    LSDB_INSERTED,
+};
+
+/**
+ * A shortest-path tree over the LSDB (keyed by LSDB index), rooted at
+ * one node and (optionally) avoiding another: the SPT, or the tree a
+ * neighbor's random routing candidates are taken from.
+ */
+struct spt {
+    uint32_t root;                  // LSDB idx (SPF_NO_PARENT if none)
+    uint32_t excluded;              // LSDB idx (SPF_NO_PARENT if none)
+    uint32_t *parent;               // LSDB idx -> Parent's LSDB idx
+    uint16_t *dist;                 // LSDB idx -> Hop count to node
+};
+
+static void spf_update_incremental(struct routing_state *rs,
+                                   const uint32_t x,
+                                   const mixnet_address *old_neighbors,
+                                   const uint16_t old_count);
+static void rr_update_trees(struct routing_state *rs, const uint32_t x,
+                            const mixnet_address *old_neighbors,
+                            const uint16_t old_count);
+static void route_page_release(struct route_page *page);
+
+bool lsdb_init(struct lsdb *db, const bool is_indexed) {
+    db->num_entries = 0;
+    db->num_adjacencies = 0;
+    db->capacity = ROUTING_INITIAL_CAPACITY;
+    db->adjacency_size = 0;
+    db->adjacency_capacity = ROUTING_INITIAL_CAPACITY * 4;
+    db->slots = NULL;
+
+    db->entries = malloc(sizeof(struct lsdb_entry) * db->capacity);
+    db->adjacency = malloc(sizeof(mixnet_address) * db->adjacency_capacity);
+    if (is_indexed) { db->slots = malloc(sizeof(uint32_t) * FIB_NUM_ENTRIES); }
+
+    if ((db->entries == NULL) || (db->adjacency == NULL) ||
+        (is_indexed && (db->slots == NULL))) {
+        lsdb_destroy(db); return false;
+    }
+    if (is_indexed) {
+        memset(db->slots, 0xFF, sizeof(uint32_t) * FIB_NUM_ENTRIES);
+    }
+    return true;
+}
+
+void lsdb_destroy(struct lsdb *db) {
+    free(db->entries);
+    free(db->slots);
+    free(db->adjacency);
+
+    db->entries = NULL;
+    db->slots = NULL;
+    db->adjacency = NULL;
+    db->adjacency_size = 0;
+    db->adjacency_capacity = 0;
+    db->num_entries = 0;
+    db->num_adjacencies = 0;
+    db->capacity = 0;
+}
+
+// Resizes an array, leaving it (and clearing is_ok) on failure
+static void *spf_resize_array(void *array, const size_t size, bool *is_ok) {
+    void *resized = realloc(array, size);
+    if (resized == NULL) { *is_ok = false; return array; }
+    return resized;
+}
+
+/**
+ * Resizes the arrays keyed by LSDB index (those of the SPT, and of
+ * each random routing tree) ahead of the LSDB, so they always have a
+ * slot for every entry. The random routing trees are laid out by
+ * capacity, so they must be recomputed.
+ */
+static bool spf_resize(struct routing_state *rs, const uint32_t capacity) {
+    const size_t tree_slots = ((size_t) rs->num_neighbors * capacity) + 1;
+    bool is_ok = true;
+    rs->spf_parent = spf_resize_array(
+        rs->spf_parent, sizeof(uint32_t) * capacity, &is_ok);
+    rs->spf_dist = spf_resize_array(
+        rs->spf_dist, sizeof(uint16_t) * capacity, &is_ok);
+    rs->spf_order = spf_resize_array(
+        rs->spf_order, sizeof(uint32_t) * capacity, &is_ok);
+    rs->spf_marks = spf_resize_array(
+        rs->spf_marks, sizeof(uint32_t) * capacity, &is_ok);
+    rs->spt_touched = spf_resize_array(
+        rs->spt_touched, sizeof(uint32_t) * capacity, &is_ok);
+    rs->spt_changed = spf_resize_array(
+        rs->spt_changed, sizeof(uint32_t) * capacity, &is_ok);
+    rs->spt_old_dist = spf_resize_array(
+        rs->spt_old_dist, sizeof(uint16_t) * capacity, &is_ok);
+    rs->spt_old_parent = spf_resize_array(
+        rs->spt_old_parent, sizeof(uint32_t) * capacity, &is_ok);
+    rs->rr_parent = spf_resize_array(
+        rs->rr_parent, sizeof(uint32_t) * tree_slots, &is_ok);
+    rs->rr_dist = spf_resize_array(
+        rs->rr_dist, sizeof(uint16_t) * tree_slots, &is_ok);
+    rs->rr_dirty = spf_resize_array(
+        rs->rr_dirty, sizeof(bool) * capacity, &is_ok);
+    rs->rr_dirty_list = spf_resize_array(
+        rs->rr_dirty_list, sizeof(uint32_t) * capacity, &is_ok);
+    if (!is_ok) { return false; }
+
+    memset(rs->spf_marks, 0, sizeof(uint32_t) * capacity);
+    memset(rs->rr_dirty, 0, sizeof(bool) * capacity);
+    rs->spf_epoch = 1;
+    rs->spf_capacity = capacity;
+    rs->rr_num_dirty = 0;
+    rs->rr_trees_stale = true;
+    return true;
+}
+
+bool routing_init(struct routing_state *rs,
+                  const mixnet_address node_addr,
+                  const uint16_t num_neighbors,
+                  const mixnet_address *neighbor_addrs,
+                  const struct port_index *neighbor_index) {
+    rs->node_addr = node_addr;
+    rs->num_neighbors = num_neighbors;
+    rs->neighbor_addrs = neighbor_addrs;
+    rs->neighbor_index = neighbor_index;
+    rs->spf_capacity = 0;
+    rs->spf_epoch = 1;
+    rs->spf_num_reached = 0;
+    rs->spf_stale = true;
+    rs->fib_stale = false;
+    rs->spf_parent = NULL;
+    rs->spf_dist = NULL;
+    rs->spf_order = NULL;
+    rs->spf_marks = NULL;
+    rs->spt_touched = NULL;
+    rs->spt_changed = NULL;
+    rs->spt_old_dist = NULL;
+    rs->spt_old_parent = NULL;
+    rs->spt_heap = NULL;
+    rs->spt_heap_capacity = 0;
+    rs->rr_stale = true;
+    rs->rr_parent = NULL;
+    rs->rr_dist = NULL;
+    rs->rr_hops = 0;
+    rs->rr_trees_stale = true;
+    rs->rr_all_dirty = false;
+    rs->rr_dirty = NULL;
+    rs->rr_dirty_list = NULL;
+    rs->rr_num_dirty = 0;
+    memset(rs->pages, 0, sizeof(rs->pages));
+    memset(&(rs->stats), 0, sizeof(struct routing_stats));
+
+    // Candidate sets hold at most one route per neighbor
+    const uint32_t max_candidates = num_neighbors + 1;
+    rs->rr_order = malloc(sizeof(uint16_t) * max_candidates);
+    rs->rr_scaled = malloc(sizeof(double) * max_candidates);
+    rs->rr_small = malloc(sizeof(uint16_t) * max_candidates);
+    rs->rr_large = malloc(sizeof(uint16_t) * max_candidates);
+
+    const bool is_lsdb_ok = lsdb_init(&(rs->lsdb), true);
+    if (!is_lsdb_ok || !spf_resize(rs, ROUTING_INITIAL_CAPACITY) ||
+        (rs->rr_order == NULL) || (rs->rr_scaled == NULL) ||
+        (rs->rr_small == NULL) || (rs->rr_large == NULL)) {
+        routing_destroy(rs); return false;
+    }
+    // This node is always in its own LSDB (initially isolated)
+    return routing_update(rs, node_addr, 0, 0, NULL, 0);
+}
+
+void routing_destroy(struct routing_state *rs) {
+    lsdb_destroy(&(rs->lsdb));
+    free(rs->spf_parent);
+    free(rs->spf_dist);
+    free(rs->spf_order);
+    free(rs->spf_marks);
+    free(rs->spt_touched);
+    free(rs->spt_changed);
+    free(rs->spt_old_dist);
+    free(rs->spt_old_parent);
+    free(rs->spt_heap);
+    free(rs->rr_parent);
+    free(rs->rr_dist);
+    free(rs->rr_dirty);
+    free(rs->rr_dirty_list);
+    free(rs->rr_order);
+    free(rs->rr_scaled);
+    free(rs->rr_small);
+    free(rs->rr_large);
+    for (uint32_t i = 0; i < ROUTE_NUM_PAGES; i++) {
+        route_page_release(rs->pages[i]);
+        rs->pages[i] = NULL;
+    }
+    rs->spf_parent = NULL;
+    rs->spf_dist = NULL;
+    rs->spf_order = NULL;
+    rs->spf_marks = NULL;
+    rs->spt_touched = NULL;
+    rs->spt_changed = NULL;
+    rs->spt_old_dist = NULL;
+    rs->spt_old_parent = NULL;
+    rs->spt_heap = NULL;
+    rs->rr_parent = NULL;
+    rs->rr_dist = NULL;
+    rs->rr_dirty = NULL;
+    rs->rr_dirty_list = NULL;
+    rs->rr_order = NULL;
+    rs->rr_scaled = NULL;
+    rs->rr_small = NULL;
+    rs->rr_large = NULL;
+    rs->spf_capacity = 0;
+    rs->spt_heap_capacity = 0;
+}
+
+/**
+ * Returns the index of the first LSDB entry whose address is not
+ * less than node_address (i.e., the insertion point).
+ */
+static uint32_t lsdb_lower_bound(const struct lsdb *db,
+                                 const mixnet_address node_address) {
+    uint32_t lo = 0, hi = db->num_entries;
+    while (lo < hi) {
+        uint32_t mid = lo + ((hi - lo) / 2);
+        if (db->entries[mid].node_address < node_address) { lo = mid + 1; }
+        else { hi = mid; }
+    }
+    return lo;
+}
+
+/**
+ * Returns the LSDB index of a node (or SPF_NO_PARENT), through the
+ * address index if the LSDB has one, else by binary search.
+ */
+static uint32_t lsdb_lookup(const struct lsdb *db,
+                            const mixnet_address node_address) {
+    if (db->slots != NULL) { return db->slots[node_address]; }
+
+    const uint32_t idx = lsdb_lower_bound(db, node_address);
+    return ((idx < db->num_entries) &&
+            (db->entries[idx].node_address == node_address)) ?
+            idx : SPF_NO_PARENT;
+}
+
+// SPF always runs over an indexed LSDB
+static inline uint32_t lsdb_index(const struct routing_state *rs,
+                                  const mixnet_address node_address) {
+    return rs->lsdb.slots[node_address];
+}
+
+const struct lsdb_entry *lsdb_find(const struct lsdb *db,
+                                   const mixnet_address node_address) {
+    uint32_t idx = lsdb_lookup(db, node_address);
+    return (idx == SPF_NO_PARENT) ? NULL : &(db->entries[idx]);
+}
+
+static bool lsdb_grow(struct lsdb *db) {
+    const uint32_t capacity = db->capacity * 2;
+    struct lsdb_entry *entries = realloc(
+        db->entries, sizeof(struct lsdb_entry) * capacity);
+    if (entries == NULL) { return false; }
+    db->entries = entries;
+    db->capacity = capacity;
+    return true;
+}
+
+static bool adjacency_reserve(struct lsdb *db, const uint32_t size) {
+    if (size <= db->adjacency_capacity) { return true; }
+
+    uint32_t capacity = db->adjacency_capacity;
+    while (capacity < size) { capacity *= 2; }
+
+    mixnet_address *adjacency = realloc(
+        db->adjacency, sizeof(mixnet_address) * capacity);
+    if (adjacency == NULL) { return false; }
+    db->adjacency = adjacency;
+    db->adjacency_capacity = capacity;
+    return true;
+}
+
+/**
+ * Compacts the adjacency arena once most of it holds adjacencies left
+ * behind by updates. Adjacencies are laid out in LSDB order, so SPF
+ * (which visits nodes roughly by address) mostly walks it forwards.
+ */
+static void adjacency_collect(struct lsdb *db) {
+    if ((db->adjacency_size - db->num_adjacencies) <= (db->adjacency_size / 2)) {
+        return;
+    }
+    mixnet_address *adjacency = malloc(
+        sizeof(mixnet_address) * db->adjacency_capacity);
+    if (adjacency == NULL) { return; }
+
+    uint32_t offset = 0;
+    for (uint32_t idx = 0; idx < db->num_entries; idx++) {
+        struct lsdb_entry *entry = &(db->entries[idx]);
+        memcpy(&(adjacency[offset]), lsdb_neighbors(db, entry),
+               sizeof(mixnet_address) * entry->neighbor_count);
+        entry->first_neighbor = offset;
+        offset += entry->neighbor_count;
+    }
+    free(db->adjacency);
+    db->adjacency = adjacency;
+    db->adjacency_size = offset;
+}
+
+/**
+ * Replaces the adjacency of LSDB idx (which must have room reserved
+ * at the end of the arena). The old adjacency is left in place until
+ * adjacency_collect(), since SPF needs it to find the deleted links.
+ */
+static void lsdb_set_adjacency(struct lsdb *db, const uint32_t idx,
+                               const uint16_t neighbor_count,
+                               const mixnet_address *neighbors) {
+    struct lsdb_entry *entry = &(db->entries[idx]);
+    if (neighbor_count > 0) {
+        memcpy(&(db->adjacency[db->adjacency_size]), neighbors,
+               sizeof(mixnet_address) * neighbor_count);
+    }
+    db->num_adjacencies -= entry->neighbor_count;
+    db->num_adjacencies += neighbor_count;
+    entry->first_neighbor = db->adjacency_size;
+    entry->neighbor_count = neighbor_count;
+    db->adjacency_size += neighbor_count;
+}
+
+/**
+ * Finds (or adds) the advertising node's entry, and takes in the LSA's
+ * sequence number and age if it is newer. The adjacency itself is left
+ * to the caller, who must reserve arena room for it beforehand.
+ */
+static enum lsdb_change lsdb_install(struct lsdb *db, uint32_t *idx,
+                                     const mixnet_address node_address,
+                                     const uint16_t sequence,
+                                     const uint16_t neighbor_count,
+                                     const mixnet_address *neighbors,
+                                     const uint32_t now_ms) {
+    *idx = lsdb_lookup(db, node_address);
+
+    // Existing entry, replace the adjacency if it changed. Only newer
+    // LSAs count: an old (or re-synced) one is stale news, and must not
+    // refresh the entry's age, or undo its expiry.
+    if (*idx != SPF_NO_PARENT) {
+        struct lsdb_entry *entry = &(db->entries[*idx]);
+        if (!dedup_seq_is_newer(sequence, entry->sequence)) {
+            return LSDB_UNCHANGED;
+        }
+        entry->sequence = sequence;
+        entry->updated_ms = now_ms;
+
+        if ((entry->neighbor_count == neighbor_count) &&
+            ((neighbor_count == 0) ||
+             (memcmp(lsdb_neighbors(db, entry), neighbors,
+                     sizeof(mixnet_address) * neighbor_count) == 0))) {
+            return LSDB_REFRESHED;
+        }
+        return LSDB_CHANGED;
+    }
+    // New entry, make room for it (keeping the LSDB sorted)
+    if ((db->num_entries == db->capacity) && !lsdb_grow(db)) {
+        return LSDB_UNCHANGED;
+    }
+    *idx = lsdb_lower_bound(db, node_address);
+    memmove(&(db->entries[*idx + 1]), &(db->entries[*idx]),
+            sizeof(struct lsdb_entry) * (db->num_entries - *idx));
+
+    db->num_entries++;
+    if (db->slots != NULL) {
+        for (uint32_t i = *idx + 1; i < db->num_entries; i++) {
+            db->slots[db->entries[i].node_address] = i;
+        }
+        db->slots[node_address] = *idx;
+    }
+    struct lsdb_entry *entry = &(db->entries[*idx]);
+    entry->node_address = node_address;
+    entry->sequence = sequence;
+    entry->neighbor_count = 0;
+    entry->first_neighbor = 0;
+    entry->updated_ms = now_ms;
+    return LSDB_INSERTED;
+}
+
+bool lsdb_update(struct lsdb *db,
+                 const mixnet_address node_address,
+                 const uint16_t sequence,
+                 const uint16_t neighbor_count,
+                 const mixnet_address *neighbors,
+                 const uint32_t now_ms) {
+    if (!adjacency_reserve(db, db->adjacency_size + neighbor_count)) {
+        return false;
+    }
+    uint32_t idx;
+    const enum lsdb_change change = lsdb_install(
+        db, &idx, node_address, sequence, neighbor_count, neighbors, now_ms);
+
+    if (change >= LSDB_CHANGED) {
+        lsdb_set_adjacency(db, idx, neighbor_count, neighbors);
+        adjacency_collect(db);
+    }
+    return (change != LSDB_UNCHANGED);
+}
+
+/**
+ * Replaces the adjacency of LSDB idx (see lsdb_set_adjacency), then
+ * updates the SPT and the random routing trees.
+ */
+static void routing_set_adjacency(struct routing_state *rs, const uint32_t idx,
+                                  const uint16_t neighbor_count,
+                                  const mixnet_address *neighbors,
+                                  const bool is_new_entry) {
+    const uint32_t old_first = rs->lsdb.entries[idx].first_neighbor;
+    const uint16_t old_count = rs->lsdb.entries[idx].neighbor_count;
+    lsdb_set_adjacency(&(rs->lsdb), idx, neighbor_count, neighbors);
+    rs->rr_stale = true;
+
+    // New entries shift the LSDB indices that the trees are keyed by,
+    // so those (rare, mostly during startup) require a full SPF.
+    const mixnet_address *old_neighbors = &(rs->lsdb.adjacency[old_first]);
+    if (is_new_entry) { rs->spf_stale = rs->rr_trees_stale = true; }
+    if (!rs->spf_stale) {
+        spf_update_incremental(rs, idx, old_neighbors, old_count);
+    }
+    if (!rs->rr_trees_stale) {
+        rr_update_trees(rs, idx, old_neighbors, old_count);
+    }
+    adjacency_collect(&(rs->lsdb));
+}
+
+bool routing_update(struct routing_state *rs,
+                    const mixnet_address node_address,
+                    const uint16_t sequence,
+                    const uint16_t neighbor_count,
+                    const mixnet_address *neighbors,
+                    const uint32_t now_ms) {
+    struct lsdb *db = &(rs->lsdb);
+    if (!adjacency_reserve(db, db->adjacency_size + neighbor_count) ||
+        ((db->num_entries == rs->spf_capacity) &&
+         !spf_resize(rs, rs->spf_capacity * 2))) {
+        return false;
+    }
+    uint32_t idx;
+    const enum lsdb_change change = lsdb_install(
+        db, &idx, node_address, sequence, neighbor_count, neighbors, now_ms);
+
+    if (change >= LSDB_CHANGED) {
+        routing_set_adjacency(rs, idx, neighbor_count, neighbors,
+                              (change == LSDB_INSERTED));
+    }
+    return (change != LSDB_UNCHANGED);
+}
+
+uint32_t routing_expire(struct routing_state *rs, const uint32_t now_ms,
+                        const uint32_t max_age_ms) {
+    uint32_t num_expired = 0;
+    for (uint32_t idx = 0; idx < rs->lsdb.num_entries; idx++) {
+        const struct lsdb_entry *entry = &(rs->lsdb.entries[idx]);
+        if ((entry->node_address == rs->node_addr) ||
+            (entry->neighbor_count == 0) ||
+            ((uint32_t) (now_ms - entry->updated_ms) <= max_age_ms)) {
+            continue;
+        }
+        // Keep the sequence number: a re-sync of the same LSA is still
+        // stale, so only the node's next refresh re-installs it.
+        routing_set_adjacency(rs, idx, 0, NULL, false);
+        num_expired++;
+    }
+    return num_expired;
+}
+
+static bool lsdb_has_neighbor(const struct routing_state *rs,
+                              const struct lsdb_entry *entry,
+                              const mixnet_address neighbor) {
+    const mixnet_address *neighbors = lsdb_neighbors(&(rs->lsdb), entry);
+    for (uint16_t i = 0; i < entry->neighbor_count; i++) {
+        if (neighbors[i] == neighbor) { return true; }
+    }
+    return false;
+}
+
+/**
+ * Binary min-heap of (distance, LSDB idx) keys. Since the LSDB is
+ * sorted by address, ties on distance pop the lowest address first.
+ */
+static void heap_push(uint64_t *heap, uint32_t *size, const uint64_t key) {
+    uint32_t pos = (*size)++;
+    while (pos > 0) {
+        uint32_t parent = (pos - 1) / 2;
+        if (heap[parent] <= key) { break; }
+        heap[pos] = heap[parent];
+        pos = parent;
+    }
+    heap[pos] = key;
+}
+
+static uint64_t heap_pop(uint64_t *heap, uint32_t *size) {
+    const uint64_t top = heap[0];
+    const uint64_t last = heap[--(*size)];
+    uint32_t pos = 0;
+    while (true) {
+        uint32_t child = (2 * pos) + 1;
+        if (child >= *size) { break; }
+        if (((child + 1) < *size) &&
+            (heap[child + 1] < heap[child])) { child++; }
+
+        if (last <= heap[child]) { break; }
+        heap[pos] = heap[child];
+        pos = child;
+    }
+    heap[pos] = last;
+    return top;
+}
+
+static bool spf_is_link(const struct routing_state *rs,
+                        const uint32_t u, const uint32_t v) {
+    const struct lsdb_entry *entries = rs->lsdb.entries;
+    return (lsdb_has_neighbor(rs, &(entries[u]), entries[v].node_address) &&
+            lsdb_has_neighbor(rs, &(entries[v]), entries[u].node_address));
+}
+
+static size_t fib_template_size_for(const uint16_t dist) {
+    return (sizeof(mixnet_packet_routing_header) +
+            (sizeof(mixnet_address) * ((dist > 0) ? (dist - 1) : 0)));
+}
+
+// Returns the page holding a destination's routes (or NULL)
+static inline struct route_page *route_page_of(const struct routing_state *rs,
+                                               const mixnet_address address) {
+    return rs->pages[address >> ROUTE_PAGE_SHIFT];
+}
+
+static bool route_page_reserve(struct route_page *page,
+                               const size_t template_bytes,
+                               const uint32_t num_candidates) {
+    if ((page->templates_size + template_bytes) > page->templates_capacity) {
+        size_t capacity = (page->templates_capacity > 0) ?
+                           page->templates_capacity : template_bytes;
+        while (capacity < (page->templates_size + template_bytes)) {
+            capacity *= 2;
+        }
+        char *templates = realloc(page->templates, capacity);
+        if (templates == NULL) { return false; }
+        page->templates = templates;
+        page->templates_capacity = capacity;
+    }
+    if ((page->num_candidates + num_candidates) > page->candidates_capacity) {
+        uint32_t capacity = (page->candidates_capacity > 0) ?
+                             page->candidates_capacity : num_candidates;
+        while (capacity < (page->num_candidates + num_candidates)) {
+            capacity *= 2;
+        }
+        struct rr_candidate *candidates = realloc(
+            page->candidates, sizeof(struct rr_candidate) * capacity);
+        if (candidates == NULL) { return false; }
+        page->candidates = candidates;
+        page->candidates_capacity = capacity;
+    }
+    return true;
+}
+
+// Appends a template to a page's arena (which must have room for it)
+static uint32_t route_page_append(struct route_page *page,
+                                  const void *template, const size_t size) {
+    const size_t offset = page->templates_size;
+    memcpy(page->templates + offset, template, size);
+    page->templates_size += size;
+    return (uint32_t) offset;
+}
+
+/**
+ * Returns an unshared copy of a page, with its arenas compacted (i.e.,
+ * without the templates and candidates left behind by updates).
+ *
+ * @return The copy, or NULL if out of memory
+ */
+static struct route_page *route_page_copy(const struct route_page *src) {
+    size_t templates_size = 0;
+    uint32_t num_candidates = 0;
+    for (uint32_t i = 0; i < ROUTE_PAGE_SIZE; i++) {
+        if (src->fib[i].is_valid) {
+            templates_size += fib_template_size(&(src->fib[i]));
+        }
+        const struct rr_set *set = &(src->rr_sets[i]);
+        for (uint16_t j = 0; j < set->num_candidates; j++) {
+            templates_size += fib_template_size(
+                &(src->candidates[set->first_candidate + j].route));
+        }
+        num_candidates += set->num_candidates;
+    }
+    struct route_page *page = calloc(1, sizeof(struct route_page));
+    if (page == NULL) { return NULL; }
+
+    page->refcount = 1;
+    if (!route_page_reserve(page, templates_size, num_candidates)) {
+        route_page_release(page); return NULL;
+    }
+    memcpy(page->fib, src->fib, sizeof(page->fib));
+    memcpy(page->rr_sets, src->rr_sets, sizeof(page->rr_sets));
+
+    // Templates are self-contained, so only their offsets change
+    for (uint32_t i = 0; i < ROUTE_PAGE_SIZE; i++) {
+        struct fib_entry *entry = &(page->fib[i]);
+        if (entry->is_valid) {
+            entry->template_offset = route_page_append(
+                page, route_page_template(src, entry), fib_template_size(entry));
+        }
+        struct rr_set *set = &(page->rr_sets[i]);
+        const struct rr_candidate *candidates = (
+            &(src->candidates[set->first_candidate]));
+
+        set->first_candidate = page->num_candidates;
+        for (uint16_t j = 0; j < set->num_candidates; j++) {
+            struct rr_candidate *candidate = (
+                &(page->candidates[page->num_candidates++]));
+            *candidate = candidates[j];
+            candidate->route.template_offset = route_page_append(
+                page, route_page_template(src, &(candidates[j].route)),
+                fib_template_size(&(candidates[j].route)));
+        }
+    }
+    return page;
+}
+
+// Drops a reference to a page, freeing it if it was the last one
+static void route_page_release(struct route_page *page) {
+    if ((page == NULL) || (--(page->refcount) > 0)) { return; }
+    free(page->candidates);
+    free(page->templates);
+    free(page);
+}
+
+/**
+ * Returns a destination's page, ready to be written: a new (empty)
+ * page if there is none yet, or a private copy if the current one is
+ * shared with a snapshot.
+ *
+ * @return The page, or NULL if out of memory
+ */
+static struct route_page *route_page_writable(struct routing_state *rs,
+                                              const mixnet_address address) {
+    struct route_page **slot = &(rs->pages[address >> ROUTE_PAGE_SHIFT]);
+    if (*slot == NULL) {
+        *slot = calloc(1, sizeof(struct route_page));
+        if (*slot != NULL) { (*slot)->refcount = 1; }
+    }
+    else if ((*slot)->refcount > 1) {
+        struct route_page *page = route_page_copy(*slot);
+        if (page == NULL) { return NULL; }
+        route_page_release(*slot);
+        *slot = page;
+    }
+    return *slot;
+}
+
+/**
+ * Compacts the (unshared) pages in which most of an arena is held by
+ * replaced routes. Shared pages are compacted when they are copied.
+ */
+static void route_pages_collect(struct routing_state *rs) {
+    for (uint32_t i = 0; i < ROUTE_NUM_PAGES; i++) {
+        struct route_page *page = rs->pages[i];
+        if ((page == NULL) || (page->refcount > 1) ||
+            ((page->templates_garbage <= (page->templates_size / 2)) &&
+             (page->candidates_garbage <= (page->num_candidates / 2)))) {
+            continue;
+        }
+        struct route_page *copy = route_page_copy(page);
+        if (copy == NULL) { continue; }
+        route_page_release(page);
+        rs->pages[i] = copy;
+    }
+}
+
+// Returns a destination's FIB entry (NULL if its page has none yet)
+static const struct fib_entry *fib_entry_of(const struct routing_state *rs,
+                                            const mixnet_address address) {
+    const struct route_page *page = route_page_of(rs, address);
+    return (page == NULL) ? NULL : &(page->fib[route_page_slot(address)]);
+}
+
+/**
+ * Writes the FIB entry (and route template) for LSDB idx v, replacing
+ * the current one. The parent's entry must be up-to-date.
+ *
+ * @return True if successful, else false (out of memory)
+ */
+static bool fib_write_entry(struct routing_state *rs, const uint32_t v) {
+    const uint32_t p = rs->spf_parent[v];
+    const mixnet_address address = rs->lsdb.entries[v].node_address;
+    const size_t size = fib_template_size_for(rs->spf_dist[v]);
+
+    struct route_page *page = route_page_writable(rs, address);
+    if ((page == NULL) || !route_page_reserve(page, size, 0)) { return false; }
+
+    struct fib_entry *entry = &(page->fib[route_page_slot(address)]);
+    mixnet_packet_routing_header *rh = (mixnet_packet_routing_header *) (
+        page->templates + page->templates_size);
+
+    if (entry->is_valid) {
+        page->templates_garbage += fib_template_size(entry);
+    }
+    rh->hop_index = 0;
+    rh->route_length = 0;
+    entry->is_valid = true;
+    entry->route_length = 0;
+    entry->template_offset = (uint32_t) page->templates_size;
+
+    // This node: deliver locally
+    if (p == SPF_NO_PARENT) {
+        entry->port = (uint8_t) rs->num_neighbors;
+    }
+    // Direct neighbor: empty route
+    else if (rs->spf_parent[p] == SPF_NO_PARENT) {
+        int port = port_index_find(rs->neighbor_index, address);
+        entry->is_valid = (port >= 0);
+        entry->port = (uint8_t) port;
+    }
+    // Otherwise: parent's route, followed by the parent itself (the
+    // parent's page is looked up last, since it may be this one)
+    else {
+        const mixnet_address parent_address = rs->lsdb.entries[p].node_address;
+        const struct route_page *parent_page = route_page_of(rs, parent_address);
+        const struct fib_entry *parent = (
+            &(parent_page->fib[route_page_slot(parent_address)]));
+
+        entry->port = parent->port;
+        entry->is_valid = parent->is_valid;
+        entry->route_length = parent->route_length + 1;
+        rh->route_length = entry->route_length;
+
+        mixnet_address *route = (mixnet_address *) rh->route;
+        memcpy(route, route_page_template(parent_page, parent)->route,
+               sizeof(mixnet_address) * parent->route_length);
+        route[parent->route_length] = parent_address;
+    }
+    page->templates_size += fib_template_size(entry);
+    return true;
+}
+
+/**
+ * Withdraws the (valid) FIB entry for LSDB idx v.
+ *
+ * @return True if successful, else false (out of memory)
+ */
+static bool fib_retract_entry(struct routing_state *rs, const uint32_t v) {
+    const mixnet_address address = rs->lsdb.entries[v].node_address;
+    struct route_page *page = route_page_writable(rs, address);
+    if (page == NULL) { return false; }
+
+    struct fib_entry *entry = &(page->fib[route_page_slot(address)]);
+    page->templates_garbage += fib_template_size(entry);
+    entry->is_valid = false;
+    return true;
+}
+
+/**
+ * Returns whether the installed FIB entry for LSDB idx v already
+ * reflects its (possibly new) distance and parent. Changes further
+ * up the tree are caught by rewriting the subtrees of changed nodes.
+ */
+static bool fib_entry_is_current(const struct routing_state *rs,
+                                 const uint32_t v) {
+    const mixnet_address address = rs->lsdb.entries[v].node_address;
+    const struct fib_entry *entry = fib_entry_of(rs, address);
+    const bool is_valid = ((entry != NULL) && entry->is_valid);
+    const uint16_t dist = rs->spf_dist[v];
+    const uint32_t p = rs->spf_parent[v];
+
+    if (dist == SPF_INFINITY) { return !is_valid; }
+    if (!is_valid || (dist == 0)) { return is_valid; }
+    if (entry->route_length != (dist - 1)) { return false; }
+    if (entry->route_length == 0) { return true; } // Direct neighbor
+
+    const mixnet_address *route = (const mixnet_address *) (
+        route_page_template(route_page_of(rs, address), entry)->route);
+    return (route[entry->route_length - 1] == rs->lsdb.entries[p].node_address);
+}
+
+/**
+ * Reserves num_epochs consecutive mark values (see spf_marks), first
+ * clearing the marks if the epoch would wrap around.
+ *
+ * @return The first of the epochs
+ */
+static uint32_t spf_take_epochs(struct routing_state *rs,
+                                const uint32_t num_epochs) {
+    if (rs->spf_epoch > (UINT32_MAX - num_epochs)) {
+        memset(rs->spf_marks, 0, sizeof(uint32_t) * rs->spf_capacity);
+        rs->spf_epoch = 1;
+    }
+    const uint32_t epoch = rs->spf_epoch;
+    rs->spf_epoch += num_epochs;
+    return epoch;
+}
+
+/**
+ * Brings the FIB in line with a freshly computed shortest-path tree.
+ * Nodes are visited in settling order, so each parent's route is final
+ * before those of its children, which extend it by a single hop (the
+ * parent). Only the routes that changed are rewritten (unless the FIB
+ * is stale), so pages without any stay shared with the last snapshot.
+ */
+static void fib_rebuild(struct routing_state *rs) {
+    const uint32_t changed = spf_take_epochs(rs, 1);
+    uint32_t num_changed = 0;
+
+    // Retract the routes to nodes no longer reached. LSDB entries are
+    // never removed, so this covers every destination ever installed.
+    for (uint32_t idx = 0; idx < rs->lsdb.num_entries; idx++) {
+        if ((rs->spf_dist[idx] != SPF_INFINITY) ||
+            fib_entry_is_current(rs, idx)) { continue; }
+
+        if (!fib_retract_entry(rs, idx)) { rs->spf_stale = true; return; }
+        num_changed++;
+    }
+    for (uint32_t i = 0; i < rs->spf_num_reached; i++) {
+        const uint32_t v = rs->spf_order[i];
+        const uint32_t p = rs->spf_parent[v];
+        if (!rs->fib_stale && fib_entry_is_current(rs, v) &&
+            ((p == SPF_NO_PARENT) || (rs->spf_marks[p] != changed))) {
+            continue;
+        }
+        if (!fib_write_entry(rs, v)) {
+            rs->spf_stale = rs->fib_stale = true; return;
+        }
+        rs->spf_marks[v] = changed;
+        num_changed++;
+    }
+    route_pages_collect(rs);
+    rs->fib_stale = false;
+
+    rs->stats.last_fib_changes = num_changed;
+    rs->stats.total_fib_changes += num_changed;
+}
+
+// Returns a node's LSDB index in a tree (SPF_NO_PARENT if the node is
+// unknown, or is the one the tree avoids)
+static inline uint32_t spt_index(const struct routing_state *rs,
+                                 const struct spt *tree,
+                                 const mixnet_address address) {
+    const uint32_t idx = lsdb_index(rs, address);
+    return (idx == tree->excluded) ? SPF_NO_PARENT : idx;
+}
+
+// Grows the (persistent) heap to hold at least size keys
+static bool spt_heap_reserve(struct routing_state *rs, const uint32_t size) {
+    if (size <= rs->spt_heap_capacity) { return true; }
+    uint32_t capacity = (rs->spt_heap_capacity > 0) ?
+                         rs->spt_heap_capacity : ROUTING_INITIAL_CAPACITY;
+    while (capacity < size) { capacity *= 2; }
+
+    uint64_t *heap = realloc(rs->spt_heap, sizeof(uint64_t) * capacity);
+    if (heap == NULL) { return false; }
+    rs->spt_heap = heap;
+    rs->spt_heap_capacity = capacity;
+    return true;
+}
+
+// Returns the tree that routes (and the FIB) are computed from
+static inline struct spt spf_tree(const struct routing_state *rs) {
+    const struct spt tree = {lsdb_index(rs, rs->node_addr), SPF_NO_PARENT,
+                             rs->spf_parent, rs->spf_dist};
+    return tree;
+}
+
+/**
+ * Computes a tree from scratch, with Dijkstra from its root. Links are
+ * only used if both endpoints advertise one another. Among equal-cost
+ * paths, lower addresses win.
+ *
+ * @param order If not NULL, set to the reached nodes in settling order
+ * @param num_reached Set to the number of nodes reached
+ * @return True if successful, else false (out of memory)
+ */
+static bool spt_compute(struct routing_state *rs, const struct spt *tree,
+                        uint32_t *order, uint32_t *num_reached) {
+    const uint32_t n = rs->lsdb.num_entries;
+    for (uint32_t idx = 0; idx < n; idx++) {
+        tree->parent[idx] = SPF_NO_PARENT;
+        tree->dist[idx] = SPF_INFINITY;
+    }
+    *num_reached = 0;
+    if (tree->root == SPF_NO_PARENT) { return true; }
+
+    // Lazy-deletion heap: at most one push per directed edge
+    if (!spt_heap_reserve(rs, rs->lsdb.num_adjacencies + 1)) { return false; }
+    uint64_t *heap = rs->spt_heap;
+
+    uint32_t heap_size = 0;
+    tree->dist[tree->root] = 0;
+    heap_push(heap, &heap_size, tree->root);
+
+    while (heap_size > 0) {
+        const uint64_t key = heap_pop(heap, &heap_size);
+        const uint32_t u = (uint32_t) (key & UINT32_MAX);
+        const uint16_t dist = (uint16_t) (key >> 32);
+        if (dist != tree->dist[u]) { continue; } // Stale key
+        if (order != NULL) { order[*num_reached] = u; }
+        (*num_reached)++;
+
+        const struct lsdb_entry *entry = &(rs->lsdb.entries[u]);
+        const mixnet_address *neighbors = lsdb_neighbors(&(rs->lsdb), entry);
+        for (uint16_t i = 0; i < entry->neighbor_count; i++) {
+            const uint32_t v = spt_index(rs, tree, neighbors[i]);
+            if (v == SPF_NO_PARENT) { continue; }
+
+            // Two-way connectivity check
+            if (!lsdb_has_neighbor(rs, &(rs->lsdb.entries[v]),
+                                   entry->node_address)) { continue; }
+
+            // Nodes pop in (distance, address) order, so the first
+            // parent to reach v at its final distance is also the
+            // lowest-addressed one; later ties must not replace it.
+            if ((uint16_t) (dist + 1) < tree->dist[v]) {
+                tree->dist[v] = dist + 1;
+                tree->parent[v] = u;
+                heap_push(heap, &heap_size,
+                          (((uint64_t) (dist + 1)) << 32) | v);
+            }
+        }
+    }
+    return true;
+}
+
+void routing_compute_spf(struct routing_state *rs) {
+    rs->spf_stale = false;
+    rs->stats.num_full_spf++;
+
+    const struct spt tree = spf_tree(rs);
+    if (!spt_compute(rs, &tree, rs->spf_order, &(rs->spf_num_reached))) {
+        rs->spf_stale = true; return;
+    }
+    fib_rebuild(rs);
+}
+
+/**
+ * Returns the canonical parent of LSDB idx v in a tree, i.e., the one
+ * that full Dijkstra picks: the lowest-addressed neighbor one hop
+ * closer to the root.
+ */
+static uint32_t spt_canonical_parent(const struct routing_state *rs,
+                                     const struct spt *tree,
+                                     const uint32_t v) {
+    const uint16_t dist = tree->dist[v];
+    if ((dist == 0) || (dist == SPF_INFINITY)) { return SPF_NO_PARENT; }
+
+    uint32_t parent = SPF_NO_PARENT;
+    const struct lsdb_entry *entry = &(rs->lsdb.entries[v]);
+    const mixnet_address *neighbors = lsdb_neighbors(&(rs->lsdb), entry);
+    for (uint16_t i = 0; i < entry->neighbor_count; i++) {
+        const uint32_t w = spt_index(rs, tree, neighbors[i]);
+        if ((w == SPF_NO_PARENT) || (w >= parent) ||
+            (tree->dist[w] != (dist - 1)) ||
+            !lsdb_has_neighbor(rs, &(rs->lsdb.entries[w]), entry->node_address)) {
+            continue;
+        }
+        parent = w;
+    }
+    return parent;
+}
+
+// Marks LSDB idx u as touched, saving its place in the tree first
+static inline void spt_touch(struct routing_state *rs, const struct spt *tree,
+                             const uint32_t touched, const uint32_t u,
+                             uint32_t *num_touched) {
+    rs->spf_marks[u] = touched;
+    rs->spt_old_dist[u] = tree->dist[u];
+    rs->spt_old_parent[u] = tree->parent[u];
+    rs->spt_touched[(*num_touched)++] = u;
+}
+
+/**
+ * Incrementally updates a tree after LSDB idx x (which the tree must
+ * not avoid) changed its adjacency. Deleting a tree link invalidates
+ * the subtree below it, which is re-attached from its boundary; adding
+ * a link seeds distance decreases. Only nodes whose distance changed,
+ * and their neighbors, have their parents recomputed.
+ *
+ * @param num_changed Set to the number of nodes whose distance (or
+ *                    parent) changed, which are listed in spt_changed
+ * @return True if successful, else false (out of memory)
+ */
+static bool spt_update(struct routing_state *rs, const struct spt *tree,
+                       const uint32_t x, const mixnet_address *old_neighbors,
+                       const uint16_t old_count, uint32_t *num_changed) {
+    const uint32_t n = rs->lsdb.num_entries;
+    const struct lsdb_entry *x_entry = &(rs->lsdb.entries[x]);
+    const mixnet_address *x_neighbors = lsdb_neighbors(&(rs->lsdb), x_entry);
+    uint32_t *parent = tree->parent;
+    uint16_t *dist = tree->dist;
+
+    // Each node is listed at most once; the heap sees at most one
+    // push per node (seeds), plus two per link of x (new links) and
+    // one per directed link (relaxes).
+    if (!spt_heap_reserve(rs, n + (2 * rs->lsdb.num_adjacencies) + 1)) {
+        return false;
+    }
+    uint64_t *heap = rs->spt_heap;
+    uint32_t *touched_list = rs->spt_touched;
+    uint32_t heap_size = 0, num_touched = 0;
+    *num_changed = 0;
+
+    // Marks: touched (distance may have changed, and its old place in
+    // the tree is saved), and considered (as a candidate for a new
+    // parent).
+    const uint32_t touched = spf_take_epochs(rs, 2);
+    const uint32_t considered = touched + 1;
+
+    // Deleted links: invalidate the subtree below each tree link
+    for (uint16_t i = 0; i < old_count; i++) {
+        const uint32_t y = spt_index(rs, tree, old_neighbors[i]);
+        if ((y == SPF_NO_PARENT) ||
+            lsdb_has_neighbor(rs, x_entry, old_neighbors[i])) { continue; }
+
+        uint32_t child = SPF_NO_PARENT;
+        if (parent[y] == x) { child = y; }
+        else if (parent[x] == y) { child = x; }
+        if ((child == SPF_NO_PARENT) ||
+            (rs->spf_marks[child] == touched)) { continue; }
+
+        // Walk the subtree (children are neighbors whose parent is
+        // the current node), using the touched list as the queue.
+        uint32_t head = num_touched;
+        spt_touch(rs, tree, touched, child, &num_touched);
+        while (head < num_touched) {
+            const uint32_t u = touched_list[head++];
+            const struct lsdb_entry *entry = &(rs->lsdb.entries[u]);
+            const mixnet_address *neighbors = lsdb_neighbors(&(rs->lsdb), entry);
+            for (uint16_t j = 0; j < entry->neighbor_count; j++) {
+                const uint32_t w = spt_index(rs, tree, neighbors[j]);
+                if ((w == SPF_NO_PARENT) || (parent[w] != u) ||
+                    (rs->spf_marks[w] == touched)) { continue; }
+
+                spt_touch(rs, tree, touched, w, &num_touched);
+            }
+        }
+    }
+    for (uint32_t i = 0; i < num_touched; i++) {
+        const uint32_t u = touched_list[i];
+        dist[u] = SPF_INFINITY;
+        parent[u] = SPF_NO_PARENT;
+    }
+    // Re-attach invalidated nodes from the rest of the tree
+    const uint32_t num_invalidated = num_touched;
+    for (uint32_t i = 0; i < num_invalidated; i++) {
+        const uint32_t u = touched_list[i];
+        const struct lsdb_entry *entry = &(rs->lsdb.entries[u]);
+        const mixnet_address *neighbors = lsdb_neighbors(&(rs->lsdb), entry);
+        for (uint16_t j = 0; j < entry->neighbor_count; j++) {
+            const uint32_t w = spt_index(rs, tree, neighbors[j]);
+            if ((w == SPF_NO_PARENT) ||
+                (dist[w] >= (SPF_INFINITY - 1)) ||
+                ((uint16_t) (dist[w] + 1) >= dist[u]) ||
+                !spf_is_link(rs, u, w)) { continue; }
+
+            dist[u] = dist[w] + 1;
+        }
+        if (dist[u] != SPF_INFINITY) {
+            heap_push(heap, &heap_size, (((uint64_t) dist[u]) << 32) | u);
+        }
+    }
+    // Added links: seed distance decreases at either endpoint
+    for (uint16_t i = 0; i < x_entry->neighbor_count; i++) {
+        const uint32_t y = spt_index(rs, tree, x_neighbors[i]);
+        if (y == SPF_NO_PARENT || !spf_is_link(rs, x, y)) { continue; }
+
+        bool is_new_link = true;
+        for (uint16_t j = 0; j < old_count; j++) {
+            if (old_neighbors[j] == x_neighbors[i]) {
+                is_new_link = false; break;
+            }
+        }
+        if (!is_new_link) { continue; }
+
+        const uint32_t ends[2][2] = {{x, y}, {y, x}};
+        for (int e = 0; e < 2; e++) {
+            const uint32_t from = ends[e][0], to = ends[e][1];
+            if ((dist[from] >= (SPF_INFINITY - 1)) ||
+                ((uint16_t) (dist[from] + 1) >= dist[to])) { continue; }
+
+            if (rs->spf_marks[to] != touched) {
+                spt_touch(rs, tree, touched, to, &num_touched);
+            }
+            dist[to] = dist[from] + 1;
+            heap_push(heap, &heap_size, (((uint64_t) dist[to]) << 32) | to);
+        }
+    }
+    // Propagate decreases (Dijkstra, restricted to improving nodes)
+    while (heap_size > 0) {
+        const uint64_t key = heap_pop(heap, &heap_size);
+        const uint32_t u = (uint32_t) (key & UINT32_MAX);
+        const uint16_t d = (uint16_t) (key >> 32);
+        if (d != dist[u]) { continue; } // Stale key
+
+        const struct lsdb_entry *entry = &(rs->lsdb.entries[u]);
+        const mixnet_address *neighbors = lsdb_neighbors(&(rs->lsdb), entry);
+        for (uint16_t i = 0; i < entry->neighbor_count; i++) {
+            const uint32_t v = spt_index(rs, tree, neighbors[i]);
+            if ((v == SPF_NO_PARENT) ||
+                ((uint16_t) (d + 1) >= dist[v]) ||
+                !lsdb_has_neighbor(rs, &(rs->lsdb.entries[v]),
+                                   entry->node_address)) { continue; }
+
+            if (rs->spf_marks[v] != touched) {
+                spt_touch(rs, tree, touched, v, &num_touched);
+            }
+            dist[v] = d + 1;
+            heap_push(heap, &heap_size, (((uint64_t) (d + 1)) << 32) | v);
+        }
+    }
+    // Recompute parents around touched nodes (and x's links), listing
+    // the nodes whose place in the tree changed.
+    for (uint32_t i = 0; i <= num_touched; i++) {
+        const uint32_t u = (i < num_touched) ? touched_list[i] : x;
+        const struct lsdb_entry *entry = &(rs->lsdb.entries[u]);
+        const mixnet_address *neighbors = lsdb_neighbors(&(rs->lsdb), entry);
+
+        for (int32_t j = -1; j < (int32_t) entry->neighbor_count; j++) {
+            const uint32_t v = (j < 0) ? u : spt_index(rs, tree, neighbors[j]);
+            if ((v == SPF_NO_PARENT) ||
+                (rs->spf_marks[v] == considered)) { continue; }
+
+            const bool was_touched = (rs->spf_marks[v] == touched);
+            const uint16_t old_dist = (
+                was_touched ? rs->spt_old_dist[v] : dist[v]);
+            const uint32_t old_parent = (
+                was_touched ? rs->spt_old_parent[v] : parent[v]);
+            rs->spf_marks[v] = considered;
+            if (dist[v] == 0) { continue; } // The root
+
+            parent[v] = spt_canonical_parent(rs, tree, v);
+            if ((dist[v] != old_dist) || (parent[v] != old_parent)) {
+                rs->spt_changed[(*num_changed)++] = v;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Incrementally updates the SPT (and FIB) after LSDB idx x changed
+ * its adjacency (see spt_update). The subtrees of nodes whose route
+ * changed are then rewritten, parents first.
+ */
+static void spf_update_incremental(struct routing_state *rs,
+                                   const uint32_t x,
+                                   const mixnet_address *old_neighbors,
+                                   const uint16_t old_count) {
+    const struct spt tree = spf_tree(rs);
+    uint32_t num_moved = 0;
+    if (!spt_update(rs, &tree, x, old_neighbors, old_count, &num_moved)) {
+        rs->spf_stale = true; return;
+    }
+    // Queue nodes whose route changed to have their subtree rewritten
+    // (the heap has room for every node)
+    const uint32_t queued = spf_take_epochs(rs, 1);
+    uint64_t *heap = rs->spt_heap;
+    uint32_t heap_size = 0, num_changed = 0;
+    for (uint32_t i = 0; i < num_moved; i++) {
+        const uint32_t v = rs->spt_changed[i];
+        if (fib_entry_is_current(rs, v)) { continue; }
+
+        rs->spf_marks[v] = queued;
+        if (rs->spf_dist[v] == SPF_INFINITY) {
+            if (!fib_retract_entry(rs, v)) {
+                rs->spf_stale = rs->fib_stale = true; return;
+            }
+            num_changed++;
+        }
+        else {
+            heap_push(heap, &heap_size,
+                      (((uint64_t) rs->spf_dist[v]) << 32) | v);
+        }
+    }
+    // Rewrite changed routes, parents before children
+    while (heap_size > 0) {
+        const uint32_t u = (uint32_t) (
+            heap_pop(heap, &heap_size) & UINT32_MAX);
+
+        if (!fib_write_entry(rs, u)) {
+            rs->spf_stale = rs->fib_stale = true; return;
+        }
+        num_changed++;
+
+        const struct lsdb_entry *lsdb_entry = &(rs->lsdb.entries[u]);
+        const mixnet_address *neighbors = lsdb_neighbors(&(rs->lsdb), lsdb_entry);
+        for (uint16_t i = 0; i < lsdb_entry->neighbor_count; i++) {
+            const uint32_t w = lsdb_index(rs, neighbors[i]);
+            if ((w == SPF_NO_PARENT) || (rs->spf_parent[w] != u) ||
+                (rs->spf_marks[w] == queued)) { continue; }
+
+            rs->spf_marks[w] = queued;
+            heap_push(heap, &heap_size,
+                      (((uint64_t) rs->spf_dist[w]) << 32) | w);
+        }
+    }
+    route_pages_collect(rs);
+    rs->stats.num_incremental_spf++;
+    rs->stats.last_fib_changes = num_changed;
+    rs->stats.total_fib_changes += num_changed;
+}
+
+// Returns the tree (rooted at neighbor nid, avoiding this node) that
+// the candidates via that neighbor are taken from
+static inline struct spt rr_tree(const struct routing_state *rs,
+                                 const uint16_t nid) {
+    const size_t offset = (size_t) nid * rs->spf_capacity;
+    const struct spt tree = {lsdb_index(rs, rs->neighbor_addrs[nid]),
+                             lsdb_index(rs, rs->node_addr),
+                             &(rs->rr_parent[offset]),
+                             &(rs->rr_dist[offset])};
+    return tree;
+}
+
+// Returns the neighbors with a (two-way) link to this node
+static port_mask_t rr_live_hops(const struct routing_state *rs) {
+    const uint32_t root = lsdb_index(rs, rs->node_addr);
+    port_mask_t hops = 0;
+    for (uint16_t nid = 0; (root != SPF_NO_PARENT) &&
+                           (nid < rs->num_neighbors); nid++) {
+        const uint32_t h = lsdb_index(rs, rs->neighbor_addrs[nid]);
+        if ((h != SPF_NO_PARENT) && spf_is_link(rs, root, h)) {
+            hops |= port_mask_bit(nid);
+        }
+    }
+    return hops;
+}
+
+/**
+ * Marks the destinations whose route via a tree's root changed (i.e.,
+ * the subtrees below the nodes listed in spt_changed) as dirty.
+ */
+static void rr_mark_dirty(struct routing_state *rs, const struct spt *tree,
+                          const uint32_t num_changed) {
+    const uint32_t visited = spf_take_epochs(rs, 1);
+    uint32_t *queue = rs->spt_touched;
+    uint32_t head = 0, tail = 0;
+    for (uint32_t i = 0; i < num_changed; i++) {
+        const uint32_t v = rs->spt_changed[i];
+        if (rs->spf_marks[v] == visited) { continue; }
+        rs->spf_marks[v] = visited;
+        queue[tail++] = v;
+    }
+    while (head < tail) {
+        const uint32_t u = queue[head++];
+        if (!rs->rr_dirty[u]) {
+            rs->rr_dirty[u] = true;
+            rs->rr_dirty_list[rs->rr_num_dirty++] = u;
+        }
+        const struct lsdb_entry *entry = &(rs->lsdb.entries[u]);
+        const mixnet_address *neighbors = lsdb_neighbors(&(rs->lsdb), entry);
+        for (uint16_t i = 0; i < entry->neighbor_count; i++) {
+            const uint32_t w = spt_index(rs, tree, neighbors[i]);
+            if ((w == SPF_NO_PARENT) || (tree->parent[w] != u) ||
+                (rs->spf_marks[w] == visited)) { continue; }
+
+            rs->spf_marks[w] = visited;
+            queue[tail++] = w;
+        }
+    }
+}
+
+/**
+ * Incrementally updates the per-neighbor trees after LSDB idx x
+ * changed its adjacency (see spt_update), marking the destinations
+ * whose candidate sets changed.
+ */
+static void rr_update_trees(struct routing_state *rs, const uint32_t x,
+                            const mixnet_address *old_neighbors,
+                            const uint16_t old_count) {
+    // This node is in none of the trees: its own links only change
+    // which of them are first hops.
+    for (uint16_t nid = 0; (x != lsdb_index(rs, rs->node_addr)) &&
+                           (nid < rs->num_neighbors); nid++) {
+        const struct spt tree = rr_tree(rs, nid);
+        if (tree.root == SPF_NO_PARENT) { continue; }
+
+        uint32_t num_changed = 0;
+        if (!spt_update(rs, &tree, x, old_neighbors, old_count,
+                        &num_changed)) {
+            rs->rr_trees_stale = true; return;
+        }
+        if (!rs->rr_all_dirty) { rr_mark_dirty(rs, &tree, num_changed); }
+    }
+    const port_mask_t hops = rr_live_hops(rs);
+    if (hops != rs->rr_hops) {
+        rs->rr_hops = hops;
+        rs->rr_all_dirty = true;
+    }
+}
+
+/**
+ * Builds the alias table (Vose's method) for one candidate set, with
+ * weights inversely proportional to the number of hops (plus one).
+ */
+static void rr_build_alias_table(struct rr_candidate *candidates,
+                                 const uint16_t m, double *scaled,
+                                 uint16_t *small, uint16_t *large) {
+    double total = 0;
+    for (uint16_t i = 0; i < m; i++) {
+        scaled[i] = 1.0 / (candidates[i].route.route_length + 2);
+        total += scaled[i];
+    }
+    uint16_t num_small = 0, num_large = 0;
+    for (uint16_t i = 0; i < m; i++) {
+        scaled[i] *= (m / total);
+        if (scaled[i] < 1.0) { small[num_small++] = i; }
+        else { large[num_large++] = i; }
+    }
+    while ((num_small > 0) && (num_large > 0)) {
+        const uint16_t s = small[--num_small];
+        const uint16_t l = large[num_large - 1];
+
+        candidates[s].alias_threshold = (uint32_t) (scaled[s] * UINT32_MAX);
+        candidates[s].alias = l;
+
+        scaled[l] -= (1.0 - scaled[s]);
+        if (scaled[l] < 1.0) { num_large--; small[num_small++] = l; }
+    }
+    // Leftovers are (up to rounding) exactly 1
+    while (num_large > 0) {
+        const uint16_t l = large[--num_large];
+        candidates[l].alias_threshold = UINT32_MAX;
+        candidates[l].alias = l;
+    }
+    while (num_small > 0) {
+        const uint16_t s = small[--num_small];
+        candidates[s].alias_threshold = UINT32_MAX;
+        candidates[s].alias = s;
+    }
+}
+
+// Returns the length of the route to LSDB idx v via neighbor nid
+static inline uint16_t rr_route_length(const struct routing_state *rs,
+                                       const uint16_t nid, const uint32_t v) {
+    return rs->rr_dist[((size_t) nid * rs->spf_capacity) + v];
+}
+
+/**
+ * Lists the neighbors (first hops) that destination v's candidates
+ * take in rr_order, the shortest (equal-cost) ones first.
+ *
+ * @return The number of candidates
+ */
+static uint16_t rr_order_candidates(struct routing_state *rs,
+                                    const uint32_t v, uint16_t *num_shortest) {
+    uint16_t min_length = SPF_INFINITY;
+    for (port_mask_t hops = rs->rr_hops; hops != 0;) {
+        const uint16_t route_length = rr_route_length(
+            rs, port_mask_pop(&hops), v);
+        if (route_length < min_length) { min_length = route_length; }
+    }
+    uint16_t num_candidates = 0;
+    for (port_mask_t hops = rs->rr_hops; hops != 0;) {
+        const uint16_t nid = port_mask_pop(&hops);
+        if ((min_length != SPF_INFINITY) &&
+            (rr_route_length(rs, nid, v) == min_length)) {
+            rs->rr_order[num_candidates++] = nid;
+        }
+    }
+    *num_shortest = num_candidates;
+    for (port_mask_t hops = rs->rr_hops; hops != 0;) {
+        const uint16_t nid = port_mask_pop(&hops);
+        const uint16_t route_length = rr_route_length(rs, nid, v);
+        if ((route_length != min_length) && (route_length != SPF_INFINITY)) {
+            rs->rr_order[num_candidates++] = nid;
+        }
+    }
+    return num_candidates;
+}
+
+/**
+ * Returns whether destination v's installed candidate set already
+ * holds the routes (in order) that the per-neighbor trees give it.
+ */
+static bool rr_set_is_current(const struct routing_state *rs,
+                              const uint32_t v, const uint16_t num_candidates,
+                              const uint16_t num_shortest) {
+    const mixnet_address address = rs->lsdb.entries[v].node_address;
+    const struct route_page *page = route_page_of(rs, address);
+    if (page == NULL) { return (num_candidates == 0); }
+
+    const struct rr_set *set = &(page->rr_sets[route_page_slot(address)]);
+    if ((set->num_candidates != num_candidates) ||
+        (set->num_shortest != num_shortest)) { return false; }
+
+    for (uint16_t i = 0; i < num_candidates; i++) {
+        const struct spt tree = rr_tree(rs, rs->rr_order[i]);
+        const struct fib_entry *candidate = (
+            &(page->candidates[set->first_candidate + i].route));
+
+        if ((candidate->port != rs->rr_order[i]) ||
+            (candidate->route_length != tree.dist[v])) { return false; }
+
+        const mixnet_address *route = (const mixnet_address *) (
+            route_page_template(page, candidate)->route);
+        uint32_t u = v;
+        for (uint16_t j = candidate->route_length; j > 0; j--) {
+            u = tree.parent[u];
+            if (route[j - 1] != rs->lsdb.entries[u].node_address) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Appends the candidate (and route template) to destination v via
+ * neighbor nid, using that neighbor's tree, to a page (which must have
+ * room for both).
+ */
+static void rr_write_candidate(const struct routing_state *rs,
+                               struct route_page *page,
+                               const uint16_t nid, const uint32_t v) {
+    const struct spt tree = rr_tree(rs, nid);
+    const uint16_t route_length = tree.dist[v];
+
+    struct fib_entry *candidate = (
+        &(page->candidates[page->num_candidates++].route));
+    candidate->template_offset = (uint32_t) page->templates_size;
+    candidate->route_length = route_length;
+    candidate->port = (uint8_t) nid;
+    candidate->is_valid = true;
+
+    mixnet_packet_routing_header *rh = (mixnet_packet_routing_header *) (
+        page->templates + page->templates_size);
+    rh->route_length = route_length;
+    rh->hop_index = 0;
+
+    // Walk back from the destination to the first hop
+    mixnet_address *route = (mixnet_address *) rh->route;
+    uint32_t u = v;
+    for (uint16_t i = route_length; i > 0; i--) {
+        u = tree.parent[u];
+        route[i - 1] = rs->lsdb.entries[u].node_address;
+    }
+    page->templates_size += fib_template_size(candidate);
+}
+
+/**
+ * Replaces destination v's candidate set with the candidates listed in
+ * rr_order. The old set is left behind as garbage.
+ *
+ * @return True if successful, else false (out of memory)
+ */
+static bool rr_write_set(struct routing_state *rs, const uint32_t v,
+                         const uint16_t num_candidates,
+                         const uint16_t num_shortest) {
+    size_t templates_size = 0;
+    for (uint16_t i = 0; i < num_candidates; i++) {
+        templates_size += fib_template_size_for(
+            rr_route_length(rs, rs->rr_order[i], v) + 1);
+    }
+    const mixnet_address address = rs->lsdb.entries[v].node_address;
+    struct route_page *page = route_page_writable(rs, address);
+    if ((page == NULL) ||
+        !route_page_reserve(page, templates_size, num_candidates)) {
+        return false;
+    }
+    struct rr_set *set = &(page->rr_sets[route_page_slot(address)]);
+    for (uint16_t i = 0; i < set->num_candidates; i++) {
+        page->templates_garbage += fib_template_size(
+            &(page->candidates[set->first_candidate + i].route));
+    }
+    page->candidates_garbage += set->num_candidates;
+
+    set->first_candidate = page->num_candidates;
+    set->num_candidates = num_candidates;
+    set->num_shortest = num_shortest;
+    for (uint16_t i = 0; i < num_candidates; i++) {
+        rr_write_candidate(rs, page, rs->rr_order[i], v);
+    }
+    if (num_candidates > 0) {
+        rr_build_alias_table(&(page->candidates[set->first_candidate]),
+                             num_candidates, rs->rr_scaled,
+                             rs->rr_small, rs->rr_large);
+    }
+    return true;
+}
+
+/**
+ * Brings the candidate sets up-to-date. Each candidate is a loop-free
+ * path via a distinct first hop, taken from that neighbor's tree. The
+ * trees are recomputed only when stale; otherwise, only the dirty
+ * destinations' sets are rebuilt (or all, if the first hops changed).
+ */
+static bool rr_rebuild(struct routing_state *rs) {
+    const uint32_t n = rs->lsdb.num_entries;
+    const uint32_t root = lsdb_index(rs, rs->node_addr);
+    if (root == SPF_NO_PARENT) { return false; }
+
+    if (rs->rr_trees_stale) {
+        for (uint16_t nid = 0; nid < rs->num_neighbors; nid++) {
+            const struct spt tree = rr_tree(rs, nid);
+            uint32_t num_reached = 0;
+            if ((tree.root != SPF_NO_PARENT) &&
+                !spt_compute(rs, &tree, NULL, &num_reached)) { return false; }
+        }
+        rs->rr_trees_stale = false;
+        rs->rr_hops = rr_live_hops(rs);
+        rs->rr_all_dirty = true;
+    }
+    // Rewrite the sets that changed (each grouped by destination, with
+    // the shortest candidates, i.e., the equal-cost multipaths, first),
+    // so that pages without any stay shared with the last snapshot.
+    const uint32_t num_dirty = rs->rr_all_dirty ? n : rs->rr_num_dirty;
+    for (uint32_t i = 0; i < num_dirty; i++) {
+        const uint32_t v = rs->rr_all_dirty ? i : rs->rr_dirty_list[i];
+        if (v == root) { continue; }
+
+        uint16_t num_shortest = 0;
+        const uint16_t num_candidates = rr_order_candidates(
+            rs, v, &num_shortest);
+
+        if (!rr_set_is_current(rs, v, num_candidates, num_shortest) &&
+            !rr_write_set(rs, v, num_candidates, num_shortest)) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < rs->rr_num_dirty; i++) {
+        rs->rr_dirty[rs->rr_dirty_list[i]] = false;
+    }
+    rs->rr_num_dirty = 0;
+    rs->rr_all_dirty = false;
+    rs->rr_stale = false;
+
+    route_pages_collect(rs);
+    return true;
+}
+
+// Returns a destination's candidate set in a snapshot (or NULL)
+static inline const struct rr_set *
+rr_set_of(const struct fib_snapshot *snapshot,
+          const mixnet_address dst_address,
+          const struct route_page **page) {
+    *page = snapshot->pages[dst_address >> ROUTE_PAGE_SHIFT];
+    return (*page == NULL) ? NULL :
+        &((*page)->rr_sets[route_page_slot(dst_address)]);
+}
+
+const struct fib_entry *
+rr_sample(const struct fib_snapshot *snapshot, uint64_t *rng_state,
+          const mixnet_address dst_address,
+          const mixnet_packet_routing_header **route_template) {
+    const struct route_page *page = NULL;
+    const struct rr_set *set = rr_set_of(snapshot, dst_address, &page);
+    if ((set == NULL) || (set->num_candidates == 0)) { return NULL; }
+
+    // One draw: the high half picks a column, the low half flips
+    // the column's biased coin (keep it, or take its alias).
+    const uint64_t r = random_next(rng_state);
+    const struct rr_candidate *column = &(page->candidates[
+        set->first_candidate + (uint32_t) (
+            ((r >> 32) * set->num_candidates) >> 32)]);
+
+    const struct fib_entry *candidate = (
+        (((uint32_t) r) < column->alias_threshold) ? &(column->route) :
+        &(page->candidates[set->first_candidate + column->alias].route));
+    *route_template = route_page_template(page, candidate);
+    return candidate;
+}
+
+const struct fib_entry *
+ecmp_select(const struct fib_snapshot *snapshot,
+            const mixnet_address dst_address, const uint64_t hash,
+            const mixnet_packet_routing_header **route_template) {
+    const struct route_page *page = NULL;
+    const struct rr_set *set = rr_set_of(snapshot, dst_address, &page);
+    if ((set == NULL) || (set->num_shortest == 0)) { return NULL; }
+
+    // Map the hash's high half onto [0, num_shortest) (no division)
+    const uint32_t idx = set->first_candidate + (uint32_t) (
+        ((hash >> 32) * set->num_shortest) >> 32);
+
+    const struct fib_entry *candidate = &(page->candidates[idx].route);
+    *route_template = route_page_template(page, candidate);
+    return candidate;
+}
+
+bool lfa_prepare(struct routing_state *rs) {
+    return (!rs->rr_stale || rr_rebuild(rs));
+}
+
+const struct fib_entry *
+lfa_select(const struct fib_snapshot *snapshot,
+           const mixnet_address dst_address, const port_mask_t live_ports,
+           const mixnet_packet_routing_header **route_template) {
+    const struct route_page *page = NULL;
+    const struct rr_set *set = rr_set_of(snapshot, dst_address, &page);
+    if (set == NULL) { return NULL; }
+
+    // Candidates are sorted shortest-first only up to num_shortest
+    const struct fib_entry *best = NULL;
+    for (uint16_t i = 0; i < set->num_candidates; i++) {
+        const struct fib_entry *candidate = (
+            &(page->candidates[set->first_candidate + i].route));
+
+        if (port_mask_has(live_ports, candidate->port) &&
+            ((best == NULL) || (candidate->route_length < best->route_length))) {
+            best = candidate;
+        }
+    }
+    if (best != NULL) { *route_template = route_page_template(page, best); }
+    return best;
+}
+
+struct fib_snapshot *fib_snapshot_create(struct routing_state *rs) {
+    if (rs->spf_stale) { routing_compute_spf(rs); }
+    if (rs->spf_stale || !lfa_prepare(rs)) { return NULL; }
+
+    struct fib_snapshot *snapshot = malloc(sizeof(struct fib_snapshot));
+    if (snapshot == NULL) { return NULL; }
+
+    // Shares every page: the next write to one copies it first
+    for (uint32_t i = 0; i < ROUTE_NUM_PAGES; i++) {
+        snapshot->pages[i] = rs->pages[i];
+        if (rs->pages[i] != NULL) { rs->pages[i]->refcount++; }
+    }
+    return snapshot;
+}
+
+void fib_snapshot_free(struct fib_snapshot *snapshot) {
+    if (snapshot == NULL) { return; }
+    for (uint32_t i = 0; i < ROUTE_NUM_PAGES; i++) {
+        route_page_release(snapshot->pages[i]);
+    }
+    free(snapshot);
+}
@@ -0,0 +1,436 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the Mixnet course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the Mixnet project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#ifndef MIXNET_ROUTING_H
+#define MIXNET_ROUTING_H
+
+#include "address.h"
+#include "packet.h"
+#include "ports.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// One FIB slot per possible mixnet address
+#define FIB_NUM_ENTRIES     (1 << 16)
+
+// Routes are kept in pages of consecutive destinations (see route_page)
+#define ROUTE_PAGE_SHIFT    8
+#define ROUTE_PAGE_SIZE     (1 << ROUTE_PAGE_SHIFT)
+#define ROUTE_NUM_PAGES     (FIB_NUM_ENTRIES >> ROUTE_PAGE_SHIFT)
+
+/**
+ * Link-state database entry. Holds the most recent adjacency
+ * advertised (via LSA) by a single node in the network. Adjacencies
+ * live in a shared arena (CSR-style), see lsdb_neighbors().
+ */
+struct lsdb_entry {
+    mixnet_address node_address;    // Advertising node's mixnet address
+    uint16_t sequence;              // Sequence number of the latest LSA
+    uint16_t neighbor_count;        // Number of advertised neighbors
+    uint32_t first_neighbor;        // Offset of the adjacency in the arena
+    uint32_t updated_ms;            // Time (ms, wrapping) of the latest LSA
+};
+
+/**
+ * FIB entry, directly indexed by destination address. The entry's
+ * route template is a ready-to-copy routing header (with a zero
+ * hop_index) immediately followed by the intermediate hops.
+ */
+struct fib_entry {
+    uint32_t template_offset;       // Offset of the template in its page
+    uint16_t route_length;          // Intermediate hops in the route
+    uint8_t port;                   // Output port (the user port if local)
+    bool is_valid;                  // Whether the destination is reachable
+};
+
+/**
+ * Random (and multipath) routing: the candidate routes to a single
+ * destination, as a range in its page's candidate array, with an alias
+ * table over them. The shortest (equal-cost) candidates come first.
+ */
+struct rr_set {
+    uint32_t first_candidate;       // Index of the first candidate
+    uint16_t num_candidates;        // Number of candidates (0: none)
+    uint16_t num_shortest;          // Number of equal-cost candidates
+};
+
+// A candidate route, with its column of the set's alias table
+struct rr_candidate {
+    struct fib_entry route;         // The route itself
+    uint32_t alias_threshold;       // Alias table threshold
+    uint16_t alias;                 // Alias (within the set)
+};
+
+/**
+ * The routes to ROUTE_PAGE_SIZE consecutive destinations: their FIB
+ * entries and candidate sets, plus an arena holding the templates of
+ * both. Pages are copy-on-write, shared between the routing state and
+ * the snapshots published from it, so a new snapshot only costs a copy
+ * of the pages whose routes changed since the last one. Only the
+ * routing thread ever takes (or drops) references.
+ */
+struct route_page {
+    uint32_t refcount;              // Holders (routing state, snapshots)
+    uint32_t num_candidates;        // Candidates in use (incl. garbage)
+    uint32_t candidates_garbage;    // Candidates held by replaced sets
+    uint32_t candidates_capacity;   // Allocated candidates
+    size_t templates_size;          // Arena bytes in use (incl. garbage)
+    size_t templates_garbage;       // Arena bytes held by stale templates
+    size_t templates_capacity;      // Allocated arena size (in bytes)
+    struct rr_candidate *candidates;// Candidates, grouped by destination
+    char *templates;                // Arena holding the route templates
+    struct fib_entry fib[ROUTE_PAGE_SIZE];  // Slot -> FIB entry
+    struct rr_set rr_sets[ROUTE_PAGE_SIZE]; // Slot -> Candidate set
+};
+
+// Returns a destination's slot within its page
+static inline uint32_t route_page_slot(const mixnet_address dst_address) {
+    return (dst_address & (ROUTE_PAGE_SIZE - 1));
+}
+
+/**
+ * Returns the route template for a FIB entry (or candidate) in a page:
+ * a routing header followed by the route, fib_template_size() bytes in
+ * total.
+ */
+static inline const mixnet_packet_routing_header *
+route_page_template(const struct route_page *page,
+                    const struct fib_entry *entry) {
+    return (const mixnet_packet_routing_header *) (
+        page->templates + entry->template_offset);
+}
+
+/**
+ * Link-state database: the latest adjacency advertised by each known
+ * node, sorted by address. The routing thread also indexes it by
+ * address (for SPF); the node thread, which only floods LSAs and
+ * re-syncs neighbors, looks entries up by binary search instead.
+ */
+struct lsdb {
+    uint32_t num_entries;           // Number of LSDB entries
+    uint32_t num_adjacencies;       // Sum of all advertised neighbors
+    uint32_t capacity;              // Allocated LSDB entries
+    struct lsdb_entry *entries;     // Entries, sorted by node address
+    uint32_t *slots;                // Address -> idx (NULL if unindexed)
+    mixnet_address *adjacency;      // Arena holding advertised neighbors
+    uint32_t adjacency_size;        // Arena slots in use (incl. garbage)
+    uint32_t adjacency_capacity;    // Allocated arena slots
+};
+
+/**
+ * Routing counters. Both full and incremental SPF runs only rewrite
+ * the FIB entries whose route changed.
+ */
+struct routing_stats {
+    uint32_t num_full_spf;          // Full Dijkstra runs
+    uint32_t num_incremental_spf;   // Incremental SPT updates
+    uint32_t last_fib_changes;      // FIB entries written by the last run
+    uint64_t total_fib_changes;     // FIB entries written across all runs
+};
+
+/**
+ * Per-node routing state (owned by the routing thread): an indexed
+ * LSDB, the shortest-path tree (rooted at this node) computed over
+ * it, and the FIB.
+ */
+struct routing_state {
+    mixnet_address node_addr;       // This node's mixnet address
+    uint16_t num_neighbors;         // This node's total neighbor count
+    const mixnet_address *neighbor_addrs; // Port -> Neighbor address
+    const struct port_index *neighbor_index; // Neighbor address -> Port
+    struct lsdb lsdb;               // LSDB (indexed by address)
+    // SPF
+    uint32_t spf_capacity;          // Allocated SPF slots (>= LSDB's)
+    uint32_t *spf_parent;           // LSDB idx -> Parent's LSDB idx
+    uint16_t *spf_dist;             // LSDB idx -> Hop count to node
+    uint32_t *spf_order;            // LSDB indices in settling order
+    uint32_t *spf_marks;            // LSDB idx -> Epoch it was last visited
+    uint32_t spf_epoch;             // Current incremental update epoch
+    uint32_t spf_num_reached;       // Nodes reached by the last full SPF
+    bool spf_stale;                 // Full SPF required before next lookup?
+    bool fib_stale;                 // Should it rewrite every FIB entry?
+    // Incremental tree updates (scratch, kept across updates)
+    uint32_t *spt_touched;          // Nodes whose distance may change
+    uint32_t *spt_changed;          // Nodes whose place in the tree changed
+    uint16_t *spt_old_dist;         // LSDB idx -> Distance before update
+    uint32_t *spt_old_parent;       // LSDB idx -> Parent before update
+    uint64_t *spt_heap;             // (Distance, LSDB idx) min-heap
+    uint32_t spt_heap_capacity;     // Allocated heap slots
+    // FIB and candidate sets (NULL pages have no routes yet). Both are
+    // brought up-to-date before each snapshot, see fib_snapshot_create.
+    struct route_page *pages[ROUTE_NUM_PAGES];
+    bool rr_stale;                  // LSDB changed since the last build?
+    // Random routing trees: one per neighbor (rooted there, avoiding
+    // this node), kept up-to-date along with the SPT.
+    uint32_t *rr_parent;            // (Port, LSDB idx) -> Parent's LSDB idx
+    uint16_t *rr_dist;              // (Port, LSDB idx) -> Hop count to node
+    port_mask_t rr_hops;            // Neighbors linked to this node
+    bool rr_trees_stale;            // Full recompute required?
+    bool rr_all_dirty;              // Should it check every candidate set?
+    bool *rr_dirty;                 // LSDB idx -> Candidate set changed?
+    uint32_t *rr_dirty_list;        // LSDB indices of changed sets
+    uint32_t rr_num_dirty;          // Number of changed sets
+    // Candidate set construction (scratch, one slot per neighbor)
+    uint16_t *rr_order;             // A set's first hops, in set order
+    double *rr_scaled;              // Alias table construction
+    uint16_t *rr_small;             // (ditto)
+    uint16_t *rr_large;             // (ditto)
+    // Counters
+    struct routing_stats stats;
+};
+
+/**
+ * Initializes (or tears down) an empty LSDB, with or without an
+ * address index (a table with a slot for every possible address).
+ *
+ * @return True if initialization was successful, else false
+ */
+bool lsdb_init(struct lsdb *db, const bool is_indexed);
+void lsdb_destroy(struct lsdb *db);
+
+/**
+ * Installs an advertised adjacency in the LSDB, replacing any
+ * previous advertisement by the same node (unless the stored one
+ * has the same or a newer sequence number, i.e., the LSA is a
+ * duplicate, or the LSAs were reordered). A newer LSA with an
+ * unchanged adjacency only refreshes the entry's sequence number
+ * and age.
+ *
+ * @param now_ms Current time (in ms; may wrap around)
+ * @return True if the LSDB changed (or was refreshed), else false
+ */
+bool lsdb_update(struct lsdb *db,
+                 const mixnet_address node_address,
+                 const uint16_t sequence,
+                 const uint16_t neighbor_count,
+                 const mixnet_address *neighbors,
+                 const uint32_t now_ms);
+
+/**
+ * Returns the LSDB entry for the given node (or NULL).
+ */
+const struct lsdb_entry *lsdb_find(const struct lsdb *db,
+                                   const mixnet_address node_address);
+
+/**
+ * Returns an LSDB entry's advertised neighbor addresses. Valid until
+ * the LSDB is next updated.
+ */
+static inline const mixnet_address *
+lsdb_neighbors(const struct lsdb *db, const struct lsdb_entry *entry) {
+    return &(db->adjacency[entry->first_neighbor]);
+}
+
+/**
+ * Initializes (or tears down) the routing state for a node.
+ *
+ * @param rs Routing state to initialize
+ * @param node_addr This node's mixnet address
+ * @param num_neighbors This node's total neighbor count
+ * @param neighbor_addrs Port -> Neighbor address (must outlive rs)
+ * @param neighbor_index Index of neighbor_addrs (must outlive rs)
+ * @return True if initialization was successful, else false
+ */
+bool routing_init(struct routing_state *rs,
+                  const mixnet_address node_addr,
+                  const uint16_t num_neighbors,
+                  const mixnet_address *neighbor_addrs,
+                  const struct port_index *neighbor_index);
+void routing_destroy(struct routing_state *rs);
+
+/**
+ * Installs an LSA in the routing state's LSDB (see lsdb_update). If
+ * the shortest-path tree is up-to-date, it (and the FIB) are updated
+ * incrementally, touching only the part of the tree affected by
+ * changed links.
+ *
+ * @return True if the LSDB changed (or was refreshed), else false
+ */
+bool routing_update(struct routing_state *rs,
+                    const mixnet_address node_address,
+                    const uint16_t sequence,
+                    const uint16_t neighbor_count,
+                    const mixnet_address *neighbors,
+                    const uint32_t now_ms);
+
+/**
+ * Ages out adjacencies that have not been refreshed for longer than
+ * max_age_ms, as if their nodes had advertised no neighbors (entries
+ * themselves are never removed). This node's own entry never expires.
+ * Only a newer LSA from the node re-installs its adjacency.
+ *
+ * @return The number of adjacencies withdrawn
+ */
+uint32_t routing_expire(struct routing_state *rs, const uint32_t now_ms,
+                        const uint32_t max_age_ms);
+
+/**
+ * Runs Dijkstra over the LSDB, rebuilding the shortest-path tree
+ * and the FIB. Links are only used if both endpoints advertise
+ * one another. Among equal-cost paths, lower addresses win.
+ */
+void routing_compute_spf(struct routing_state *rs);
+
+/**
+ * Looks up the FIB entry for a destination. This is a single array
+ * index (SPF is only re-run first if the LSDB changed since).
+ *
+ * @return The FIB entry, or NULL if the destination is unreachable
+ */
+static inline const struct fib_entry *
+fib_lookup(struct routing_state *rs, const mixnet_address dst_address) {
+    if (rs->spf_stale) { routing_compute_spf(rs); }
+    const struct route_page *page = rs->pages[dst_address >> ROUTE_PAGE_SHIFT];
+    if (page == NULL) { return NULL; }
+
+    const struct fib_entry *entry = &(page->fib[route_page_slot(dst_address)]);
+    return entry->is_valid ? entry : NULL;
+}
+
+static inline size_t fib_template_size(const struct fib_entry *entry) {
+    return (sizeof(mixnet_packet_routing_header) +
+            (sizeof(mixnet_address) * entry->route_length));
+}
+
+/**
+ * Loop-free alternates: brings every destination's candidate set
+ * up-to-date ahead of time if the LSDB changed since (rebuilding only
+ * the sets whose routes changed), so that a failed first hop can be
+ * repaired without waiting for new LSAs (or SPF).
+ *
+ * @return True if the candidates are up-to-date, else false
+ */
+bool lfa_prepare(struct routing_state *rs);
+
+/**
+ * Immutable forwarding state: the FIB and the candidate sets (for
+ * random routing, ECMP, and loop-free alternates) as of one SPF run,
+ * as references to the routing state's pages (which are copied before
+ * they are next written). The control plane builds these and publishes
+ * them (see routing_thread.h); the data plane only reads.
+ */
+struct fib_snapshot {
+    struct route_page *pages[ROUTE_NUM_PAGES];
+};
+
+/**
+ * Brings the routes (and candidates) up-to-date, then takes a reference
+ * to every page. Only the routing thread may create (or free) these.
+ *
+ * @return The snapshot (free with fib_snapshot_free), or NULL on error
+ */
+struct fib_snapshot *fib_snapshot_create(struct routing_state *rs);
+void fib_snapshot_free(struct fib_snapshot *snapshot);
+
+/**
+ * Looks up a destination's FIB entry in a snapshot.
+ *
+ * @return The FIB entry, or NULL if the destination is unreachable
+ */
+static inline const struct fib_entry *
+fib_snapshot_lookup(const struct fib_snapshot *snapshot,
+                    const mixnet_address dst_address) {
+    const struct route_page *page = (
+        snapshot->pages[dst_address >> ROUTE_PAGE_SHIFT]);
+    if (page == NULL) { return NULL; }
+
+    const struct fib_entry *entry = &(page->fib[route_page_slot(dst_address)]);
+    return entry->is_valid ? entry : NULL;
+}
+
+static inline const mixnet_packet_routing_header *
+fib_snapshot_route_template(const struct fib_snapshot *snapshot,
+                            const mixnet_address dst_address,
+                            const struct fib_entry *entry) {
+    return route_page_template(
+        snapshot->pages[dst_address >> ROUTE_PAGE_SHIFT], entry);
+}
+
+/**
+ * Samples a random loop-free route to a destination in O(1). The
+ * candidates are, for each neighbor of this node, the shortest path
+ * to the destination starting with that neighbor (and avoiding this
+ * node). Shorter candidates are proportionally more likely.
+ *
+ * @param snapshot Forwarding state
+ * @param rng_state PRNG state used for sampling (non-zero)
+ * @param dst_address Destination address
+ * @param route_template Set to the candidate's route template
+ * @return The candidate, or NULL if there is none (use the FIB)
+ */
+const struct fib_entry *
+rr_sample(const struct fib_snapshot *snapshot, uint64_t *rng_state,
+          const mixnet_address dst_address,
+          const mixnet_packet_routing_header **route_template);
+
+/**
+ * Hashes a flow (source, destination, and up to the first 8 bytes of
+ * its data) for ECMP. Packets of one flow always hash the same.
+ */
+static inline uint64_t flow_hash(const mixnet_address src_address,
+                                 const mixnet_address dst_address,
+                                 const void *prefix, const size_t size) {
+    uint64_t word = 0;
+    memcpy(&word, prefix, (size < sizeof(word)) ? size : sizeof(word));
+
+    // SplitMix64 finalizer over both words
+    uint64_t h = ((((uint64_t) src_address) << 16) | dst_address);
+    h ^= (word * UINT64_C(0x9E3779B97F4A7C15));
+    h ^= (h >> 30); h *= UINT64_C(0xBF58476D1CE4E5B9);
+    h ^= (h >> 27); h *= UINT64_C(0x94D049BB133111EB);
+    h ^= (h >> 31);
+    return h;
+}
+
+/**
+ * Equal-cost multipath: picks one of the shortest routes to a
+ * destination (one per distinct first hop) by flow hash, so a flow
+ * always takes the same route, and flows spread across links.
+ *
+ * @param snapshot Forwarding state
+ * @param dst_address Destination address
+ * @param hash The packet's flow_hash()
+ * @param route_template Set to the route's template
+ * @return The route, or NULL if there is none (use the FIB)
+ */
+const struct fib_entry *
+ecmp_select(const struct fib_snapshot *snapshot,
+            const mixnet_address dst_address, const uint64_t hash,
+            const mixnet_packet_routing_header **route_template);
+
+/**
+ * Returns the shortest candidate route to a destination whose first
+ * hop is one of the given (live) ports. Each candidate avoids this
+ * node, so the route is loop-free, and never crosses a failed link
+ * adjacent to this node.
+ *
+ * @param snapshot Forwarding state
+ * @param dst_address Destination address
+ * @param live_ports Ports the route may start on
+ * @param route_template Set to the route's template
+ * @return The route, or NULL if there is none
+ */
+const struct fib_entry *
+lfa_select(const struct fib_snapshot *snapshot,
+           const mixnet_address dst_address, const port_mask_t live_ports,
+           const mixnet_packet_routing_header **route_template);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MIXNET_ROUTING_H
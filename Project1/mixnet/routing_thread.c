@@ -0,0 +1,225 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the Mixnet course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the Mixnet project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#include "routing_thread.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Constant parameters
+static const long ROUTING_THREAD_RECLAIM_INTERVAL_NS = 10 * 1000 * 1000;
+
+static void fib_snapshot_free_object(void *snapshot) {
+    fib_snapshot_free((struct fib_snapshot *) snapshot);
+}
+
+// Copies the SPF counters out (the routing thread is their only writer)
+static void routing_thread_publish_stats(struct routing_thread *rt) {
+    const struct routing_stats *stats = &(rt->routing.stats);
+    mixnet_stats_set(&(rt->stats->num_full_spf), stats->num_full_spf);
+    mixnet_stats_set(&(rt->stats->num_incremental_spf), stats->num_incremental_spf);
+    mixnet_stats_set(&(rt->stats->total_fib_changes), stats->total_fib_changes);
+}
+
+/**
+ * Applies every queued update, in order.
+ *
+ * @return True if the LSDB changed, else false
+ */
+static bool routing_thread_apply(struct routing_thread *rt) {
+    bool is_changed = false;
+    const uint32_t tail = __atomic_load_n(&(rt->ring_tail), __ATOMIC_ACQUIRE);
+    uint32_t head = rt->ring_head;
+
+    for (; head != tail; head++) {
+        struct routing_update *update = (
+            rt->ring[head & (ROUTING_THREAD_RING_SIZE - 1)]);
+
+        if (update->is_expiry) {
+            is_changed |= (routing_expire(&(rt->routing), update->now_ms,
+                                          update->max_age_ms) > 0);
+        }
+        else {
+            is_changed |= routing_update(&(rt->routing), update->node_address,
+                                         update->sequence, update->neighbor_count,
+                                         update->neighbors, update->now_ms);
+        }
+        free(update);
+    }
+    __atomic_store_n(&(rt->ring_head), head, __ATOMIC_RELEASE);
+    return is_changed;
+}
+
+static void *routing_thread_main(void *arg) {
+    struct routing_thread *rt = (struct routing_thread *) arg;
+    bool is_pending = false;        // Changes not yet published
+    bool is_reclaiming = false;     // Replaced snapshots not yet freed
+
+    while (__atomic_load_n(&(rt->keep_running), __ATOMIC_ACQUIRE)) {
+        // Wait for updates, waking up periodically while replaced
+        // snapshots (or a failed publish) are outstanding
+        if (is_pending || is_reclaiming) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += ROUTING_THREAD_RECLAIM_INTERVAL_NS;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            while ((sem_timedwait(&(rt->wakeup), &deadline) < 0) &&
+                   (errno == EINTR)) {}
+        }
+        else {
+            while ((sem_wait(&(rt->wakeup)) < 0) && (errno == EINTR)) {}
+        }
+        // Coalesce everything queued so far into a single snapshot
+        is_pending |= routing_thread_apply(rt);
+        if (is_pending) {
+            struct fib_snapshot *snapshot = fib_snapshot_create(&(rt->routing));
+            if ((snapshot != NULL) && !rcu_publish(&(rt->fib), snapshot)) {
+                fib_snapshot_free(snapshot);
+                snapshot = NULL;
+            }
+            is_pending = (snapshot == NULL);
+            routing_thread_publish_stats(rt);
+        }
+        is_reclaiming = rcu_reclaim(&(rt->fib));
+    }
+    return NULL;
+}
+
+bool routing_thread_start(struct routing_thread *rt,
+                          const mixnet_address node_addr,
+                          const uint16_t num_neighbors,
+                          const mixnet_address *neighbor_addrs,
+                          const struct port_index *neighbor_index,
+                          struct mixnet_stats *stats) {
+    rt->keep_running = true;
+    rt->stats = stats;
+    rt->ring_head = 0;
+    rt->ring_tail = 0;
+    rt->backlog_head = NULL;
+    rt->backlog_tail = NULL;
+
+    if (!routing_init(&(rt->routing), node_addr, num_neighbors,
+                      neighbor_addrs, neighbor_index)) {
+        return false;
+    }
+    struct fib_snapshot *snapshot = fib_snapshot_create(&(rt->routing));
+    if (snapshot == NULL) {
+        routing_destroy(&(rt->routing));
+        return false;
+    }
+    rcu_init(&(rt->fib), snapshot, &fib_snapshot_free_object);
+
+    if (sem_init(&(rt->wakeup), 0, 0) != 0) {
+        rcu_destroy(&(rt->fib));
+        routing_destroy(&(rt->routing));
+        return false;
+    }
+    if (pthread_create(&(rt->tid), NULL, &routing_thread_main, rt) != 0) {
+        sem_destroy(&(rt->wakeup));
+        rcu_destroy(&(rt->fib));
+        routing_destroy(&(rt->routing));
+        return false;
+    }
+    return true;
+}
+
+void routing_thread_stop(struct routing_thread *rt) {
+    __atomic_store_n(&(rt->keep_running), false, __ATOMIC_RELEASE);
+    sem_post(&(rt->wakeup));
+    pthread_join(rt->tid, NULL);
+
+    // Drop updates that were never applied
+    for (uint32_t head = rt->ring_head; head != rt->ring_tail; head++) {
+        free(rt->ring[head & (ROUTING_THREAD_RING_SIZE - 1)]);
+    }
+    while (rt->backlog_head != NULL) {
+        struct routing_update *update = rt->backlog_head;
+        rt->backlog_head = update->next;
+        free(update);
+    }
+    rt->backlog_tail = NULL;
+
+    sem_destroy(&(rt->wakeup));
+    rcu_destroy(&(rt->fib));
+    routing_destroy(&(rt->routing));
+}
+
+void routing_thread_flush(struct routing_thread *rt) {
+    const uint32_t head = __atomic_load_n(&(rt->ring_head), __ATOMIC_ACQUIRE);
+    uint32_t tail = rt->ring_tail;
+    if (rt->backlog_head == NULL) { return; }
+
+    while ((rt->backlog_head != NULL) &&
+           ((tail - head) < ROUTING_THREAD_RING_SIZE)) {
+        struct routing_update *update = rt->backlog_head;
+        rt->backlog_head = update->next;
+        rt->ring[tail & (ROUTING_THREAD_RING_SIZE - 1)] = update;
+        tail++;
+    }
+    if (rt->backlog_head == NULL) { rt->backlog_tail = NULL; }
+
+    if (tail != rt->ring_tail) {
+        __atomic_store_n(&(rt->ring_tail), tail, __ATOMIC_RELEASE);
+        sem_post(&(rt->wakeup));
+    }
+}
+
+// Queues an update behind any backlog (preserving order), then flushes
+static void routing_thread_submit(struct routing_thread *rt,
+                                  struct routing_update *update) {
+    update->next = NULL;
+    if (rt->backlog_tail == NULL) { rt->backlog_head = update; }
+    else { rt->backlog_tail->next = update; }
+    rt->backlog_tail = update;
+    routing_thread_flush(rt);
+}
+
+void routing_thread_submit_lsa(struct routing_thread *rt,
+                               const mixnet_address node_address,
+                               const uint16_t sequence,
+                               const uint16_t neighbor_count,
+                               const mixnet_address *neighbors,
+                               const uint32_t now_ms) {
+    struct routing_update *update = malloc(
+        sizeof(struct routing_update) + (sizeof(mixnet_address) * neighbor_count));
+    if (update == NULL) { return; }
+
+    update->is_expiry = false;
+    update->node_address = node_address;
+    update->sequence = sequence;
+    update->neighbor_count = neighbor_count;
+    update->now_ms = now_ms;
+    update->max_age_ms = 0;
+    if (neighbor_count > 0) {
+        memcpy(update->neighbors, neighbors,
+               sizeof(mixnet_address) * neighbor_count);
+    }
+    routing_thread_submit(rt, update);
+}
+
+void routing_thread_submit_expiry(struct routing_thread *rt,
+                                  const uint32_t now_ms,
+                                  const uint32_t max_age_ms) {
+    struct routing_update *update = malloc(sizeof(struct routing_update));
+    if (update == NULL) { return; }
+
+    update->is_expiry = true;
+    update->node_address = 0;
+    update->sequence = 0;
+    update->neighbor_count = 0;
+    update->now_ms = now_ms;
+    update->max_age_ms = max_age_ms;
+    routing_thread_submit(rt, update);
+}
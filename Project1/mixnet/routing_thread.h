@@ -0,0 +1,124 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the Mixnet course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the Mixnet project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#ifndef MIXNET_ROUTING_THREAD_H
+#define MIXNET_ROUTING_THREAD_H
+
+#include "address.h"
+#include "ports.h"
+#include "rcu.h"
+#include "routing.h"
+#include "stats.h"
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Updates in flight (a power of 2)
+#define ROUTING_THREAD_RING_SIZE 256
+
+/**
+ * An LSDB change (an installed LSA, or an expiry pass), handed from the
+ * node's thread to the routing thread.
+ */
+struct routing_update {
+    struct routing_update *next;    // Backlog link (node thread only)
+    bool is_expiry;                 // Expiry pass (else, an LSA)
+    mixnet_address node_address;    // LSA fields
+    uint16_t sequence;
+    uint16_t neighbor_count;
+    uint32_t now_ms;                // Time of the update
+    uint32_t max_age_ms;            // Expiry pass: maximum age
+    mixnet_address neighbors[];
+};
+
+/**
+ * Control-plane thread for a node. It alone owns the routes: it keeps
+ * an indexed copy of the LSDB (fed every LSA the node thread installs
+ * in its own, which holds no routes), ages adjacencies out, runs SPF,
+ * and publishes the result as immutable FIB snapshots. The node thread
+ * forwards using whatever snapshot is current, without locks, so a
+ * long SPF run never stalls forwarding (or vice versa).
+ */
+struct routing_thread {
+    pthread_t tid;
+    bool keep_running;
+    sem_t wakeup;                   // Posted on new updates (or stop)
+    struct routing_state routing;   // LSDB copy and SPF (thread only)
+    struct mixnet_stats *stats;     // Routing counters are copied here
+    struct rcu_pointer fib;         // Current struct fib_snapshot
+
+    // Updates: single-producer, single-consumer ring. If it is full,
+    // the node thread parks updates in its backlog (in order) rather
+    // than waiting for room.
+    struct routing_update *ring[ROUTING_THREAD_RING_SIZE];
+    uint32_t ring_head;             // Next slot to consume
+    uint32_t ring_tail;             // Next slot to produce
+    struct routing_update *backlog_head;
+    struct routing_update *backlog_tail;
+};
+
+/**
+ * Starts (or stops) a node's routing thread. The initial snapshot (a
+ * lone node) is published before this returns.
+ *
+ * @return True if the thread was started, else false
+ */
+bool routing_thread_start(struct routing_thread *rt,
+                          const mixnet_address node_addr,
+                          const uint16_t num_neighbors,
+                          const mixnet_address *neighbor_addrs,
+                          const struct port_index *neighbor_index,
+                          struct mixnet_stats *stats);
+void routing_thread_stop(struct routing_thread *rt);
+
+/**
+ * Node thread: hands an installed LSA (or an expiry pass) over to the
+ * routing thread. Never blocks.
+ */
+void routing_thread_submit_lsa(struct routing_thread *rt,
+                               const mixnet_address node_address,
+                               const uint16_t sequence,
+                               const uint16_t neighbor_count,
+                               const mixnet_address *neighbors,
+                               const uint32_t now_ms);
+void routing_thread_submit_expiry(struct routing_thread *rt,
+                                  const uint32_t now_ms,
+                                  const uint32_t max_age_ms);
+
+/**
+ * Node thread: moves backlogged updates into the ring, if it has room.
+ */
+void routing_thread_flush(struct routing_thread *rt);
+
+/**
+ * Node thread: returns the current FIB snapshot, which stays valid
+ * until the next call to routing_thread_quiescent().
+ */
+static inline const struct fib_snapshot *
+routing_thread_fib(const struct routing_thread *rt) {
+    return (const struct fib_snapshot *) rcu_dereference(&(rt->fib));
+}
+
+// Node thread: announces that it holds no snapshot (e.g., when idle)
+static inline void routing_thread_quiescent(struct routing_thread *rt) {
+    rcu_quiescent(&(rt->fib));
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MIXNET_ROUTING_THREAD_H
@@ -0,0 +1,308 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the Mixnet course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the Mixnet project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#include "rstp.h"
+
+#include <stdlib.h>
+
+// Constant parameters
+static const uint32_t RSTP_INFO_AGE_HELLOS = 3;
+static const uint16_t RSTP_MAX_PATH_LENGTH = 64; // Bounds count-to-infinity
+
+static int vector_compare(const struct rstp_vector *a,
+                          const struct rstp_vector *b) {
+    if (a->root_address != b->root_address) {
+        return (a->root_address < b->root_address) ? -1 : 1;
+    }
+    if (a->path_length != b->path_length) {
+        return (a->path_length < b->path_length) ? -1 : 1;
+    }
+    if (a->node_address != b->node_address) {
+        return (a->node_address < b->node_address) ? -1 : 1;
+    }
+    return 0;
+}
+
+/**
+ * Port state transitions.
+ */
+static void port_forward(struct rstp_state *rs, const uint16_t p) {
+    struct rstp_port *port = &(rs->ports[p]);
+    if (!port->is_forwarding) { rs->num_changes++; }
+    port->is_forwarding = true;
+    port->is_proposing = false;
+    timer_cancel(rs->wheel, &(rs->forward_timers[p]));
+}
+
+static void port_discard(struct rstp_state *rs, const uint16_t p) {
+    struct rstp_port *port = &(rs->ports[p]);
+    if (port->is_forwarding) { rs->num_changes++; }
+    port->is_forwarding = false;
+    port->is_proposing = false;
+    timer_cancel(rs->wheel, &(rs->forward_timers[p]));
+}
+
+static void port_propose(struct rstp_state *rs, const uint16_t p) {
+    port_discard(rs, p);
+    rs->ports[p].is_proposing = true;
+    rs->ports[p].tx_pending = true;
+    timer_arm(rs->wheel, &(rs->forward_timers[p]), rs->forward_delay_ms);
+}
+
+static void port_clear_info(struct rstp_state *rs, const uint16_t p) {
+    rs->ports[p].has_info = false;
+    rs->ports[p].is_agreed = false;
+    timer_cancel(rs->wheel, &(rs->info_timers[p]));
+}
+
+/**
+ * Blocks every forwarding designated port (proposing on each one), so
+ * that a new path to the root cannot close a loop through them.
+ */
+static void sync_ports(struct rstp_state *rs) {
+    for (uint16_t p = 0; p < rs->num_ports; p++) {
+        if ((rs->ports[p].role == RSTP_ROLE_DESIGNATED) &&
+            rs->ports[p].is_forwarding) { port_propose(rs, p); }
+    }
+}
+
+/**
+ * Recomputes the root port and every port's role from the info heard
+ * on each port, and applies the resulting state transitions.
+ */
+static void update_roles(struct rstp_state *rs) {
+    // The root port has the best path vector heard on any port
+    struct rstp_vector best = {rs->node_addr, 0, rs->node_addr};
+    int root_port = -1;
+    for (uint16_t p = 0; p < rs->num_ports; p++) {
+        const struct rstp_port *port = &(rs->ports[p]);
+        if (!port->is_link_up || !port->has_info) { continue; }
+
+        const struct rstp_vector candidate = {
+            port->info.root_address,
+            (uint16_t) (port->info.path_length + 1),
+            port->info.node_address,
+        };
+        if (vector_compare(&candidate, &best) < 0) {
+            best = candidate;
+            root_port = p;
+        }
+    }
+    const bool is_new_root_port = (root_port != rs->root_port);
+    const bool is_new_vector = (vector_compare(&best, &(rs->root)) != 0);
+    rs->root_port = root_port;
+    rs->root = best;
+
+    // Our vector, as advertised on designated ports
+    const struct rstp_vector designated = {
+        best.root_address, best.path_length, rs->node_addr};
+
+    for (uint16_t p = 0; p < rs->num_ports; p++) {
+        struct rstp_port *port = &(rs->ports[p]);
+        enum rstp_port_role role = RSTP_ROLE_DESIGNATED;
+        if (!port->is_link_up) { role = RSTP_ROLE_DISABLED; }
+        else if (p == root_port) { role = RSTP_ROLE_ROOT; }
+        else if (port->has_info &&
+                 (vector_compare(&(port->info), &designated) < 0)) {
+            role = RSTP_ROLE_ALTERNATE;
+        }
+        const enum rstp_port_role old_role = port->role;
+        if (role != old_role) {
+            rs->num_changes++;
+            port->role = role;
+            port->is_agreed = false;
+        }
+
+        switch (role) {
+        case RSTP_ROLE_DISABLED:
+        case RSTP_ROLE_ALTERNATE: { port_discard(rs, p); } break;
+
+        // The info on a designated port is our own, so stale info from
+        // the neighbor must not be used once it stops refreshing it.
+        case RSTP_ROLE_DESIGNATED: {
+            port_clear_info(rs, p);
+            if (old_role != RSTP_ROLE_DESIGNATED) { port_propose(rs, p); }
+            else if (is_new_vector) { port->tx_pending = true; }
+        } break;
+
+        case RSTP_ROLE_ROOT: break;
+        }
+    }
+    // A new root port forwards right away, once the rest are synced
+    if (root_port >= 0) {
+        if (is_new_root_port) { sync_ports(rs); }
+        port_forward(rs, root_port);
+    }
+}
+
+bool rstp_init(struct rstp_state *rs, const mixnet_address node_addr,
+               const uint16_t num_ports, struct timer_wheel *wheel,
+               const uint32_t hello_interval_ms,
+               const uint32_t forward_delay_ms) {
+    rs->node_addr = node_addr;
+    rs->num_ports = num_ports;
+    rs->root_port = -1;
+    rs->root.root_address = node_addr;
+    rs->root.path_length = 0;
+    rs->root.node_address = node_addr;
+    rs->wheel = wheel;
+    rs->info_age_ms = (RSTP_INFO_AGE_HELLOS * hello_interval_ms);
+    rs->forward_delay_ms = forward_delay_ms;
+    rs->num_changes = 0;
+
+    rs->ports = calloc(num_ports, sizeof(struct rstp_port));
+    rs->info_timers = malloc(sizeof(struct node_timer) * num_ports);
+    rs->forward_timers = malloc(sizeof(struct node_timer) * num_ports);
+    if ((num_ports > 0) && ((rs->ports == NULL) ||
+                            (rs->info_timers == NULL) ||
+                            (rs->forward_timers == NULL))) {
+        free(rs->ports);
+        free(rs->info_timers);
+        free(rs->forward_timers);
+        rs->ports = NULL;
+        rs->info_timers = rs->forward_timers = NULL;
+        return false;
+    }
+    for (uint16_t p = 0; p < num_ports; p++) {
+        rs->ports[p].role = RSTP_ROLE_DISABLED;
+        timer_init(&(rs->info_timers[p]));
+        timer_init(&(rs->forward_timers[p]));
+    }
+    return true;
+}
+
+void rstp_destroy(struct rstp_state *rs) {
+    if (rs->ports != NULL) {
+        for (uint16_t p = 0; p < rs->num_ports; p++) {
+            timer_cancel(rs->wheel, &(rs->info_timers[p]));
+            timer_cancel(rs->wheel, &(rs->forward_timers[p]));
+        }
+    }
+    free(rs->ports);
+    free(rs->info_timers);
+    free(rs->forward_timers);
+    rs->ports = NULL;
+    rs->info_timers = rs->forward_timers = NULL;
+}
+
+void rstp_link_changed(struct rstp_state *rs, const uint16_t port,
+                       const bool is_up) {
+    struct rstp_port *p = &(rs->ports[port]);
+    if (p->is_link_up == is_up) { return; }
+
+    p->is_link_up = is_up;
+    p->tx_pending = p->tx_agreement = false;
+    port_clear_info(rs, port);
+    update_roles(rs);
+}
+
+void rstp_receive(struct rstp_state *rs, const uint16_t port,
+                  const mixnet_packet_rstp *bpdu) {
+    struct rstp_port *p = &(rs->ports[port]);
+    if (!p->is_link_up) { return; }
+
+    // Info from a designated neighbor always replaces what we had on
+    // the port, even if it is worse (e.g., the neighbor lost the root).
+    if (bpdu->flags & RSTP_FLAG_DESIGNATED) {
+        const struct rstp_vector info = {
+            bpdu->root_address, bpdu->path_length, bpdu->node_address};
+
+        if (info.path_length >= RSTP_MAX_PATH_LENGTH) {
+            port_clear_info(rs, port);
+        }
+        else {
+            if (!p->has_info || (vector_compare(&info, &(p->info)) != 0)) {
+                p->is_agreed = false;
+            }
+            p->info = info;
+            p->has_info = true;
+            timer_arm(rs->wheel, &(rs->info_timers[port]), rs->info_age_ms);
+        }
+        update_roles(rs);
+
+        // Set a designated neighbor with inferior info straight
+        if (p->role == RSTP_ROLE_DESIGNATED) { p->tx_pending = true; }
+
+        // Agree to a proposal. On the root port, first make sure our own
+        // designated ports are discarding (they will propose in turn).
+        else if (bpdu->flags & RSTP_FLAG_PROPOSAL) {
+            if ((p->role == RSTP_ROLE_ROOT) && !p->is_agreed) {
+                sync_ports(rs);
+                p->is_agreed = true;
+            }
+            p->tx_pending = p->tx_agreement = true;
+        }
+    }
+    // The neighbor agreed to our proposal, so the port can forward
+    else if (bpdu->flags & RSTP_FLAG_AGREEMENT) {
+        if ((p->role == RSTP_ROLE_DESIGNATED) && p->is_proposing &&
+            (bpdu->root_address == rs->root.root_address)) {
+            port_forward(rs, port);
+        }
+    }
+}
+
+void rstp_hello(struct rstp_state *rs) {
+    for (uint16_t p = 0; p < rs->num_ports; p++) {
+        if (rs->ports[p].role == RSTP_ROLE_DESIGNATED) {
+            rs->ports[p].tx_pending = true;
+        }
+    }
+}
+
+bool rstp_handle_timer(struct rstp_state *rs, const struct node_timer *timer) {
+    if ((timer >= rs->info_timers) &&
+        (timer < (rs->info_timers + rs->num_ports))) {
+        // The neighbor went quiet, forget what it told us
+        port_clear_info(rs, (uint16_t) (timer - rs->info_timers));
+        update_roles(rs);
+        return true;
+    }
+    if ((timer >= rs->forward_timers) &&
+        (timer < (rs->forward_timers + rs->num_ports))) {
+        // The neighbor never agreed (fall back to forwarding anyway)
+        const uint16_t p = (uint16_t) (timer - rs->forward_timers);
+        if ((rs->ports[p].role == RSTP_ROLE_DESIGNATED) &&
+            rs->ports[p].is_proposing) { port_forward(rs, p); }
+        return true;
+    }
+    return false;
+}
+
+bool rstp_take_bpdu(struct rstp_state *rs, const uint16_t port,
+                    mixnet_packet_rstp *bpdu) {
+    struct rstp_port *p = &(rs->ports[port]);
+    const bool is_designated = (p->role == RSTP_ROLE_DESIGNATED);
+    const bool should_send = (p->tx_pending && p->is_link_up &&
+                              (is_designated || p->tx_agreement));
+
+    const bool is_agreement = (p->tx_agreement && !is_designated);
+    p->tx_pending = p->tx_agreement = false;
+    if (!should_send) { return false; }
+
+    bpdu->root_address = rs->root.root_address;
+    bpdu->path_length = rs->root.path_length;
+    bpdu->node_address = rs->node_addr;
+    bpdu->flags = (
+        (is_designated ? RSTP_FLAG_DESIGNATED : 0) |
+        ((is_designated && p->is_proposing) ? RSTP_FLAG_PROPOSAL : 0) |
+        (is_agreement ? RSTP_FLAG_AGREEMENT : 0));
+    return true;
+}
+
+bool rstp_is_stable(const struct rstp_state *rs) {
+    for (uint16_t p = 0; p < rs->num_ports; p++) {
+        const struct rstp_port *port = &(rs->ports[p]);
+        if (((port->role == RSTP_ROLE_ROOT) ||
+             (port->role == RSTP_ROLE_DESIGNATED)) &&
+            !port->is_forwarding) { return false; }
+    }
+    return true;
+}
@@ -0,0 +1,145 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the Mixnet course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the Mixnet project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#ifndef MIXNET_RSTP_H
+#define MIXNET_RSTP_H
+
+#include "address.h"
+#include "packet.h"
+#include "timer.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Port roles. Only root and designated ports ever forward.
+ */
+enum rstp_port_role {
+    RSTP_ROLE_DISABLED = 0,         // Link is down
+    RSTP_ROLE_ROOT,                 // Best path to the root
+    RSTP_ROLE_DESIGNATED,           // We are the neighbor's path to the root
+    RSTP_ROLE_ALTERNATE,            // Backup path to the root (discarding)
+};
+
+/**
+ * Spanning tree priority vector (lower is better, compared field by
+ * field): the root, the path length to it, and the designated node.
+ */
+struct rstp_vector {
+    mixnet_address root_address;
+    uint16_t path_length;
+    mixnet_address node_address;
+};
+
+/**
+ * Per-port rapid STP state.
+ */
+struct rstp_port {
+    struct rstp_vector info;        // Latest info from a designated neighbor
+    enum rstp_port_role role;       // Current port role
+    bool has_info;                  // Whether info is valid (not aged out)
+    bool is_link_up;                // Last-seen link state
+    bool is_forwarding;             // Forwarding (else, discarding)
+    bool is_proposing;              // Designated, waiting for an agreement
+    bool is_agreed;                 // Root port that agreed to info
+    bool tx_pending;                // A BPDU should be sent on this port
+    bool tx_agreement;              // ... carrying an agreement
+};
+
+/**
+ * Rapid (RSTP-style) spanning tree state. Every node advertises its
+ * priority vector on its designated ports; a designated port that is
+ * not yet forwarding proposes to its neighbor, which syncs (blocks its
+ * own designated ports) before agreeing, so the tree is extended hop
+ * by hop without waiting on timers. Losing the root port immediately
+ * promotes the best alternate port. Timers are only used to age out
+ * info from neighbors that went quiet, and as a fallback for ports
+ * whose neighbors never agree.
+ */
+struct rstp_state {
+    mixnet_address node_addr;       // This node's mixnet address
+    uint16_t num_ports;             // Number of (neighbor) ports
+    int root_port;                  // Root port (or -1 if we are the root)
+    struct rstp_vector root;        // Our root vector (root, path, next hop)
+    struct rstp_port *ports;        // Per-port state
+
+    // Timers (on the node's wheel)
+    struct timer_wheel *wheel;
+    struct node_timer *info_timers; // Per-port info aging
+    struct node_timer *forward_timers; // Per-port agreement fallback
+    uint32_t info_age_ms;           // Lifetime of received info
+    uint32_t forward_delay_ms;      // Fallback delay before forwarding
+
+    uint32_t num_changes;           // Role/forwarding changes (metrics)
+};
+
+/**
+ * Initializes (or tears down) rapid STP state. All ports start out
+ * with their links down; report link states via rstp_link_changed.
+ *
+ * @param rs State to initialize
+ * @param node_addr This node's mixnet address
+ * @param num_ports Number of neighbor ports
+ * @param wheel Timer wheel to arm the aging and fallback timers on
+ * @param hello_interval_ms Interval between BPDUs on designated ports
+ * @param forward_delay_ms Time after which a proposing port forwards
+ * @return True if initialization was successful, else false
+ */
+bool rstp_init(struct rstp_state *rs, const mixnet_address node_addr,
+               const uint16_t num_ports, struct timer_wheel *wheel,
+               const uint32_t hello_interval_ms,
+               const uint32_t forward_delay_ms);
+void rstp_destroy(struct rstp_state *rs);
+
+/**
+ * Events. Each one updates port roles and states, and marks the ports
+ * on which BPDUs should be sent (see rstp_take_bpdu).
+ */
+void rstp_link_changed(struct rstp_state *rs, const uint16_t port,
+                       const bool is_up);
+void rstp_receive(struct rstp_state *rs, const uint16_t port,
+                  const mixnet_packet_rstp *bpdu);
+void rstp_hello(struct rstp_state *rs);
+
+/**
+ * Handles an expired timer, if it belongs to rapid STP.
+ *
+ * @return True if the timer was handled, else false
+ */
+bool rstp_handle_timer(struct rstp_state *rs, const struct node_timer *timer);
+
+/**
+ * Builds the pending BPDU for a port (if any), and clears it.
+ *
+ * @return True if a BPDU should be sent, else false
+ */
+bool rstp_take_bpdu(struct rstp_state *rs, const uint16_t port,
+                    mixnet_packet_rstp *bpdu);
+
+/**
+ * Returns whether the tree has settled locally: the root port and all
+ * designated ports are forwarding, with no proposal outstanding.
+ */
+bool rstp_is_stable(const struct rstp_state *rs);
+
+static inline bool rstp_is_forwarding(const struct rstp_state *rs,
+                                      const uint16_t port) {
+    return rs->ports[port].is_forwarding;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MIXNET_RSTP_H
@@ -0,0 +1,164 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the Mixnet course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the Mixnet project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#ifndef MIXNET_STATS_H
+#define MIXNET_STATS_H
+
+#include "packet.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Constant parameters
+#define MIXNET_STATS_MAX_PORTS  (65)    // 64 neighbors, plus the user port
+#define MIXNET_STATS_NUM_TYPES  (PACKET_TYPE_PING + 1)
+
+/**
+ * Reasons for which a node drops a packet.
+ */
+enum mixnet_drop_reason_enum {
+    MIXNET_DROP_DUPLICATE = 0,          // Flooded packet seen before
+    MIXNET_DROP_BLOCKED,                // Received on a port it isn't accepted on
+    MIXNET_DROP_NO_ROUTE,               // No (live) route towards the destination
+    MIXNET_DROP_MISROUTED,              // Source route doesn't lead through us
+    MIXNET_DROP_MALFORMED,              // Bad payload
+    MIXNET_DROP_NO_MEMORY,              // No packet buffer for it (or a copy)
+    MIXNET_DROP_NUM_REASONS,
+};
+
+/**
+ * Per-port counters (per-type ones are kept separately, since the
+ * full cross product would not fit in a ctrl message).
+ */
+struct mixnet_port_stats {
+    uint32_t rx_packets;
+    uint32_t tx_packets;
+    uint64_t rx_bytes;                  // Header and payload
+    uint64_t tx_bytes;
+};
+
+struct mixnet_type_stats {
+    uint64_t rx_packets;
+    uint64_t tx_packets;
+    uint64_t rx_bytes;
+    uint64_t tx_bytes;
+};
+
+/**
+ * Per-node protocol counters. Timestamps are on CLOCK_MONOTONIC (in
+ * microseconds), so they are comparable across nodes on one host.
+ *
+ * Each block has a single writer (the node thread), and is read by the
+ * ctrl thread while the node is running. Counters are updated using
+ * relaxed atomic stores (plain moves on x86-64), so reads never see a
+ * torn counter, although a snapshot may mix slightly different times.
+ * The exceptions are the packet allocation counters, which any of the
+ * node's threads may update (using atomic read-modify-writes).
+ */
+struct mixnet_stats {
+    struct mixnet_port_stats ports[MIXNET_STATS_MAX_PORTS]; // Port ID -> Counters
+    struct mixnet_type_stats types[MIXNET_STATS_NUM_TYPES]; // Type -> Counters
+    uint64_t drops[MIXNET_DROP_NUM_REASONS];                // Reason -> Count
+
+    uint64_t rx_batches;                // Receive calls that returned packets
+    uint64_t tx_eagain;                 // Sends that found the socket buffer full
+    uint64_t tx_queued;                 // Packets queued after backpressure
+    uint64_t tx_overflows;              // Packets dropped with the queue full
+    uint64_t tx_queue_depth;            // Packets currently queued
+    uint64_t tx_queue_peak;             // Most packets ever queued at once
+    uint64_t num_full_spf;              // Full SPF (FIB) recomputes
+    uint64_t num_incremental_spf;       // Incremental SPF (FIB) updates
+    uint64_t total_fib_changes;         // FIB entries written by either
+    uint64_t stp_num_convergences;      // Times the spanning tree settled
+    uint64_t stp_changed_us;            // Time the tree last started changing
+    uint64_t stp_converged_us;          // Time it last settled
+    uint64_t pkt_allocs;                // Packet buffers allocated
+    uint64_t pkt_frees;                 // Packet buffers freed
+    uint64_t pkt_peak_live;             // Most buffers ever live at once
+    uint64_t pkt_reserved_bytes;        // Slab memory reserved by its allocations
+};
+
+/**
+ * Writer-side helpers.
+ */
+static inline void mixnet_stats_set(uint64_t *counter, const uint64_t value) {
+    __atomic_store_n(counter, value, __ATOMIC_RELAXED);
+}
+
+static inline void mixnet_stats_add(uint64_t *counter, const uint64_t value) {
+    __atomic_store_n(counter, (*counter + value), __ATOMIC_RELAXED);
+}
+
+static inline void mixnet_stats_count_packet(
+    struct mixnet_stats *stats, const bool is_tx, const uint16_t port,
+    const mixnet_packet_type_t type, const size_t size) {
+    if (port < MIXNET_STATS_MAX_PORTS) {
+        struct mixnet_port_stats *p = &(stats->ports[port]);
+        uint32_t *packets = is_tx ? &(p->tx_packets) : &(p->rx_packets);
+        __atomic_store_n(packets, (*packets + 1), __ATOMIC_RELAXED);
+        mixnet_stats_add(is_tx ? &(p->tx_bytes) : &(p->rx_bytes), size);
+    }
+    if (type < MIXNET_STATS_NUM_TYPES) {
+        struct mixnet_type_stats *t = &(stats->types[type]);
+        mixnet_stats_add(is_tx ? &(t->tx_packets) : &(t->rx_packets), 1);
+        mixnet_stats_add(is_tx ? &(t->tx_bytes) : &(t->rx_bytes), size);
+    }
+}
+
+/**
+ * Reader-side helper: copies a live block, counter by counter.
+ */
+static inline void mixnet_stats_snapshot(struct mixnet_stats *dst,
+                                         const struct mixnet_stats *src) {
+    for (size_t i = 0; i < MIXNET_STATS_MAX_PORTS; i++) {
+        const struct mixnet_port_stats *p = &(src->ports[i]);
+        dst->ports[i].rx_packets = __atomic_load_n(&(p->rx_packets), __ATOMIC_RELAXED);
+        dst->ports[i].tx_packets = __atomic_load_n(&(p->tx_packets), __ATOMIC_RELAXED);
+        dst->ports[i].rx_bytes = __atomic_load_n(&(p->rx_bytes), __ATOMIC_RELAXED);
+        dst->ports[i].tx_bytes = __atomic_load_n(&(p->tx_bytes), __ATOMIC_RELAXED);
+    }
+    for (size_t i = 0; i < MIXNET_STATS_NUM_TYPES; i++) {
+        const struct mixnet_type_stats *t = &(src->types[i]);
+        dst->types[i].rx_packets = __atomic_load_n(&(t->rx_packets), __ATOMIC_RELAXED);
+        dst->types[i].tx_packets = __atomic_load_n(&(t->tx_packets), __ATOMIC_RELAXED);
+        dst->types[i].rx_bytes = __atomic_load_n(&(t->rx_bytes), __ATOMIC_RELAXED);
+        dst->types[i].tx_bytes = __atomic_load_n(&(t->tx_bytes), __ATOMIC_RELAXED);
+    }
+    for (size_t i = 0; i < MIXNET_DROP_NUM_REASONS; i++) {
+        dst->drops[i] = __atomic_load_n(&(src->drops[i]), __ATOMIC_RELAXED);
+    }
+    dst->rx_batches = __atomic_load_n(&(src->rx_batches), __ATOMIC_RELAXED);
+    dst->tx_eagain = __atomic_load_n(&(src->tx_eagain), __ATOMIC_RELAXED);
+    dst->tx_queued = __atomic_load_n(&(src->tx_queued), __ATOMIC_RELAXED);
+    dst->tx_overflows = __atomic_load_n(&(src->tx_overflows), __ATOMIC_RELAXED);
+    dst->tx_queue_depth = __atomic_load_n(&(src->tx_queue_depth), __ATOMIC_RELAXED);
+    dst->tx_queue_peak = __atomic_load_n(&(src->tx_queue_peak), __ATOMIC_RELAXED);
+    dst->num_full_spf = __atomic_load_n(&(src->num_full_spf), __ATOMIC_RELAXED);
+    dst->num_incremental_spf = __atomic_load_n(&(src->num_incremental_spf), __ATOMIC_RELAXED);
+    dst->total_fib_changes = __atomic_load_n(&(src->total_fib_changes), __ATOMIC_RELAXED);
+    dst->stp_num_convergences = __atomic_load_n(&(src->stp_num_convergences), __ATOMIC_RELAXED);
+    dst->stp_changed_us = __atomic_load_n(&(src->stp_changed_us), __ATOMIC_RELAXED);
+    dst->stp_converged_us = __atomic_load_n(&(src->stp_converged_us), __ATOMIC_RELAXED);
+    dst->pkt_allocs = __atomic_load_n(&(src->pkt_allocs), __ATOMIC_RELAXED);
+    dst->pkt_frees = __atomic_load_n(&(src->pkt_frees), __ATOMIC_RELAXED);
+    dst->pkt_peak_live = __atomic_load_n(&(src->pkt_peak_live), __ATOMIC_RELAXED);
+    dst->pkt_reserved_bytes = __atomic_load_n(&(src->pkt_reserved_bytes), __ATOMIC_RELAXED);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MIXNET_STATS_H
@@ -0,0 +1,200 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the Mixnet course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the Mixnet project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#include "timer.h"
+
+#include <stddef.h>
+
+// Constant parameters
+static const uint64_t TIMER_SLOT_MASK = (TIMER_WHEEL_SLOTS - 1);
+static const uint64_t TIMER_MAX_TICK = (
+    (UINT64_C(1) << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1);
+static const uint8_t TIMER_LEVEL_EXPIRED = UINT8_MAX;
+
+/**
+ * Intrusive circular list helpers (the head is a sentinel).
+ */
+static inline void list_init(struct node_timer *head) {
+    head->prev = head->next = head;
+}
+
+static inline bool list_is_empty(const struct node_timer *head) {
+    return (head->next == head);
+}
+
+static inline void list_push_back(struct node_timer *head,
+                                  struct node_timer *timer) {
+    timer->prev = head->prev;
+    timer->next = head;
+    head->prev->next = timer;
+    head->prev = timer;
+}
+
+static inline void list_unlink(struct node_timer *timer) {
+    timer->prev->next = timer->next;
+    timer->next->prev = timer->prev;
+    timer->prev = timer->next = NULL;
+}
+
+/**
+ * Returns the tick at which the wheel's time reaches the given slot,
+ * i.e., when the timers in it must be cascaded. All occupied slots at
+ * a level lie ahead of the current tick within the same rotation of
+ * the level above it.
+ */
+static inline uint64_t slot_tick(const struct timer_wheel *wheel,
+                                 const int level, const int slot) {
+    const int shift = (TIMER_WHEEL_BITS * level);
+    const uint64_t rotation = (
+        (wheel->current_tick >> (shift + TIMER_WHEEL_BITS)) <<
+        (shift + TIMER_WHEEL_BITS));
+    return (rotation | (((uint64_t) slot) << shift));
+}
+
+/**
+ * Returns the earliest tick at which some slot must be cascaded (or
+ * UINT64_MAX if the wheel is empty).
+ */
+static uint64_t next_event_tick(const struct timer_wheel *wheel) {
+    uint64_t next_tick = UINT64_MAX;
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        if (wheel->occupied[level] == 0) { continue; }
+
+        const int slot = __builtin_ctzll(wheel->occupied[level]);
+        const uint64_t tick = slot_tick(wheel, level, slot);
+        if (tick < next_tick) { next_tick = tick; }
+    }
+    return next_tick;
+}
+
+/**
+ * Links an armed timer into the slot for its expiry (relative to the
+ * wheel's current time), or onto the expired list if it is due.
+ */
+static void timer_insert(struct timer_wheel *wheel, struct node_timer *timer) {
+    if (timer->expiry_tick <= wheel->current_tick) {
+        timer->level = TIMER_LEVEL_EXPIRED;
+        list_push_back(&(wheel->expired), timer);
+        return;
+    }
+    // Highest digit in which the expiry differs from the current tick
+    const uint64_t diff = (timer->expiry_tick ^ wheel->current_tick);
+    const int level = ((63 - __builtin_clzll(diff)) / TIMER_WHEEL_BITS);
+    const int slot = (int) ((timer->expiry_tick >>
+                            (TIMER_WHEEL_BITS * level)) & TIMER_SLOT_MASK);
+
+    timer->level = (uint8_t) level;
+    timer->slot = (uint8_t) slot;
+    list_push_back(&(wheel->slots[level][slot]), timer);
+    wheel->occupied[level] |= (UINT64_C(1) << slot);
+}
+
+/**
+ * Re-inserts every timer in the given slot relative to the (updated)
+ * current tick, moving each one down a level or onto the expired list.
+ */
+static void cascade_slot(struct timer_wheel *wheel,
+                         const int level, const int slot) {
+    struct node_timer *head = &(wheel->slots[level][slot]);
+    wheel->occupied[level] &= ~(UINT64_C(1) << slot);
+
+    // Detach the list first, since timers are re-linked as we go
+    struct node_timer todo;
+    todo.next = head->next;
+    todo.prev = head->prev;
+    todo.next->prev = &todo;
+    todo.prev->next = &todo;
+    list_init(head);
+
+    while (!list_is_empty(&todo)) {
+        struct node_timer *timer = todo.next;
+        list_unlink(timer);
+        timer_insert(wheel, timer);
+    }
+}
+
+void timer_wheel_init(struct timer_wheel *wheel, const uint64_t now_us) {
+    wheel->base_us = now_us;
+    wheel->current_tick = 0;
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        wheel->occupied[level] = 0;
+        for (int slot = 0; slot < TIMER_WHEEL_SLOTS; slot++) {
+            list_init(&(wheel->slots[level][slot]));
+        }
+    }
+    list_init(&(wheel->expired));
+}
+
+void timer_arm(struct timer_wheel *wheel, struct node_timer *timer,
+               const uint32_t interval_ms) {
+    timer_cancel(wheel, timer);
+
+    uint64_t expiry_tick = (wheel->current_tick + interval_ms);
+    if (expiry_tick > TIMER_MAX_TICK) { expiry_tick = TIMER_MAX_TICK; }
+
+    timer->expiry_tick = expiry_tick;
+    timer->is_armed = true;
+    timer_insert(wheel, timer);
+}
+
+void timer_cancel(struct timer_wheel *wheel, struct node_timer *timer) {
+    if (!timer->is_armed) { return; }
+    list_unlink(timer);
+    timer->is_armed = false;
+
+    if (timer->level != TIMER_LEVEL_EXPIRED) {
+        const struct node_timer *head = (
+            &(wheel->slots[timer->level][timer->slot]));
+
+        if (list_is_empty(head)) {
+            wheel->occupied[timer->level] &= ~(UINT64_C(1) << timer->slot);
+        }
+    }
+}
+
+void timer_wheel_advance(struct timer_wheel *wheel, const uint64_t now_us) {
+    uint64_t now_tick = (now_us > wheel->base_us) ?
+                        ((now_us - wheel->base_us) / 1000) : 0;
+    if (now_tick > TIMER_MAX_TICK) { now_tick = TIMER_MAX_TICK; }
+
+    // Jump from one occupied slot to the next, rather than tick by tick
+    uint64_t event_tick;
+    while ((event_tick = next_event_tick(wheel)) <= now_tick) {
+        wheel->current_tick = event_tick;
+        for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+            if (wheel->occupied[level] == 0) { continue; }
+
+            const int slot = __builtin_ctzll(wheel->occupied[level]);
+            if (slot_tick(wheel, level, slot) == event_tick) {
+                cascade_slot(wheel, level, slot);
+            }
+        }
+    }
+    if (now_tick > wheel->current_tick) { wheel->current_tick = now_tick; }
+}
+
+struct node_timer *timer_wheel_next_expired(struct timer_wheel *wheel) {
+    if (list_is_empty(&(wheel->expired))) { return NULL; }
+
+    struct node_timer *timer = wheel->expired.next;
+    list_unlink(timer);
+    timer->is_armed = false;
+    return timer;
+}
+
+int timer_wheel_ms_until_next(const struct timer_wheel *wheel) {
+    if (!list_is_empty(&(wheel->expired))) { return 0; }
+
+    const uint64_t event_tick = next_event_tick(wheel);
+    if (event_tick == UINT64_MAX) { return -1; }
+
+    const uint64_t remaining = (event_tick - wheel->current_tick);
+    return (remaining > INT32_MAX) ? INT32_MAX : (int) remaining;
+}
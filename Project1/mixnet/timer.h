@@ -0,0 +1,119 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the Mixnet course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the Mixnet project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#ifndef MIXNET_TIMER_H
+#define MIXNET_TIMER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Wheel geometry: 6 levels of 64 slots, with a 1 ms tick, covers
+// expiries up to 2^36 ms (~795 days) after the wheel is created.
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS 6
+
+/**
+ * A one-shot protocol timer (e.g., STP hello or reelection). Timers
+ * are intrusive list nodes owned by the caller; the wheel only links
+ * them into its slots while they are armed.
+ */
+struct node_timer {
+    struct node_timer *prev;        // Neighbors in the slot list
+    struct node_timer *next;
+    uint64_t expiry_tick;           // Expiry time (in wheel ticks)
+    uint8_t level;                  // Wheel level (or the expired list)
+    uint8_t slot;                   // Slot index within that level
+    bool is_armed;                  // Whether the timer is pending
+};
+
+/**
+ * Hierarchical timer wheel on CLOCK_MONOTONIC. A timer is placed on
+ * the level of the highest digit (base 64) in which its expiry differs
+ * from the current tick, and is cascaded to a lower level (or expired)
+ * once the wheel's time reaches its slot. Arm and cancel are O(1);
+ * advancing is O(1) per timer cascaded or expired, regardless of how
+ * much time has passed.
+ */
+struct timer_wheel {
+    uint64_t base_us;               // Monotonic time of tick 0
+    uint64_t current_tick;          // Time as of the last advance
+    uint64_t occupied[TIMER_WHEEL_LEVELS];  // Non-empty slot bitmaps
+    struct node_timer slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    struct node_timer expired;      // Expired timers not yet popped
+};
+
+/**
+ * Returns the current CLOCK_MONOTONIC time (in microseconds).
+ */
+static inline uint64_t timer_now_us(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (((uint64_t) now.tv_sec) * 1000000) + (now.tv_nsec / 1000);
+}
+
+/**
+ * Initializes an (empty) timer wheel starting at the given time.
+ */
+void timer_wheel_init(struct timer_wheel *wheel, const uint64_t now_us);
+
+/**
+ * Initializes a timer in the disarmed state.
+ */
+static inline void timer_init(struct node_timer *timer) {
+    timer->prev = timer->next = NULL;
+    timer->expiry_tick = 0;
+    timer->level = timer->slot = 0;
+    timer->is_armed = false;
+}
+
+/**
+ * (Re-)arms a timer to expire interval_ms after the wheel's current
+ * time (as of the last call to timer_wheel_advance). Re-arming a
+ * pending timer replaces its old deadline.
+ */
+void timer_arm(struct timer_wheel *wheel, struct node_timer *timer,
+               const uint32_t interval_ms);
+
+/**
+ * Cancels a timer (a no-op if it is not armed).
+ */
+void timer_cancel(struct timer_wheel *wheel, struct node_timer *timer);
+
+/**
+ * Advances the wheel's time to now_us, moving every timer whose
+ * deadline has passed onto the expired list.
+ */
+void timer_wheel_advance(struct timer_wheel *wheel, const uint64_t now_us);
+
+/**
+ * Pops the next expired timer (which is left disarmed).
+ *
+ * @return The expired timer, or NULL if there are none
+ */
+struct node_timer *timer_wheel_next_expired(struct timer_wheel *wheel);
+
+/**
+ * Returns the time (in ms) from the wheel's current time until it next
+ * needs to be advanced, suitable as a blocking timeout. Returns 0 if
+ * a timer has already expired, or -1 if none is armed.
+ */
+int timer_wheel_ms_until_next(const struct timer_wheel *wheel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MIXNET_TIMER_H
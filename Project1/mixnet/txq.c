@@ -0,0 +1,247 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the Mixnet course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the Mixnet project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#include "txq.h"
+
+#include "connection.h"
+#include "stats.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool txq_init(struct tx_queues *q, const uint16_t num_ports) {
+    q->num_ports = (num_ports < PORT_MASK_MAX_PORTS) ?
+                   num_ports : PORT_MASK_MAX_PORTS;
+    q->backlogged = 0;
+    q->control_backlogged = 0;
+    q->watched = 0;
+    q->depth = 0;
+
+    q->ports = calloc((q->num_ports > 0) ? q->num_ports : 1,
+                      sizeof(struct tx_port));
+    if (q->ports == NULL) { return false; }
+
+    for (uint16_t port = 0; port < q->num_ports; port++) {
+        q->ports[port].drr_class = TXQ_CLASS_CONTROL + 1;
+    }
+    return true;
+}
+
+void txq_destroy(void *handle, struct tx_queues *q) {
+    for (port_mask_t ports = q->backlogged; ports != 0; ) {
+        struct tx_port *p = &(q->ports[port_mask_pop(&ports)]);
+        for (int cls = 0; cls < TXQ_NUM_CLASSES; cls++) {
+            const struct tx_ring *ring = &(p->rings[cls]);
+            for (uint16_t i = 0; i < ring->count; i++) {
+                mixnet_packet_free(handle, ring->packets[(ring->head + i) &
+                                                         (TXQ_RING_SIZE - 1)]);
+            }
+        }
+    }
+    free(q->ports);
+    q->ports = NULL;
+    q->backlogged = 0;
+    q->control_backlogged = 0;
+    q->depth = 0;
+}
+
+static inline size_t packet_size(const mixnet_packet *packet) {
+    return (sizeof(mixnet_packet) + packet->payload_size);
+}
+
+/**
+ * Publishes the queue depth (and its peak) to the node's counters.
+ */
+static void txq_publish_depth(void *handle, const struct tx_queues *q) {
+    struct mixnet_stats *stats = mixnet_get_stats(handle);
+    mixnet_stats_set(&(stats->tx_queue_depth), q->depth);
+    if (q->depth > stats->tx_queue_peak) {
+        mixnet_stats_set(&(stats->tx_queue_peak), q->depth);
+    }
+}
+
+/**
+ * Returns whether sending a packet of the given class on a port right
+ * away would overtake packets that must go first.
+ */
+static inline bool txq_must_wait(const struct tx_queues *q,
+                                 const uint8_t port,
+                                 const enum txq_class_enum cls) {
+    return port_mask_has((cls == TXQ_CLASS_CONTROL) ?
+                         q->control_backlogged : q->backlogged, port);
+}
+
+/**
+ * Appends a packet (taking ownership of it) to a port's ring for its
+ * class.
+ *
+ * @return True if it was queued, false if the ring was full
+ */
+static bool txq_push(void *handle, struct tx_queues *q,
+                     const uint8_t port, mixnet_packet *packet) {
+    if (packet == NULL) {
+        mixnet_stats_add(&(mixnet_get_stats(handle)->tx_overflows), 1);
+        return false;
+    }
+    const enum txq_class_enum cls = txq_class_of(packet->type);
+    struct tx_ring *ring = &(q->ports[port].rings[cls]);
+    if (ring->count == TXQ_RING_SIZE) {
+        mixnet_stats_add(&(mixnet_get_stats(handle)->tx_overflows), 1);
+        mixnet_packet_free(handle, packet);
+        return false;
+    }
+    ring->packets[(ring->head + ring->count) & (TXQ_RING_SIZE - 1)] = packet;
+    ring->count++;
+    q->backlogged |= port_mask_bit(port);
+    if (cls == TXQ_CLASS_CONTROL) {
+        q->control_backlogged |= port_mask_bit(port);
+    }
+    q->depth++;
+
+    mixnet_stats_add(&(mixnet_get_stats(handle)->tx_queued), 1);
+    txq_publish_depth(handle, q);
+    return true;
+}
+
+int txq_send(void *handle, struct tx_queues *q, const uint8_t port,
+             mixnet_packet *packet) {
+    // The user port never sees backpressure
+    if (port >= q->num_ports) { return mixnet_send(handle, port, packet); }
+
+    if (!txq_must_wait(q, port, txq_class_of(packet->type))) {
+        const int rc = mixnet_send(handle, port, packet);
+        if (rc != 0) { return rc; }
+    }
+    return txq_push(handle, q, port, packet) ? 1 : 0;
+}
+
+int txq_send_multi(void *handle, struct tx_queues *q,
+                   const port_mask_t port_mask, mixnet_packet *packet) {
+    // Ports on which the packet would overtake queued ones must wait
+    const bool is_control = (txq_class_of(packet->type) == TXQ_CLASS_CONTROL);
+    port_mask_t pending = port_mask & (is_control ? q->control_backlogged :
+                                                    q->backlogged);
+    const port_mask_t direct = (port_mask & ~pending);
+
+    int num_sent = 0;
+    if (direct != 0) {
+        uint64_t unsent = 0;
+        num_sent = mixnet_send_multi(handle, direct, packet, &unsent);
+        if (num_sent < 0) { return -1; }
+        pending |= unsent;
+    }
+    if (pending == 0) {
+        mixnet_packet_free(handle, packet);
+        return num_sent;
+    }
+    // Queue a copy per pending port (the last one takes the original)
+    const size_t total_size = packet_size(packet);
+    while (pending != 0) {
+        const uint8_t port = (uint8_t) port_mask_pop(&pending);
+        mixnet_packet *copy = packet;
+        if (pending != 0) {
+            copy = mixnet_packet_alloc(handle, total_size);
+            if (copy != NULL) { memcpy(copy, packet, total_size); }
+        }
+        num_sent += txq_push(handle, q, port, copy) ? 1 : 0;
+    }
+    return num_sent;
+}
+
+/**
+ * Picks the ring to serve next on a port: control, if any is queued,
+ * else the data class whose deficit round-robin turn it is.
+ *
+ * @return The ring, or NULL if the port has nothing queued
+ */
+static struct tx_ring *txq_next_ring(struct tx_port *p) {
+    if (p->rings[TXQ_CLASS_CONTROL].count != 0) {
+        return &(p->rings[TXQ_CLASS_CONTROL]);
+    }
+    // Each quantum covers a maximum-sized packet, so any non-empty
+    // class is served within one full round.
+    const int num_data_classes = (TXQ_NUM_CLASSES - 1);
+    for (int i = 0; i < (2 * num_data_classes); i++) {
+        const uint8_t cls = p->drr_class;
+        struct tx_ring *ring = &(p->rings[cls]);
+        if (ring->count != 0) {
+            if (!p->drr_turn_started) {
+                p->deficits[cls] += TXQ_DRR_QUANTUM;
+                p->drr_turn_started = true;
+            }
+            if (packet_size(ring->packets[ring->head]) <= p->deficits[cls]) {
+                return ring;
+            }
+        } else {
+            p->deficits[cls] = 0; // Idle classes don't bank credit
+        }
+        // End this class's turn
+        p->drr_turn_started = false;
+        p->drr_class = (cls == num_data_classes) ? 1 : (cls + 1);
+    }
+    return NULL;
+}
+
+void txq_drain(void *handle, struct tx_queues *q) {
+    for (port_mask_t ports = q->backlogged; ports != 0; ) {
+        const uint8_t port = (uint8_t) port_mask_pop(&ports);
+        struct tx_port *p = &(q->ports[port]);
+
+        struct tx_ring *ring;
+        while ((ring = txq_next_ring(p)) != NULL) {
+            // Send the packets this ring may send in a row as one batch:
+            // all of control, or as many as a data class's deficit covers
+            const ptrdiff_t cls = ring - p->rings;
+            mixnet_packet *batch[TXQ_SEND_BATCH_SIZE];
+            size_t sizes[TXQ_SEND_BATCH_SIZE];
+            size_t credit = p->deficits[cls];
+            int num_batched = 0;
+            while ((num_batched < TXQ_SEND_BATCH_SIZE) &&
+                   (num_batched < ring->count)) {
+                mixnet_packet *packet = ring->packets[
+                    (ring->head + num_batched) & (TXQ_RING_SIZE - 1)];
+                const size_t size = packet_size(packet);
+                if (cls != TXQ_CLASS_CONTROL) {
+                    if (size > credit) { break; }
+                    credit -= size;
+                }
+                batch[num_batched] = packet;
+                sizes[num_batched++] = size;
+            }
+            int rc = mixnet_send_batch(handle, port, batch, num_batched);
+            if (rc == 0) { break; } // Still full
+
+            const bool is_full = ((rc > 0) && (rc < num_batched));
+            if (rc < 0) {
+                printf("Error sending queued pkt\n");
+                mixnet_packet_free(handle, batch[0]);
+                rc = 1;
+            }
+            for (int i = 0; i < rc; i++) {
+                if (cls != TXQ_CLASS_CONTROL) { p->deficits[cls] -= sizes[i]; }
+            }
+            ring->head = (ring->head + rc) & (TXQ_RING_SIZE - 1);
+            ring->count -= rc;
+            q->depth -= rc;
+            if (is_full) { break; }
+        }
+        if (p->rings[TXQ_CLASS_CONTROL].count == 0) {
+            q->control_backlogged &= ~port_mask_bit(port);
+        }
+        if (ring == NULL) { q->backlogged &= ~port_mask_bit(port); }
+    }
+    if (q->watched != q->backlogged) {
+        mixnet_watch_writable(handle, q->backlogged);
+        q->watched = q->backlogged;
+    }
+    txq_publish_depth(handle, q);
+}
@@ -0,0 +1,142 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the Mixnet course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the Mixnet project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#ifndef MIXNET_TXQ_H
+#define MIXNET_TXQ_H
+
+#include "packet.h"
+#include "ports.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Packets held per port and class (a power of 2). Once a ring is
+// full, further packets for it are dropped (and counted as overflows).
+#define TXQ_RING_SIZE 64
+
+// Bytes each data class may send per deficit round-robin turn (at
+// least one maximum-sized packet, so every turn makes progress).
+#define TXQ_DRR_QUANTUM MAX_MIXNET_PACKET_SIZE
+
+// Most packets handed to mixnet_send_batch() at once
+#define TXQ_SEND_BATCH_SIZE 32
+
+/**
+ * Scheduling classes. Control packets are always served first (so
+ * that hellos and LSAs are not stuck behind bulk data); the data
+ * classes share what is left using deficit round-robin.
+ */
+enum txq_class_enum {
+    TXQ_CLASS_CONTROL = 0,          // STP and LSA
+    TXQ_CLASS_FLOOD,
+    TXQ_CLASS_DATA,
+    TXQ_CLASS_PING,
+    TXQ_NUM_CLASSES,
+};
+
+static inline enum txq_class_enum txq_class_of(const mixnet_packet_type_t type) {
+    switch (type) {
+    case PACKET_TYPE_FLOOD: return TXQ_CLASS_FLOOD;
+    case PACKET_TYPE_DATA: return TXQ_CLASS_DATA;
+    case PACKET_TYPE_PING: return TXQ_CLASS_PING;
+    default: return TXQ_CLASS_CONTROL;
+    }
+}
+
+/**
+ * FIFO of packets that hit backpressure (the socket buffer was full),
+ * in the order they were sent.
+ */
+struct tx_ring {
+    mixnet_packet *packets[TXQ_RING_SIZE];
+    uint16_t head;                  // Index of the oldest packet
+    uint16_t count;                 // Number of packets held
+};
+
+/**
+ * Per-port scheduler state: one ring per class, plus the deficit
+ * round-robin state of the data classes.
+ */
+struct tx_port {
+    struct tx_ring rings[TXQ_NUM_CLASSES];
+    uint32_t deficits[TXQ_NUM_CLASSES]; // Class -> Bytes it may still send
+    uint8_t drr_class;              // Data class whose turn it is
+    bool drr_turn_started;          // Whether that turn's quantum was added
+};
+
+/**
+ * Transmit queues for a node's (neighbor) ports. A port with a non-
+ * empty ring is backlogged: new packets for it are queued behind the
+ * backlog of their class, so each class sends in order. Control
+ * packets may overtake queued data. The user port never sees
+ * backpressure, so it has no rings.
+ */
+struct tx_queues {
+    uint16_t num_ports;             // Number of neighbor ports
+    struct tx_port *ports;          // Port -> Scheduler state
+    port_mask_t backlogged;         // Ports with any non-empty ring
+    port_mask_t control_backlogged; // Ports with queued control packets
+    port_mask_t watched;            // Ports watched for writability
+    uint32_t depth;                 // Packets held across all rings
+};
+
+/**
+ * Initializes (or tears down) the queues. Tearing them down frees any
+ * packets that are still queued (with mixnet_packet_free).
+ *
+ * @return True if initialization was successful, else false
+ */
+bool txq_init(struct tx_queues *q, const uint16_t num_ports);
+void txq_destroy(void *handle, struct tx_queues *q);
+
+/**
+ * Sends a packet on a port (see mixnet_send), queueing it instead if
+ * that would overtake queued packets (control packets only wait for
+ * other control packets), or if the send hits backpressure.
+ *
+ * @return 1 if the packet was sent or queued, 0 if it was dropped (the
+ *         ring was full), or -1 if it is invalid (the caller keeps it)
+ */
+int txq_send(void *handle, struct tx_queues *q, const uint8_t port,
+             mixnet_packet *packet);
+
+/**
+ * Sends a packet on several (neighbor) ports (see mixnet_send_multi).
+ * Ports on which it would overtake queued packets, or that hit
+ * backpressure, get a copy of the packet queued instead. Takes
+ * ownership of the packet unless it is invalid.
+ *
+ * @return Number of ports the packet was sent or queued on, or -1 if
+ *         it is invalid (the caller keeps it)
+ */
+int txq_send_multi(void *handle, struct tx_queues *q,
+                   const port_mask_t port_mask, mixnet_packet *packet);
+
+/**
+ * Sends as many queued packets as the sockets will take (control
+ * first, then the data classes by deficit round-robin), and watches
+ * the ports still backlogged for writability (waking
+ * mixnet_recv_timeout once they can make progress).
+ */
+void txq_drain(void *handle, struct tx_queues *q);
+
+static inline bool txq_is_backlogged(const struct tx_queues *q) {
+    return (q->backlogged != 0);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MIXNET_TXQ_H
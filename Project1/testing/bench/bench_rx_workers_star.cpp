@@ -0,0 +1,138 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the Mixnet course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the Mixnet project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#include "test_common.h"
+#include "harness/orchestrator.h"
+
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+
+// Constant parameters
+static const uint16_t num_nodes = 9;
+static const uint16_t hub_idx = num_nodes / 2;
+static const uint64_t default_packets_per_leaf = 2000;
+static const int delivery_timeout_ms = 60000;
+
+static uint64_t packets_per_leaf = default_packets_per_leaf;
+static std::atomic<uint64_t> num_delivered(0);
+static double elapsed_ms = -1;
+static struct mixnet_stats hub_stats;
+static bool stats_ok = false;
+static test_error_code_t retcode = TEST_ERROR_NONE;
+
+void pcap(orchestrator* orchestrator,
+          struct test_message_header* header,
+          struct mixnet_packet* packet) {
+    (void) orchestrator;
+    (void) header;
+
+    if (packet->type == PACKET_TYPE_DATA) { num_delivered++; }
+}
+
+/**
+ * Every leaf sends DATA to the leaf after it, round-robin, so all the
+ * traffic crosses the hub. Times the run from the first send until
+ * every packet is delivered (or the timeout).
+ */
+void testcase(orchestrator* orchestrator) {
+    sleep(5); // Wait for routing convergence
+    auto error_code = TEST_ERROR_NONE;
+
+    for (uint16_t i = 0; i < num_nodes; i++) {
+        if (i == hub_idx) { continue; }
+        DIE_ON_ERROR(orchestrator->pcap_change_subscription(i, true));
+    }
+    const uint64_t num_packets = (packets_per_leaf * (num_nodes - 1));
+    const std::string data(MAX_TEST_MESSAGE_DATA - 1, 'm');
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint64_t k = 0; k < packets_per_leaf; k++) {
+        for (uint16_t src = 0; src < num_nodes; src++) {
+            if (src == hub_idx) { continue; }
+            uint16_t dst = (src + 1) % num_nodes;
+            if (dst == hub_idx) { dst = (dst + 1) % num_nodes; }
+            DIE_ON_ERROR(orchestrator->send_packet(
+                src, dst, PACKET_TYPE_DATA, data));
+        }
+    }
+    for (int waited_ms = 0; (num_delivered < num_packets) &&
+                            (waited_ms < delivery_timeout_ms); waited_ms++) {
+        usleep(1000);
+    }
+    elapsed_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+
+    std::vector<struct mixnet_stats> stats;
+    DIE_ON_ERROR(orchestrator->collect_stats(stats));
+    hub_stats = stats[hub_idx];
+    stats_ok = true;
+}
+
+void return_code(test_error_code_t value) {
+    retcode = value;
+}
+
+/**
+ * Measures DATA throughput across the hub of a 9-node star, and how
+ * the hub's node thread receives it (packets per non-empty receive
+ * batch), with the given number of RX workers per node.
+ * Usage: bench_rx_workers_star [-a] [num_rx_workers] [packets_per_leaf]
+ */
+int main(int argc, char **argv) {
+    std::vector<std::vector<mixnet_address>> topology;
+    std::vector<mixnet_address> mixaddrs;
+    create_star_topology(num_nodes, topology);
+    for (uint16_t i = 0; i < num_nodes; i++) { mixaddrs.push_back(i + 1); }
+
+    orchestrator orchestrator;
+    orchestrator.configure(argc, argv); // Leaves operands past optind
+
+    uint16_t num_rx_workers = 0;
+    if (optind < argc) { num_rx_workers = strtoul(argv[optind], nullptr, 10); }
+    if ((optind + 1) < argc) {
+        auto value = strtoull(argv[optind + 1], nullptr, 10);
+        packets_per_leaf = (value > 0) ? value : default_packets_per_leaf;
+    }
+    orchestrator.register_cb_pcap(pcap);
+    orchestrator.register_cb_testcase(testcase);
+    orchestrator.register_cb_retcode(return_code);
+    orchestrator.set_topology(mixaddrs, topology);
+    orchestrator.set_num_rx_workers(num_rx_workers);
+
+    std::cout << "[Bench] " << num_rx_workers << " RX workers, "
+              << packets_per_leaf << " packets per leaf" << std::endl;
+    orchestrator.run();
+
+    const uint64_t num_packets = (packets_per_leaf * (num_nodes - 1));
+    if ((retcode != TEST_ERROR_NONE) || !stats_ok) {
+        std::cout << "error" << std::endl;
+        return 1;
+    }
+    uint64_t hub_rx_packets = 0;
+    for (uint16_t port = 0; port < (num_nodes - 1); port++) {
+        hub_rx_packets += hub_stats.ports[port].rx_packets;
+    }
+    const double batch = (hub_stats.rx_batches > 0) ?
+        ((double) hub_rx_packets / hub_stats.rx_batches) : 0;
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "delivered " << num_delivered << "/" << num_packets
+              << " in " << elapsed_ms << " ms ("
+              << (num_delivered * 1000.0 / elapsed_ms) << " packets/s)"
+              << std::endl << "hub: " << hub_rx_packets
+              << " packets received in " << hub_stats.rx_batches
+              << " batches (" << batch << " per batch)" << std::endl;
+    return ((num_delivered == num_packets) ? 0 : 1);
+}
@@ -0,0 +1,189 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the Mixnet course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the Mixnet project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#include "harness/networking.h"
+#include "harness/transport.h"
+#include "mixnet/packet.h"
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <poll.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+
+// Constant parameters
+static const int connect_timeout_ms = 1000;
+static const uint64_t default_num_packets = 200000;
+static const int burst_sizes[] = {1, 8, HARNESS_TRANSPORT_MAX_BURST};
+static const size_t packet_sizes[] = {64, 512, MAX_MIXNET_PACKET_SIZE};
+
+/**
+ * One link, set up the same way fragments do it: rx_fd is the client's
+ * socket, and tx_fd the server's end of the link.
+ */
+struct bench_link {
+    int listen_fd = -1;
+    int rx_fd = -1;
+    int tx_fd = -1;
+
+    ~bench_link() {
+        for (int fd : {tx_fd, rx_fd, listen_fd}) {
+            if (fd >= 0) { close(fd); }
+        }
+    }
+};
+
+static bool link_open(const struct harness_transport *transport,
+                      bench_link& link) {
+    struct sockaddr_in server_addr = {};
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    link.listen_fd = transport->listen(&server_addr, 1);
+    if (link.listen_fd < 0) { return false; }
+
+    link.rx_fd = transport->connect(&server_addr, connect_timeout_ms);
+    if (link.rx_fd < 0) { return false; }
+
+    if (transport->is_connection_oriented) {
+        int rc = 0;
+        uint16_t num_accepted = 0;
+        struct harness_accepted_state state;
+        harness_accept_with_timeout(link.listen_fd, connect_timeout_ms,
+                                    1, &num_accepted, &state, &rc);
+
+        if ((rc != 0) || (num_accepted != 1)) { return false; }
+        link.tx_fd = state.connection_fd;
+    }
+    else {
+        struct sockaddr_in client_addr;
+        if (!transport->local_addr(link.rx_fd, &client_addr)) { return false; }
+        client_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        link.tx_fd = transport->open_tx(&server_addr, &client_addr);
+    }
+    return (link.tx_fd >= 0);
+}
+
+static void wait_for(const int fd, const short events) {
+    struct pollfd pfd = {fd, events, 0};
+    poll(&pfd, 1, connect_timeout_ms);
+}
+
+/**
+ * Moves num_packets packets of the given size over the link, burst
+ * by burst (each one sent, then received, from this thread).
+ *
+ * @return Average cost per packet (in ns), or -1 on error
+ */
+static double run_bench(const struct harness_transport *transport,
+                        bench_link& link, const size_t packet_size,
+                        const int burst_size, const uint64_t num_packets) {
+    std::vector<std::vector<char>> storage(
+        burst_size, std::vector<char>(MAX_MIXNET_PACKET_SIZE, 'm'));
+
+    std::vector<void*> buffers;
+    for (auto& buffer : storage) { buffers.push_back(buffer.data()); }
+    std::vector<size_t> lengths(burst_size, packet_size);
+    std::vector<size_t> rx_lengths(burst_size);
+
+    test_error_code_t error = TEST_ERROR_NONE;
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint64_t done = 0; done < num_packets; done += burst_size) {
+        int num_sent = 0;
+        while (num_sent < burst_size) {
+            int rc = transport->send(link.tx_fd, &(buffers[num_sent]),
+                                     &(lengths[num_sent]),
+                                     (burst_size - num_sent), &error);
+            if (rc < 0) { return -1; }
+            else if (rc == 0) { wait_for(link.tx_fd, POLLOUT); }
+            num_sent += rc;
+        }
+        int num_received = 0;
+        while (num_received < burst_size) {
+            int rc = transport->recv(link.rx_fd, &(buffers[num_received]),
+                                     MAX_MIXNET_PACKET_SIZE,
+                                     &(rx_lengths[num_received]),
+                                     (burst_size - num_received), &error);
+            if (rc < 0) { return -1; }
+            else if (rc == 0) { wait_for(link.rx_fd, POLLIN); }
+            num_received += rc;
+        }
+        for (int i = 0; i < burst_size; i++) {
+            if (rx_lengths[i] != packet_size) { return -1; }
+        }
+    }
+    auto elapsed = std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - start).count();
+
+    const uint64_t num_moved = (
+        (num_packets + burst_size - 1) / burst_size) * burst_size;
+    return (elapsed / num_moved);
+}
+
+/**
+ * Compares the per-packet cost (send plus receive, over loopback) of
+ * the neighbor link transports, for a few packet and burst sizes.
+ * Usage: bench_transport [num_packets] [transport]...
+ */
+int main(int argc, char **argv) {
+    uint64_t num_packets = default_num_packets;
+    if (argc > 1) {
+        auto value = strtoull(argv[1], nullptr, 10);
+        num_packets = (value > 0) ? value : default_num_packets;
+    }
+    std::vector<enum harness_transport_enum> types;
+    for (int i = 2; i < argc; i++) {
+        enum harness_transport_enum type;
+        if (!harness_transport_from_name(argv[i], &type)) {
+            std::cout << "Unknown transport '" << argv[i] << "'" << std::endl;
+            return 1;
+        }
+        types.push_back(type);
+    }
+    if (types.empty()) {
+        for (int t = 0; t < HARNESS_TRANSPORT_COUNT; t++) {
+            auto type = static_cast<enum harness_transport_enum>(t);
+            if (harness_transport_get(type) != nullptr) {
+                types.push_back(type); // Skip those not built
+            }
+        }
+    }
+    std::cout << "[Bench] " << num_packets << " packets per run" << std::endl;
+    std::cout << std::left << std::setw(10) << "transport"
+              << std::setw(8) << "size" << std::setw(8) << "burst"
+              << "ns/packet" << std::endl;
+
+    bool ok = true;
+    for (auto type : types) {
+        const auto transport = harness_transport_get(type);
+        for (size_t packet_size : packet_sizes) {
+            for (int burst_size : burst_sizes) {
+                bench_link link;
+                double cost = (link_open(transport, link) ?
+                    run_bench(transport, link, packet_size,
+                              burst_size, num_packets) : -1);
+
+                std::cout << std::setw(10) << transport->name
+                          << std::setw(8) << packet_size
+                          << std::setw(8) << burst_size;
+                if (cost < 0) { std::cout << "error" << std::endl; ok = false; }
+                else {
+                    std::cout << std::fixed << std::setprecision(1)
+                              << cost << std::endl;
+                }
+            }
+        }
+    }
+    return (ok ? 0 : 1);
+}
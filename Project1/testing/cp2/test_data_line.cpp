@@ -0,0 +1,102 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the Mixnet course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the Mixnet project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#include "test_common.h"
+#include "harness/orchestrator.h"
+
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static int pcap_count = 0;
+static bool pcap_ok = true;
+static test_error_code_t retcode = TEST_ERROR_NONE;
+
+static const std::string data = "Hello, Mixnet!";
+static const std::vector<mixnet_address> expected_route {9, 1, 7};
+
+void pcap(orchestrator* orchestrator,
+          struct test_message_header* header,
+          struct mixnet_packet* packet) {
+    (void) orchestrator;
+
+    if (packet->type != PACKET_TYPE_DATA) { return; }
+    pcap_count++;
+
+    // Only the destination should ever output the packet
+    if (header->fragment_id != 4) { pcap_ok = false; return; }
+
+    auto rh = reinterpret_cast<mixnet_packet_routing_header*>(
+        reinterpret_cast<char*>(packet) + sizeof(mixnet_packet));
+    auto route = reinterpret_cast<mixnet_address*>(
+        reinterpret_cast<char*>(rh) + sizeof(mixnet_packet_routing_header));
+
+    // Check the source route, then the user data that follows it
+    if ((packet->src_address != 3) || (packet->dst_address != 5) ||
+        (rh->route_length != expected_route.size())) {
+        pcap_ok = false; return;
+    }
+    for (size_t i = 0; i < expected_route.size(); i++) {
+        if (route[i] != expected_route[i]) { pcap_ok = false; }
+    }
+    auto payload = reinterpret_cast<char*>(route + rh->route_length);
+    if ((packet->payload_size != (sizeof(mixnet_packet_routing_header) +
+            (sizeof(mixnet_address) * rh->route_length) + data.size())) ||
+        (memcmp(payload, data.c_str(), data.size()) != 0)) {
+        pcap_ok = false;
+    }
+}
+
+/**
+ * This test-case exercises a line topology with 5 Mixnet nodes. We
+ * subscribe to packet updates from every node, then send DATA packets
+ * from one end of the line to the other. We'd expect to see each one
+ * appear (only) at the destination, carrying the full source route.
+ */
+void testcase(orchestrator* orchestrator) {
+    sleep(5); // Wait for routing convergence
+    auto error_code = TEST_ERROR_NONE;
+
+    // Get packets from all nodes
+    for (uint16_t i = 0; i < 5; i++) {
+        DIE_ON_ERROR(orchestrator->pcap_change_subscription(i, true));
+    }
+    for (size_t t = 0; t < 3; t++) {
+        DIE_ON_ERROR(orchestrator->send_packet(
+            0, 4, PACKET_TYPE_DATA, data));
+    }
+    sleep(5); // Wait for packets to propagate
+}
+
+void return_code(test_error_code_t value) {
+    retcode = value;
+}
+
+int main(int argc, char **argv) {
+    std::vector<std::vector<mixnet_address>> topology;
+    std::vector<mixnet_address> mixaddrs {3, 9, 1, 7, 5};
+    create_line_topology(5, topology);
+
+    orchestrator orchestrator;
+    orchestrator.configure(argc, argv);
+    orchestrator.register_cb_pcap(pcap);
+    orchestrator.register_cb_testcase(testcase);
+    orchestrator.register_cb_retcode(return_code);
+    orchestrator.set_topology(mixaddrs, topology);
+
+    std::cout << "[Test] Starting test_data_line..." << std::endl;
+    orchestrator.run();
+    std::cout << ((retcode == TEST_ERROR_NONE) ?
+        "Nodes returned OK" : "Nodes returned error") << std::endl;
+
+    std::cout << ((pcap_ok && (pcap_count == 3)) ?
+                  "PASS" : "FAIL") << std::endl;
+}
@@ -0,0 +1,103 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the Mixnet course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the Mixnet project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#include "test_common.h"
+#include "harness/orchestrator.h"
+
+#include <iostream>
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+
+static bool pcap_ok = true;
+static std::vector<mixnet_address> first_hops;
+static test_error_code_t retcode = TEST_ERROR_NONE;
+
+void pcap(orchestrator* orchestrator,
+          struct test_message_header* header,
+          struct mixnet_packet* packet) {
+    (void) orchestrator;
+
+    if (packet->type != PACKET_TYPE_DATA) { return; }
+    auto rh = reinterpret_cast<mixnet_packet_routing_header*>(
+        reinterpret_cast<char*>(packet) + sizeof(mixnet_packet));
+    auto route = reinterpret_cast<mixnet_address*>(
+        reinterpret_cast<char*>(rh) + sizeof(mixnet_packet_routing_header));
+
+    // Either way around the ring, the route has two hops
+    if ((header->fragment_id != 3) || (rh->route_length != 2)) {
+        pcap_ok = false; return;
+    }
+    pcap_ok &= (((route[0] == 15) && (route[1] == 25)) ||
+                ((route[0] == 20) && (route[1] == 30)));
+    first_hops.push_back(route[0]);
+}
+
+/**
+ * This test-case checks whether routes are updated when links fail
+ * and recover. On a ring of 6 nodes, node 0 sends DATA to node 3 via
+ * the lower-addressed side, then via the other side once a link on
+ * that path goes down, and finally via the original path again.
+ */
+void testcase(orchestrator* orchestrator) {
+    sleep(5); // Wait for routing convergence
+    auto error_code = TEST_ERROR_NONE;
+
+    DIE_ON_ERROR(orchestrator->pcap_change_subscription(3, true));
+    for (size_t t = 0; t < 3; t++) {
+        DIE_ON_ERROR(orchestrator->send_packet(0, 3, PACKET_TYPE_DATA));
+    }
+    sleep(2); // Wait for packets to propagate
+
+    // Disconnect a link on the preferred path
+    DIE_ON_ERROR(orchestrator->change_link_state(4, 5, false));
+    sleep(2); // Wait for routing re-convergence
+
+    for (size_t t = 0; t < 3; t++) {
+        DIE_ON_ERROR(orchestrator->send_packet(0, 3, PACKET_TYPE_DATA));
+    }
+    sleep(2); // Wait for packets to propagate
+
+    // Restore the link
+    DIE_ON_ERROR(orchestrator->change_link_state(4, 5, true));
+    sleep(2); // Wait for routing re-convergence
+
+    for (size_t t = 0; t < 3; t++) {
+        DIE_ON_ERROR(orchestrator->send_packet(0, 3, PACKET_TYPE_DATA));
+    }
+    sleep(2); // Wait for packets to propagate
+}
+
+void return_code(test_error_code_t value) {
+    retcode = value;
+}
+
+int main(int argc, char **argv) {
+    std::vector<std::vector<mixnet_address>> topology;
+    std::vector<mixnet_address> mixaddrs {10, 20, 30, 40, 25, 15};
+    create_ring_topology(6, topology);
+
+    orchestrator orchestrator;
+    orchestrator.configure(argc, argv);
+    orchestrator.register_cb_pcap(pcap);
+    orchestrator.register_cb_testcase(testcase);
+    orchestrator.register_cb_retcode(return_code);
+    orchestrator.set_topology(mixaddrs, topology);
+
+    std::cout << "[Test] Starting test_data_link_failure..." << std::endl;
+    orchestrator.run();
+    std::cout << ((retcode == TEST_ERROR_NONE) ?
+        "Nodes returned OK" : "Nodes returned error") << std::endl;
+
+    const std::vector<mixnet_address> expected {
+        15, 15, 15, 20, 20, 20, 15, 15, 15};
+    std::cout << ((pcap_ok && (first_hops == expected)) ?
+                  "PASS" : "FAIL") << std::endl;
+}
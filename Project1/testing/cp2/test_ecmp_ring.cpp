@@ -0,0 +1,108 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the Mixnet course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the Mixnet project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#include "test_common.h"
+#include "harness/orchestrator.h"
+
+#include <iostream>
+#include <map>
+#include <set>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+
+static int pcap_count = 0;
+static bool pcap_ok = true;
+static test_error_code_t retcode = TEST_ERROR_NONE;
+
+static const size_t num_flows = 16;
+static const size_t packets_per_flow = 2;
+static std::map<std::string, std::set<mixnet_address>> flow_first_hops;
+
+void pcap(orchestrator* orchestrator,
+          struct test_message_header* header,
+          struct mixnet_packet* packet) {
+    (void) orchestrator;
+
+    if (packet->type != PACKET_TYPE_DATA) { return; }
+    pcap_count++;
+
+    // Only the destination should ever output the packet
+    if (header->fragment_id != 2) { pcap_ok = false; return; }
+
+    auto rh = reinterpret_cast<mixnet_packet_routing_header*>(
+        reinterpret_cast<char*>(packet) + sizeof(mixnet_packet));
+    auto route = reinterpret_cast<mixnet_address*>(
+        reinterpret_cast<char*>(rh) + sizeof(mixnet_packet_routing_header));
+
+    // Both routes around the ring are 2 hops long
+    if (rh->route_length != 1) { pcap_ok = false; return; }
+    auto payload = reinterpret_cast<char*>(route + rh->route_length);
+    std::string data(payload, packet->payload_size - (
+        sizeof(mixnet_packet_routing_header) + sizeof(mixnet_address)));
+
+    flow_first_hops[data].insert(route[0]);
+}
+
+/**
+ * This test-case exercises a ring topology with 4 Mixnet nodes doing
+ * ECMP. We send several DATA flows (each with distinct data) between
+ * opposite nodes on the ring. Every packet of a flow should take the
+ * same route, and the flows as a whole should use both routes.
+ */
+void testcase(orchestrator* orchestrator) {
+    sleep(5); // Wait for routing convergence
+    auto error_code = TEST_ERROR_NONE;
+
+    // Get packets from all nodes
+    for (uint16_t i = 0; i < 4; i++) {
+        DIE_ON_ERROR(orchestrator->pcap_change_subscription(i, true));
+    }
+    for (size_t t = 0; t < packets_per_flow; t++) {
+        for (size_t f = 0; f < num_flows; f++) {
+            DIE_ON_ERROR(orchestrator->send_packet(
+                0, 2, PACKET_TYPE_DATA, std::to_string(f) + ": Hi!"));
+        }
+    }
+    sleep(5); // Wait for packets to propagate
+}
+
+void return_code(test_error_code_t value) {
+    retcode = value;
+}
+
+int main(int argc, char **argv) {
+    std::vector<std::vector<mixnet_address>> topology;
+    std::vector<mixnet_address> mixaddrs {11, 31, 21, 41};
+    create_ring_topology(4, topology);
+
+    orchestrator orchestrator;
+    orchestrator.configure(argc, argv);
+    orchestrator.register_cb_pcap(pcap);
+    orchestrator.register_cb_testcase(testcase);
+    orchestrator.register_cb_retcode(return_code);
+    orchestrator.set_topology(mixaddrs, topology);
+    orchestrator.set_use_ecmp(true);
+
+    std::cout << "[Test] Starting test_ecmp_ring..." << std::endl;
+    orchestrator.run();
+    std::cout << ((retcode == TEST_ERROR_NONE) ?
+        "Nodes returned OK" : "Nodes returned error") << std::endl;
+
+    std::set<mixnet_address> first_hops;
+    for (const auto& flow : flow_first_hops) {
+        pcap_ok &= (flow.second.size() == 1); // Per-flow order
+        first_hops.insert(*flow.second.begin());
+    }
+    std::cout << (((pcap_count == (num_flows * packets_per_flow)) &&
+                   (flow_first_hops.size() == num_flows) &&
+                   (first_hops.size() == 2) && pcap_ok) ?
+                  "PASS" : "FAIL") << std::endl;
+}
@@ -0,0 +1,210 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the Mixnet course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the Mixnet project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+extern "C" {
+#include "mixnet/connection.h"
+}
+#include "mixnet/config.h"
+#include "mixnet/mixer.h"
+#include "mixnet/ports.h"
+#include "mixnet/routing.h"
+#include "mixnet/stats.h"
+#include "mixnet/txq.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * Stub connection: links are up unless marked down, and every packet
+ * sent is logged (with its route) instead.
+ */
+struct sent_packet {
+    uint8_t port;
+    std::vector<mixnet_address> route;
+    uint16_t hop_index;
+    std::string data;
+};
+static std::vector<sent_packet> sent;
+static bool link_up[2] = {true, true};
+static struct mixnet_stats stats;
+
+static mixnet_packet_routing_header *routing_header(mixnet_packet *packet) {
+    return reinterpret_cast<mixnet_packet_routing_header*>(packet + 1);
+}
+static mixnet_address *route_of(mixnet_packet *packet) {
+    return reinterpret_cast<mixnet_address*>(routing_header(packet) + 1);
+}
+
+extern "C" {
+mixnet_packet *mixnet_packet_alloc(void *, const size_t size) {
+    return static_cast<mixnet_packet*>(malloc(size));
+}
+
+void mixnet_packet_free(void *, mixnet_packet *packet) { free(packet); }
+
+bool mixnet_link_is_up(void *, const uint8_t port) {
+    return ((port >= 2) || link_up[port]);
+}
+
+int mixnet_send(void *handle, const uint8_t port, mixnet_packet *packet) {
+    const mixnet_packet_routing_header *rh = routing_header(packet);
+    const mixnet_address *route = route_of(packet);
+    const size_t data_size = (packet->payload_size -
+        sizeof(mixnet_packet_routing_header) -
+        (sizeof(mixnet_address) * rh->route_length));
+
+    sent.push_back({port, {route, route + rh->route_length}, rh->hop_index,
+                    {reinterpret_cast<const char*>(route + rh->route_length),
+                     data_size}});
+    mixnet_packet_free(handle, packet);
+    return 1;
+}
+
+struct mixnet_stats *mixnet_get_stats(void *) { return &stats; }
+
+// Not reached by the data path under test
+int mixnet_send_batch(void *, const uint8_t, mixnet_packet **, const int) {
+    return -1;
+}
+int mixnet_send_multi(void *, const uint64_t, mixnet_packet *, uint64_t *) {
+    return -1;
+}
+void mixnet_watch_writable(void *, const uint64_t) {}
+int mixnet_recv_batch_timeout(void *, uint8_t *, mixnet_packet **,
+                              const int, const int) { return -1; }
+
+// Data path (see node.c)
+void route_user_packet(void *handle, struct tx_queues *txq,
+                       const struct mixnet_node_config config,
+                       const struct fib_snapshot *fib, uint64_t *rng_state,
+                       const struct port_index *neighbors,
+                       port_mask_t link_ports, struct mixer *mixer,
+                       mixnet_packet *packet);
+void forward_routed_packet(void *handle, struct tx_queues *txq,
+                           const struct mixnet_node_config config,
+                           const struct fib_snapshot *fib,
+                           const struct port_index *neighbors,
+                           port_mask_t link_ports, struct mixer *mixer,
+                           mixnet_packet *packet);
+}
+
+static const std::string data = "repair me";
+
+// A DATA packet as the user hands it over (see mixnet_recv)
+static mixnet_packet *make_user_packet(const mixnet_address src_address,
+                                       const mixnet_address dst_address) {
+    mixnet_packet *packet = mixnet_packet_alloc(nullptr,
+                                                MAX_MIXNET_PACKET_SIZE);
+    packet->src_address = src_address;
+    packet->dst_address = dst_address;
+    packet->type = PACKET_TYPE_DATA;
+    packet->payload_size = (uint16_t) data.size();
+    routing_header(packet)->route_length = 0;
+    routing_header(packet)->hop_index = 0;
+    memcpy(route_of(packet), data.data(), data.size());
+    return packet;
+}
+
+// A DATA packet in transit, along the given route
+static mixnet_packet *make_routed_packet(
+    const mixnet_address src_address, const mixnet_address dst_address,
+    const std::vector<mixnet_address>& route) {
+    const size_t route_size = sizeof(mixnet_address) * route.size();
+    mixnet_packet *packet = make_user_packet(src_address, dst_address);
+    routing_header(packet)->route_length = (uint16_t) route.size();
+    memcpy(route_of(packet), route.data(), route_size);
+    memcpy(reinterpret_cast<char*>(route_of(packet)) + route_size,
+           data.data(), data.size());
+    packet->payload_size = (uint16_t) (sizeof(mixnet_packet_routing_header) +
+                                       route_size + data.size());
+    return packet;
+}
+
+/**
+ * This test-case exercises local repair in the data path, as seen by
+ * node 15 on a ring of 6 nodes (10 - 20 - 30 - 40 - 25 - 15). The link
+ * from 15 to 25 fails, but no LSA has been exchanged yet, so the FIB
+ * still routes to 40 via 25. We'd expect DATA from the user to leave
+ * along the loop-free alternate (via 10), and DATA in transit to have
+ * its route repaired on the spot (keeping the hop it already took).
+ * Once the link to 10 is known to be down too, DATA is dropped (and
+ * counted) instead.
+ */
+int main() {
+    std::cout << "[Test] Starting test_local_repair..." << std::endl;
+
+    const mixnet_address neighbor_addrs[] = {10, 25};
+    const mixnet_address adjacencies[][2] = {
+        {20, 15}, {10, 30}, {20, 40}, {30, 25}, {40, 15}, {10, 25}};
+    const mixnet_address addrs[] = {10, 20, 30, 40, 25, 15};
+
+    struct port_index index;
+    port_index_init(&index, 2, neighbor_addrs);
+
+    struct routing_state rs;
+    bool ok = routing_init(&rs, 15, 2, neighbor_addrs, &index);
+    if (!ok) { std::cout << "FAIL" << std::endl; return 0; }
+    for (size_t i = 0; i < 6; i++) {
+        ok &= routing_update(&rs, addrs[i], 1, 2, adjacencies[i], 0);
+    }
+    struct fib_snapshot *fib = fib_snapshot_create(&rs);
+    ok &= (fib != nullptr) && (fib_snapshot_lookup(fib, 40) != nullptr) &&
+          (fib_snapshot_lookup(fib, 40)->port == 1);
+
+    struct mixnet_node_config config;
+    memset(&config, 0, sizeof(config));
+    config.node_addr = 15;
+    config.num_neighbors = 2;
+    config.neighbor_addrs = const_cast<mixnet_address*>(neighbor_addrs);
+    config.mixing_factor = 1;
+
+    tx_queues txq;
+    struct mixer mixer;
+    ok &= txq_init(&txq, 2) && mixer_init(&mixer, 1, 1);
+    if (!ok) { std::cout << "FAIL" << std::endl; return 0; }
+
+    uint64_t rng_state = 1;
+    const port_mask_t link_ports = port_mask_all(2); // Not yet polled
+    link_up[1] = false;
+
+    // The user's DATA leaves along the alternate
+    route_user_packet(nullptr, &txq, config, fib, &rng_state, &index,
+                      link_ports, &mixer, make_user_packet(15, 40));
+    ok &= (sent.size() == 1) && (sent[0].port == 0) &&
+          (sent[0].route == std::vector<mixnet_address>({10, 20, 30})) &&
+          (sent[0].hop_index == 0) && (sent[0].data == data);
+
+    // DATA from 10 (on its way to 40 via 15 and 25) turns back
+    forward_routed_packet(nullptr, &txq, config, fib, &index, link_ports,
+                          &mixer, make_routed_packet(10, 40, {15, 25}));
+    ok &= (sent.size() == 2) && (sent[1].port == 0) &&
+          (sent[1].route == std::vector<mixnet_address>({15, 10, 20, 30})) &&
+          (sent[1].hop_index == 1) && (sent[1].data == data);
+
+    // Had the link to 10 failed (and been polled) earlier, there is no
+    // alternate, so both are dropped
+    link_up[0] = false;
+    route_user_packet(nullptr, &txq, config, fib, &rng_state, &index,
+                      port_mask_bit(1), &mixer, make_user_packet(15, 40));
+    forward_routed_packet(nullptr, &txq, config, fib, &index,
+                          port_mask_bit(1), &mixer,
+                          make_routed_packet(10, 40, {15, 25}));
+    ok &= (sent.size() == 2) &&
+          (stats.drops[MIXNET_DROP_NO_ROUTE] == 2);
+
+    mixer_destroy(nullptr, &mixer);
+    txq_destroy(nullptr, &txq);
+    fib_snapshot_free(fib);
+    routing_destroy(&rs);
+    std::cout << (ok ? "PASS" : "FAIL") << std::endl;
+}
@@ -0,0 +1,61 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the Mixnet course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the Mixnet project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#include "mixnet/ports.h"
+#include "mixnet/routing.h"
+
+#include <iostream>
+
+static const uint32_t max_age_ms = 90000;
+
+/**
+ * This test-case exercises LSA aging on a line topology (1 - 2 - 3),
+ * as seen by node 1. Node 3 stops refreshing its LSA, so its adjacency
+ * expires. A neighbor then re-syncs node 3's last LSA (e.g., because
+ * a link came up): since that is the same (stale) LSA, we'd expect it
+ * to be ignored. Only a newer LSA from node 3 re-installs the route.
+ */
+int main() {
+    std::cout << "[Test] Starting test_lsdb_resync..." << std::endl;
+
+    const mixnet_address neighbor_addrs[] = {2};
+    const mixnet_address adjacency_1[] = {2};
+    const mixnet_address adjacency_2[] = {1, 3};
+    const mixnet_address adjacency_3[] = {2};
+
+    struct port_index index;
+    port_index_init(&index, 1, neighbor_addrs);
+
+    struct routing_state rs;
+    bool ok = routing_init(&rs, 1, 1, neighbor_addrs, &index);
+    if (!ok) { std::cout << "FAIL" << std::endl; return 0; }
+
+    ok &= routing_update(&rs, 1, 1, 1, adjacency_1, 0);
+    ok &= routing_update(&rs, 2, 1, 2, adjacency_2, 0);
+    ok &= routing_update(&rs, 3, 1, 1, adjacency_3, 0);
+    ok &= (fib_lookup(&rs, 3) != nullptr);
+
+    // Node 2 keeps refreshing its LSA, node 3 does not
+    ok &= routing_update(&rs, 2, 2, 2, adjacency_2, 60000);
+    ok &= (routing_expire(&rs, 100000, max_age_ms) == 1);
+    ok &= (fib_lookup(&rs, 3) == nullptr);
+
+    // A re-sync of the expired LSA changes nothing
+    ok &= !routing_update(&rs, 3, 1, 1, adjacency_3, 101000);
+    ok &= (lsdb_find(&(rs.lsdb), 3)->neighbor_count == 0);
+    ok &= (fib_lookup(&rs, 3) == nullptr);
+
+    // Node 3's next refresh brings it back
+    ok &= routing_update(&rs, 3, 2, 1, adjacency_3, 102000);
+    ok &= (fib_lookup(&rs, 3) != nullptr);
+
+    routing_destroy(&rs);
+    std::cout << (ok ? "PASS" : "FAIL") << std::endl;
+}
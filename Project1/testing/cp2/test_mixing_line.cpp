@@ -0,0 +1,115 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the Mixnet course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the Mixnet project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#include "test_common.h"
+#include "harness/orchestrator.h"
+
+#include <atomic>
+#include <iostream>
+#include <set>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+
+static bool pcap_ok = true;
+static std::set<std::string> payloads;
+static std::atomic<int> pcap_count(0);
+static int pcap_count_before_batch = -1;
+static std::atomic<int> flood_counts[3];
+static int flood_counts_before_batch[3] = {-1, -1, -1};
+static test_error_code_t retcode = TEST_ERROR_NONE;
+
+void pcap(orchestrator* orchestrator,
+          struct test_message_header* header,
+          struct mixnet_packet* packet) {
+    (void) orchestrator;
+
+    if (packet->type == PACKET_TYPE_FLOOD) {
+        if (header->fragment_id >= 3) { pcap_ok = false; return; }
+        flood_counts[header->fragment_id]++;
+        return;
+    }
+    if (packet->type != PACKET_TYPE_DATA) { return; }
+    if (header->fragment_id != 2) { pcap_ok = false; return; }
+
+    auto rh = reinterpret_cast<mixnet_packet_routing_header*>(
+        reinterpret_cast<char*>(packet) + sizeof(mixnet_packet));
+    auto payload = (reinterpret_cast<char*>(rh) +
+        sizeof(mixnet_packet_routing_header) +
+        (sizeof(mixnet_address) * rh->route_length));
+
+    payloads.insert(std::string(payload, 1));
+    pcap_count++;
+}
+
+/**
+ * This test-case checks that a node honors its mixing factor. The
+ * middle node of a 3-node line mixes batches of 4 packets, so none
+ * of the first 3 DATA packets should reach the destination until
+ * the 4th one is sent, at which point all 4 should be delivered.
+ * FLOODs are mixed too: the middle node buffers each one twice (to
+ * forward it, and to deliver it locally), so the first FLOOD should
+ * reach neither of them until a second one fills the batch.
+ */
+void testcase(orchestrator* orchestrator) {
+    sleep(5); // Wait for routing convergence
+    auto error_code = TEST_ERROR_NONE;
+
+    DIE_ON_ERROR(orchestrator->pcap_change_subscription(2, true));
+    for (size_t t = 0; t < 3; t++) {
+        DIE_ON_ERROR(orchestrator->send_packet(
+            0, 2, PACKET_TYPE_DATA, std::to_string(t)));
+    }
+    sleep(2); // Wait for packets to propagate
+    pcap_count_before_batch = pcap_count;
+
+    DIE_ON_ERROR(orchestrator->send_packet(0, 2, PACKET_TYPE_DATA, "3"));
+    sleep(2); // Wait for packets to propagate
+
+    DIE_ON_ERROR(orchestrator->pcap_change_subscription(1, true));
+    DIE_ON_ERROR(orchestrator->send_packet(0, 0, PACKET_TYPE_FLOOD));
+    sleep(2); // Wait for packets to propagate
+    for (size_t i = 0; i < 3; i++) {
+        flood_counts_before_batch[i] = flood_counts[i];
+    }
+    DIE_ON_ERROR(orchestrator->send_packet(0, 0, PACKET_TYPE_FLOOD));
+    sleep(2); // Wait for packets to propagate
+}
+
+void return_code(test_error_code_t value) {
+    retcode = value;
+}
+
+int main(int argc, char **argv) {
+    std::vector<mixnet_address> mixaddrs {4, 8, 2};
+    std::vector<std::vector<mixnet_address>> topology;
+    create_line_topology(3, topology);
+
+    orchestrator orchestrator;
+    orchestrator.configure(argc, argv);
+    orchestrator.register_cb_pcap(pcap);
+    orchestrator.register_cb_testcase(testcase);
+    orchestrator.register_cb_retcode(return_code);
+    orchestrator.set_topology(mixaddrs, topology);
+    orchestrator.set_mixing_factor(1, 4);
+
+    std::cout << "[Test] Starting test_mixing_line..." << std::endl;
+    orchestrator.run();
+    std::cout << ((retcode == TEST_ERROR_NONE) ?
+        "Nodes returned OK" : "Nodes returned error") << std::endl;
+
+    const std::set<std::string> expected {"0", "1", "2", "3"};
+    const bool floods_ok = ((flood_counts_before_batch[1] == 0) &&
+                            (flood_counts_before_batch[2] == 0) &&
+                            (flood_counts[1] == 2) && (flood_counts[2] == 2));
+    std::cout << ((pcap_ok && (pcap_count_before_batch == 0) &&
+                   (pcap_count == 4) && (payloads == expected) &&
+                   floods_ok) ? "PASS" : "FAIL") << std::endl;
+}
@@ -0,0 +1,94 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the Mixnet course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the Mixnet project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#include "test_common.h"
+#include "harness/orchestrator.h"
+
+#include <iostream>
+#include <stdlib.h>
+#include <unistd.h>
+
+static int num_requests = 0;
+static int num_responses = 0;
+static bool pcap_ok = true;
+static test_error_code_t retcode = TEST_ERROR_NONE;
+
+void pcap(orchestrator* orchestrator,
+          struct test_message_header* header,
+          struct mixnet_packet* packet) {
+    (void) orchestrator;
+
+    if (packet->type != PACKET_TYPE_PING) { return; }
+    auto rh = reinterpret_cast<mixnet_packet_routing_header*>(
+        reinterpret_cast<char*>(packet) + sizeof(mixnet_packet));
+    auto route = reinterpret_cast<mixnet_address*>(
+        reinterpret_cast<char*>(rh) + sizeof(mixnet_packet_routing_header));
+    auto ping = reinterpret_cast<mixnet_packet_ping*>(
+        route + rh->route_length);
+
+    // Both paths around the ring are 3 hops long; the tie is broken
+    // towards lower addresses, so the request must go via 15 and 25.
+    if (rh->route_length != 2) { pcap_ok = false; return; }
+    if (ping->ping_direction == 0) {
+        num_requests++;
+        pcap_ok &= ((header->fragment_id == 3) &&
+                    (route[0] == 15) && (route[1] == 25));
+    }
+    else {
+        num_responses++;
+        pcap_ok &= ((header->fragment_id == 0) &&
+                    (route[0] == 25) && (route[1] == 15));
+    }
+}
+
+/**
+ * This test-case exercises a ring topology with 6 Mixnet nodes. We
+ * subscribe to packet updates from every node, then PING the node
+ * on the opposite side of the ring. The destination should output
+ * the request, and the source should output the response.
+ */
+void testcase(orchestrator* orchestrator) {
+    sleep(5); // Wait for routing convergence
+    auto error_code = TEST_ERROR_NONE;
+
+    // Get packets from all nodes
+    for (uint16_t i = 0; i < 6; i++) {
+        DIE_ON_ERROR(orchestrator->pcap_change_subscription(i, true));
+    }
+    for (size_t t = 0; t < 2; t++) {
+        DIE_ON_ERROR(orchestrator->send_packet(0, 3, PACKET_TYPE_PING));
+    }
+    sleep(5); // Wait for packets to propagate
+}
+
+void return_code(test_error_code_t value) {
+    retcode = value;
+}
+
+int main(int argc, char **argv) {
+    std::vector<std::vector<mixnet_address>> topology;
+    std::vector<mixnet_address> mixaddrs {10, 20, 30, 40, 25, 15};
+    create_ring_topology(6, topology);
+
+    orchestrator orchestrator;
+    orchestrator.configure(argc, argv);
+    orchestrator.register_cb_pcap(pcap);
+    orchestrator.register_cb_testcase(testcase);
+    orchestrator.register_cb_retcode(return_code);
+    orchestrator.set_topology(mixaddrs, topology);
+
+    std::cout << "[Test] Starting test_ping_ring..." << std::endl;
+    orchestrator.run();
+    std::cout << ((retcode == TEST_ERROR_NONE) ?
+        "Nodes returned OK" : "Nodes returned error") << std::endl;
+
+    std::cout << ((pcap_ok && (num_requests == 2) &&
+                   (num_responses == 2)) ? "PASS" : "FAIL") << std::endl;
+}
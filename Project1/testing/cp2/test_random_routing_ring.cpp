@@ -0,0 +1,87 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the Mixnet course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the Mixnet project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#include "test_common.h"
+#include "harness/orchestrator.h"
+
+#include <iostream>
+#include <stdlib.h>
+#include <unistd.h>
+
+static int pcap_count = 0;
+static int num_via_low = 0;
+static int num_via_high = 0;
+static bool pcap_ok = true;
+static test_error_code_t retcode = TEST_ERROR_NONE;
+
+void pcap(orchestrator* orchestrator,
+          struct test_message_header* header,
+          struct mixnet_packet* packet) {
+    (void) orchestrator;
+
+    if (packet->type != PACKET_TYPE_DATA) { return; }
+    pcap_count++;
+
+    auto rh = reinterpret_cast<mixnet_packet_routing_header*>(
+        reinterpret_cast<char*>(packet) + sizeof(mixnet_packet));
+    auto route = reinterpret_cast<mixnet_address*>(
+        reinterpret_cast<char*>(rh) + sizeof(mixnet_packet_routing_header));
+
+    // The only loop-free routes are the two ways around the ring
+    if ((header->fragment_id != 3) || (rh->route_length != 2)) {
+        pcap_ok = false; return;
+    }
+    if ((route[0] == 15) && (route[1] == 25)) { num_via_low++; }
+    else if ((route[0] == 20) && (route[1] == 30)) { num_via_high++; }
+    else { pcap_ok = false; }
+}
+
+/**
+ * This test-case checks random routing on a ring of 6 nodes. Node 0
+ * sends DATA packets to the node on the opposite side of the ring.
+ * Every packet should arrive via one of the two loop-free routes,
+ * and (with overwhelming probability) both should be used.
+ */
+void testcase(orchestrator* orchestrator) {
+    sleep(5); // Wait for routing convergence
+    auto error_code = TEST_ERROR_NONE;
+
+    DIE_ON_ERROR(orchestrator->pcap_change_subscription(3, true));
+    for (size_t t = 0; t < 32; t++) {
+        DIE_ON_ERROR(orchestrator->send_packet(0, 3, PACKET_TYPE_DATA));
+    }
+    sleep(5); // Wait for packets to propagate
+}
+
+void return_code(test_error_code_t value) {
+    retcode = value;
+}
+
+int main(int argc, char **argv) {
+    std::vector<std::vector<mixnet_address>> topology;
+    std::vector<mixnet_address> mixaddrs {10, 20, 30, 40, 25, 15};
+    create_ring_topology(6, topology);
+
+    orchestrator orchestrator;
+    orchestrator.configure(argc, argv);
+    orchestrator.register_cb_pcap(pcap);
+    orchestrator.register_cb_testcase(testcase);
+    orchestrator.register_cb_retcode(return_code);
+    orchestrator.set_topology(mixaddrs, topology);
+    orchestrator.set_use_random_routing(0, true);
+
+    std::cout << "[Test] Starting test_random_routing_ring..." << std::endl;
+    orchestrator.run();
+    std::cout << ((retcode == TEST_ERROR_NONE) ?
+        "Nodes returned OK" : "Nodes returned error") << std::endl;
+
+    std::cout << ((pcap_ok && (pcap_count == 32) && (num_via_low > 0) &&
+                   (num_via_high > 0)) ? "PASS" : "FAIL") << std::endl;
+}
@@ -0,0 +1,118 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the Mixnet course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the Mixnet project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#include "test_common.h"
+#include "harness/orchestrator.h"
+
+#include <iostream>
+#include <stdlib.h>
+#include <unistd.h>
+
+static bool stats_ok = false;
+static test_error_code_t retcode = TEST_ERROR_NONE;
+
+static const uint16_t num_nodes = 3;
+static const uint64_t num_floods = 4;
+static const uint64_t num_data = 2;
+
+void pcap(orchestrator* orchestrator,
+          struct test_message_header* header,
+          struct mixnet_packet* packet) {
+    (void) orchestrator;
+    (void) header;
+    (void) packet;
+}
+
+static bool check_stats(const std::vector<struct mixnet_stats>& stats) {
+    bool ok = (stats.size() == num_nodes);
+    uint16_t num_converged = 0;
+    uint64_t reserved_bytes = 0;
+
+    for (size_t i = 0; ok && (i < stats.size()); i++) {
+        const auto& s = stats[i];
+        // Every node sees each packet exactly once (the source from
+        // its user port, the others from the upstream neighbor).
+        ok &= (s.types[PACKET_TYPE_FLOOD].rx_packets == num_floods);
+        ok &= (s.types[PACKET_TYPE_DATA].rx_packets == num_data);
+        ok &= (s.drops[MIXNET_DROP_NO_ROUTE] == 0);
+        ok &= (s.drops[MIXNET_DROP_MISROUTED] == 0);
+        ok &= ((s.tx_overflows == 0) && (s.tx_queue_depth == 0));
+
+        // Every packet buffer came from (and went back to) the pool
+        ok &= ((s.pkt_allocs >= s.pkt_frees) && (s.pkt_peak_live > 0));
+        reserved_bytes += s.pkt_reserved_bytes;
+
+        if (s.stp_num_convergences != 0) {
+            num_converged++;
+            ok &= (s.stp_converged_us >= s.stp_changed_us);
+        }
+    }
+    // Nodes sharing a process may reuse each other's slabs, but some
+    // node must have reserved the memory its buffers came from.
+    ok &= (reserved_bytes > 0);
+
+    // Every node but the root records convergence
+    ok &= (num_converged >= (num_nodes - 1));
+
+    // The middle node outputs the FLOODs, the last one everything
+    if (ok) {
+        ok &= (stats[0].ports[1].tx_packets == 0);
+        ok &= (stats[1].ports[2].tx_packets == num_floods);
+        ok &= (stats[2].ports[1].tx_packets == (num_floods + num_data));
+    }
+    return ok;
+}
+
+/**
+ * This test-case exercises a line topology with 3 Mixnet nodes. We
+ * send a few FLOOD and DATA packets from one end of the line, then
+ * collect every node's counters. We'd expect each node to count each
+ * packet exactly once, and no routing drops.
+ */
+void testcase(orchestrator* orchestrator) {
+    sleep(5); // Wait for routing convergence
+    auto error_code = TEST_ERROR_NONE;
+
+    for (size_t t = 0; t < num_floods; t++) {
+        DIE_ON_ERROR(orchestrator->send_packet(0, 0, PACKET_TYPE_FLOOD));
+    }
+    for (size_t t = 0; t < num_data; t++) {
+        DIE_ON_ERROR(orchestrator->send_packet(0, 2, PACKET_TYPE_DATA));
+    }
+    sleep(5); // Wait for packets to propagate
+
+    std::vector<struct mixnet_stats> stats;
+    DIE_ON_ERROR(orchestrator->collect_stats(stats));
+    stats_ok = check_stats(stats);
+}
+
+void return_code(test_error_code_t value) {
+    retcode = value;
+}
+
+int main(int argc, char **argv) {
+    std::vector<std::vector<mixnet_address>> topology;
+    std::vector<mixnet_address> mixaddrs {12, 7, 30};
+    create_line_topology(num_nodes, topology);
+
+    orchestrator orchestrator;
+    orchestrator.configure(argc, argv);
+    orchestrator.register_cb_pcap(pcap);
+    orchestrator.register_cb_testcase(testcase);
+    orchestrator.register_cb_retcode(return_code);
+    orchestrator.set_topology(mixaddrs, topology);
+
+    std::cout << "[Test] Starting test_stats_line..." << std::endl;
+    orchestrator.run();
+    std::cout << ((retcode == TEST_ERROR_NONE) ?
+        "Nodes returned OK" : "Nodes returned error") << std::endl;
+
+    std::cout << (stats_ok ? "PASS" : "FAIL") << std::endl;
+}
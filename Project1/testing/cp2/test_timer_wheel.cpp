@@ -0,0 +1,100 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the Mixnet course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the Mixnet project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#include "mixnet/timer.h"
+
+#include <iostream>
+#include <vector>
+
+// Last tick the wheel can represent (later deadlines are clamped)
+static const uint64_t max_tick = (
+    (UINT64_C(1) << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1);
+
+static uint64_t ms(const uint64_t value) { return (value * 1000); }
+
+// Advances the wheel, then pops every expired timer (in order)
+static std::vector<node_timer*> advance(timer_wheel *wheel,
+                                        const uint64_t now_us) {
+    std::vector<node_timer*> expired;
+    timer_wheel_advance(wheel, now_us);
+    node_timer *timer = nullptr;
+    while ((timer = timer_wheel_next_expired(wheel)) != nullptr) {
+        expired.push_back(timer);
+    }
+    return expired;
+}
+
+/**
+ * This test-case exercises the hierarchical timer wheel on its own.
+ * Timers are armed on either side of the level boundaries (63/64 ms,
+ * and 4095/4096 ms), so they are cascaded before expiring. We cancel
+ * the only timer in a slot, re-arm it, and advance in large jumps; we
+ * expect timers to expire in deadline order, never early, and the
+ * wheel to report when it next needs to be advanced. Deadlines past
+ * the wheel's range are clamped to its last tick.
+ */
+int main() {
+    std::cout << "[Test] Starting test_timer_wheel..." << std::endl;
+
+    bool ok = true;
+    static timer_wheel wheel;
+    timer_wheel_init(&wheel, 0);
+    ok &= (timer_wheel_ms_until_next(&wheel) == -1);
+
+    node_timer a, b, c, d, e;
+    for (node_timer *timer : {&a, &b, &c, &d, &e}) { timer_init(timer); }
+
+    // Re-arming a pending timer replaces its deadline
+    timer_arm(&wheel, &a, 10);
+    timer_arm(&wheel, &a, 63);
+    timer_arm(&wheel, &b, 64);
+    timer_arm(&wheel, &c, 4095);
+    timer_arm(&wheel, &d, 4096);
+    ok &= (timer_wheel_ms_until_next(&wheel) == 63);
+
+    ok &= advance(&wheel, ms(62)).empty();
+    ok &= (timer_wheel_ms_until_next(&wheel) == 1);
+    ok &= (advance(&wheel, ms(63)) == std::vector<node_timer*>{&a});
+    ok &= !a.is_armed;
+    ok &= (timer_wheel_ms_until_next(&wheel) == 1);
+
+    // b is alone in its slot: once cancelled, the next event is c's
+    // cascade (at the start of its level-1 slot, 4032 ms)
+    timer_cancel(&wheel, &b);
+    timer_cancel(&wheel, &b);
+    ok &= !b.is_armed;
+    ok &= (timer_wheel_ms_until_next(&wheel) == (4032 - 63));
+
+    // Re-armed for 163 ms, b sits in the level-1 slot starting at 128
+    timer_arm(&wheel, &b, 100);
+    ok &= (timer_wheel_ms_until_next(&wheel) == (128 - 63));
+
+    // One jump past every deadline: cascades happen in deadline order
+    ok &= (advance(&wheel, ms(5000)) ==
+           (std::vector<node_timer*>{&b, &c, &d}));
+    ok &= (timer_wheel_ms_until_next(&wheel) == -1);
+
+    // A timer on the top level survives cascades through every level
+    timer_arm(&wheel, &e, UINT32_MAX);
+    const uint64_t e_tick = (5000 + (uint64_t) UINT32_MAX);
+    ok &= advance(&wheel, ms(e_tick - 1)).empty();
+    ok &= (timer_wheel_ms_until_next(&wheel) == 1);
+    ok &= (advance(&wheel, ms(e_tick)) == std::vector<node_timer*>{&e});
+
+    // Time stops at the last tick, so later deadlines are due at once
+    ok &= advance(&wheel, ms(max_tick + 1000)).empty();
+    timer_arm(&wheel, &a, 10);
+    ok &= (timer_wheel_ms_until_next(&wheel) == 0);
+    ok &= (advance(&wheel, ms(max_tick + 2000)) ==
+           std::vector<node_timer*>{&a});
+    ok &= (timer_wheel_ms_until_next(&wheel) == -1);
+
+    std::cout << (ok ? "PASS" : "FAIL") << std::endl;
+}
@@ -0,0 +1,121 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the Mixnet course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the Mixnet project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+#include "test_common.h"
+#include "harness/orchestrator.h"
+
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+#include <utility>
+
+static int pcap_count = 0;
+static bool pcap_ok = true;
+static test_error_code_t retcode = TEST_ERROR_NONE;
+
+static const uint16_t num_nodes = 5;
+static const uint16_t hub_idx = num_nodes / 2;
+static const int packets_per_pair = 4;
+static const std::vector<mixnet_address> mixaddrs {13, 11, 17, 19, 15};
+
+// (Source, destination) -> Sequence number expected next
+static std::map<std::pair<int, int>, int> next_sequence;
+
+void pcap(orchestrator* orchestrator,
+          struct test_message_header* header,
+          struct mixnet_packet* packet) {
+    (void) orchestrator;
+
+    if (packet->type != PACKET_TYPE_DATA) { return; }
+    pcap_count++;
+
+    // The hub only ever forwards packets
+    const int dst = header->fragment_id;
+    if (dst == hub_idx) { pcap_ok = false; return; }
+
+    auto rh = reinterpret_cast<mixnet_packet_routing_header*>(
+        reinterpret_cast<char*>(packet) + sizeof(mixnet_packet));
+    auto route = reinterpret_cast<mixnet_address*>(
+        reinterpret_cast<char*>(rh) + sizeof(mixnet_packet_routing_header));
+
+    // Every route goes through the hub
+    if ((rh->route_length != 1) || (route[0] != mixaddrs[hub_idx])) {
+        pcap_ok = false; return;
+    }
+    auto payload = reinterpret_cast<char*>(route + rh->route_length);
+    std::istringstream data(std::string(payload, packet->payload_size - (
+        sizeof(mixnet_packet_routing_header) + sizeof(mixnet_address))));
+
+    // Packets between each pair of leaves arrive in order
+    int src = -1, sequence = -1;
+    data >> src >> sequence;
+    pcap_ok &= (sequence == next_sequence[{src, dst}]++);
+}
+
+/**
+ * This test-case exercises a star topology with 5 Mixnet nodes, linked
+ * by Unix seqpacket sockets (instead of SCTP). Every leaf sends a few
+ * DATA packets to every other leaf, all through the hub. Each packet
+ * should be delivered exactly once, and in order for a given pair of
+ * leaves.
+ */
+void testcase(orchestrator* orchestrator) {
+    sleep(5); // Wait for routing convergence
+    auto error_code = TEST_ERROR_NONE;
+
+    // Get packets from all nodes
+    for (uint16_t i = 0; i < num_nodes; i++) {
+        DIE_ON_ERROR(orchestrator->pcap_change_subscription(i, true));
+    }
+    for (int k = 0; k < packets_per_pair; k++) {
+        for (uint16_t src = 0; src < num_nodes; src++) {
+            for (uint16_t dst = 0; dst < num_nodes; dst++) {
+                if ((src == hub_idx) || (dst == hub_idx) || (src == dst)) {
+                    continue;
+                }
+                DIE_ON_ERROR(orchestrator->send_packet(
+                    src, dst, PACKET_TYPE_DATA,
+                    std::to_string(src) + " " + std::to_string(k)));
+            }
+        }
+    }
+    sleep(5); // Wait for packets to propagate
+}
+
+void return_code(test_error_code_t value) {
+    retcode = value;
+}
+
+int main(int argc, char **argv) {
+    std::vector<std::vector<mixnet_address>> topology;
+    create_star_topology(num_nodes, topology);
+
+    orchestrator orchestrator;
+    orchestrator.configure(argc, argv);
+    orchestrator.register_cb_pcap(pcap);
+    orchestrator.register_cb_testcase(testcase);
+    orchestrator.register_cb_retcode(return_code);
+    orchestrator.set_topology(mixaddrs, topology);
+    orchestrator.set_transport(HARNESS_TRANSPORT_UNIX);
+
+    std::cout << "[Test] Starting test_transport_unix_star..." << std::endl;
+    orchestrator.run();
+    std::cout << ((retcode == TEST_ERROR_NONE) ?
+        "Nodes returned OK" : "Nodes returned error") << std::endl;
+
+    const int num_leaves = (num_nodes - 1);
+    const int num_pairs = (num_leaves * (num_leaves - 1));
+    std::cout << (((pcap_count == (num_pairs * packets_per_pair)) &&
+                   (next_sequence.size() == (size_t) num_pairs) &&
+                   pcap_ok) ? "PASS" : "FAIL") << std::endl;
+}
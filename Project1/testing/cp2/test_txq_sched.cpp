@@ -0,0 +1,268 @@
+/**
+ * Copyright (C) 2022 Carnegie Mellon University
+ *
+ * This file is part of the Mixnet course project developed for
+ * the Computer Networks course (15-441/641) taught at Carnegie
+ * Mellon University.
+ *
+ * No part of the Mixnet project may be copied and/or distributed
+ * without the express permission of the 15-441/641 course staff.
+ */
+extern "C" {
+#include "mixnet/connection.h"
+}
+#include "mixnet/stats.h"
+#include "mixnet/txq.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+/**
+ * Stub connection: each port's socket takes a set number of packets
+ * (or any number, if negative), and sent packets are logged.
+ */
+struct sent_packet {
+    uint8_t port;
+    mixnet_packet_type_t type;
+    uint32_t sequence;
+    size_t size;
+};
+static std::vector<sent_packet> sent;
+static int capacity[2] = {0, 0};
+static bool fail_allocs = false;
+static int num_live = 0;
+static uint64_t watched = 0;
+static struct mixnet_stats stats;
+
+static bool socket_take(const uint8_t port, const mixnet_packet *packet) {
+    if (capacity[port] == 0) { return false; }
+    if (capacity[port] > 0) { capacity[port]--; }
+
+    uint32_t sequence;
+    memcpy(&sequence, reinterpret_cast<const char*>(packet + 1),
+           sizeof(sequence));
+    sent.push_back({port, packet->type, sequence,
+                    sizeof(mixnet_packet) + packet->payload_size});
+    return true;
+}
+
+extern "C" {
+mixnet_packet *mixnet_packet_alloc(void *, const size_t size) {
+    if (fail_allocs) { return nullptr; }
+    num_live++;
+    return static_cast<mixnet_packet*>(malloc(size));
+}
+
+void mixnet_packet_free(void *, mixnet_packet *packet) {
+    if (packet == nullptr) { return; }
+    num_live--;
+    free(packet);
+}
+
+int mixnet_send(void *handle, const uint8_t port, mixnet_packet *packet) {
+    if (!socket_take(port, packet)) { return 0; }
+    mixnet_packet_free(handle, packet);
+    return 1;
+}
+
+int mixnet_send_batch(void *handle, const uint8_t port,
+                      mixnet_packet **packets, const int num_packets) {
+    int num_sent = 0;
+    while ((num_sent < num_packets) &&
+           (mixnet_send(handle, port, packets[num_sent]) == 1)) {
+        num_sent++;
+    }
+    return num_sent;
+}
+
+int mixnet_send_multi(void *handle, const uint64_t port_mask,
+                      mixnet_packet *packet, uint64_t *unsent_ports) {
+    int num_sent = 0;
+    *unsent_ports = 0;
+    for (uint8_t port = 0; port < 2; port++) {
+        if (!port_mask_has(port_mask, port)) { continue; }
+        if (socket_take(port, packet)) { num_sent++; }
+        else { *unsent_ports |= port_mask_bit(port); }
+    }
+    (void) handle; // The caller keeps the packet
+    return num_sent;
+}
+
+void mixnet_watch_writable(void *, const uint64_t port_mask) {
+    watched = port_mask;
+}
+
+struct mixnet_stats *mixnet_get_stats(void *) { return &stats; }
+}
+
+static uint32_t next_sequence = 0;
+
+// Allocates a packet of the given type and total size
+static mixnet_packet *make_packet(const mixnet_packet_type_t type,
+                                  const size_t size) {
+    mixnet_packet *packet = mixnet_packet_alloc(nullptr, size);
+    packet->src_address = packet->dst_address = 0;
+    packet->type = type;
+    packet->payload_size = (uint16_t) (size - sizeof(mixnet_packet));
+    memcpy(reinterpret_cast<char*>(packet + 1), &next_sequence,
+           sizeof(next_sequence));
+    next_sequence++;
+    return packet;
+}
+
+// Whether the sent packets of one type have increasing sequence numbers
+static bool is_fifo(const mixnet_packet_type_t type) {
+    bool ok = true, any = false;
+    uint32_t last = 0;
+    for (const auto& p : sent) {
+        if (p.type != type) { continue; }
+        ok &= (!any || (p.sequence > last));
+        last = p.sequence; any = true;
+    }
+    return ok;
+}
+
+/**
+ * Control packets must overtake a data backlog: a new control packet
+ * goes out directly, and queued ones drain before queued data.
+ */
+static bool test_control_first(tx_queues *q) {
+    bool ok = true;
+    sent.clear();
+    capacity[0] = 0;
+    for (int i = 0; i < 3; i++) {
+        ok &= (txq_send(nullptr, q, 0, make_packet(PACKET_TYPE_DATA, 100)) == 1);
+    }
+    capacity[0] = 1;
+    ok &= (txq_send(nullptr, q, 0, make_packet(PACKET_TYPE_LSA, 40)) == 1);
+    ok &= ((sent.size() == 1) && (sent[0].type == PACKET_TYPE_LSA));
+
+    // Queued behind a full socket, control still drains first
+    ok &= (txq_send(nullptr, q, 0, make_packet(PACKET_TYPE_STP, 20)) == 1);
+    txq_drain(nullptr, q);
+    ok &= (watched == port_mask_bit(0));
+    capacity[0] = -1;
+    txq_drain(nullptr, q);
+
+    const std::vector<mixnet_packet_type_t> expected {
+        PACKET_TYPE_LSA, PACKET_TYPE_STP, PACKET_TYPE_DATA,
+        PACKET_TYPE_DATA, PACKET_TYPE_DATA};
+    ok &= (sent.size() == expected.size());
+    for (size_t i = 0; ok && (i < expected.size()); i++) {
+        ok &= (sent[i].type == expected[i]);
+    }
+    ok &= is_fifo(PACKET_TYPE_DATA);
+    ok &= (!txq_is_backlogged(q) && (watched == 0));
+    return ok;
+}
+
+/**
+ * DATA and PING backlogs (of mixed sizes) share a port by deficit
+ * round-robin: neither waits for the other to drain, and the bytes
+ * each has sent stay within a quantum or two of each other.
+ */
+static bool test_drr_sharing(tx_queues *q) {
+    bool ok = true;
+    sent.clear();
+    capacity[0] = 0;
+    const size_t data_sizes[] = {1000, 600, 300};
+    const size_t ping_sizes[] = {60, 200};
+    size_t data_bytes = 0, ping_bytes = 0;
+    for (int i = 0; i < 30; i++) {
+        mixnet_packet *data = make_packet(PACKET_TYPE_DATA, data_sizes[i % 3]);
+        mixnet_packet *ping = make_packet(PACKET_TYPE_PING, ping_sizes[i % 2]);
+        data_bytes += data_sizes[i % 3];
+        ping_bytes += ping_sizes[i % 2];
+        ok &= (txq_send(nullptr, q, 0, data) == 1);
+        ok &= (txq_send(nullptr, q, 0, ping) == 1);
+    }
+    // Let the socket take a few packets at a time
+    for (int round = 0; (round < 1000) && txq_is_backlogged(q); round++) {
+        capacity[0] = 5;
+        txq_drain(nullptr, q);
+    }
+    ok &= !txq_is_backlogged(q);
+    ok &= (sent.size() == 60);
+
+    // While both classes are backlogged, their shares stay close
+    size_t sent_data = 0, sent_ping = 0;
+    for (const auto& p : sent) {
+        if ((sent_data == data_bytes) || (sent_ping == ping_bytes)) { break; }
+        if (p.type == PACKET_TYPE_DATA) { sent_data += p.size; }
+        else { sent_ping += p.size; }
+
+        const size_t gap = (sent_data > sent_ping) ? (sent_data - sent_ping) :
+                                                      (sent_ping - sent_data);
+        ok &= (gap <= (2 * TXQ_DRR_QUANTUM));
+    }
+    ok &= (is_fifo(PACKET_TYPE_DATA) && is_fifo(PACKET_TYPE_PING));
+    return ok;
+}
+
+/**
+ * Packets beyond a full ring (or whose copy can't be allocated) are
+ * dropped and counted as overflows; the depth and its peak track the
+ * queued packets.
+ */
+static bool test_overflow(tx_queues *q) {
+    bool ok = true;
+    sent.clear();
+    memset(&stats, 0, sizeof(stats));
+    capacity[0] = capacity[1] = 0;
+
+    for (int i = 0; i < (TXQ_RING_SIZE + 3); i++) {
+        const int expected = (i < TXQ_RING_SIZE) ? 1 : 0;
+        ok &= (txq_send(nullptr, q, 0, make_packet(PACKET_TYPE_DATA, 50)) ==
+               expected);
+    }
+    ok &= ((stats.tx_overflows == 3) && (stats.tx_queued == TXQ_RING_SIZE));
+    ok &= (stats.tx_queue_depth == TXQ_RING_SIZE);
+
+    // Other classes (and ports) have rings of their own
+    ok &= (txq_send(nullptr, q, 0, make_packet(PACKET_TYPE_PING, 50)) == 1);
+    ok &= (stats.tx_queue_depth == (TXQ_RING_SIZE + 1));
+
+    // A broadcast queues a copy on the second port, which fails here
+    fail_allocs = false;
+    mixnet_packet *flood = make_packet(PACKET_TYPE_FLOOD, 30);
+    fail_allocs = true;
+    ok &= (txq_send_multi(nullptr, q, port_mask_all(2), flood) == 1);
+    fail_allocs = false;
+    ok &= (stats.tx_overflows == 4);
+    ok &= (stats.tx_queue_depth == (TXQ_RING_SIZE + 2));
+
+    capacity[0] = capacity[1] = -1;
+    txq_drain(nullptr, q);
+    ok &= (sent.size() == (TXQ_RING_SIZE + 2));
+    ok &= ((stats.tx_queue_depth == 0) &&
+           (stats.tx_queue_peak == (TXQ_RING_SIZE + 2)));
+    return ok;
+}
+
+/**
+ * This test-case exercises the transmit queues on their own, against
+ * a stub connection whose sockets take a set number of packets. We'd
+ * expect control packets to overtake queued data, DATA and PING to
+ * share a port fairly (by bytes), and ring overflows to be counted.
+ */
+int main() {
+    std::cout << "[Test] Starting test_txq_sched..." << std::endl;
+
+    tx_queues q;
+    bool ok = txq_init(&q, 2);
+    if (!ok) { std::cout << "FAIL" << std::endl; return 0; }
+
+    ok &= test_control_first(&q);
+    ok &= test_drr_sharing(&q);
+    ok &= test_overflow(&q);
+
+    // Nothing is leaked, even with packets still queued
+    capacity[0] = 0;
+    ok &= (txq_send(nullptr, &q, 0, make_packet(PACKET_TYPE_DATA, 50)) == 1);
+    txq_destroy(nullptr, &q);
+    ok &= (num_live == 0);
+
+    std::cout << (ok ? "PASS" : "FAIL") << std::endl;
+}